@@ -1,26 +1,41 @@
 #include <systemc.h>
 #include <iostream>
+#include "../../common/systolic_array.h"
 
 // Processing Element (PE) module
-SC_MODULE(PE) {
+template <class T = IntTypes>
+SC_MODULE(PE_B1) {
+    typedef typename T::data_t data_t;
+    typedef typename T::weight_t weight_t;
+    typedef typename T::acc_t acc_t;
+
     sc_in<bool> clk;
     sc_in<bool> rst;
     
-    sc_in<int> x_in;       // Input data
-    sc_in<int> y_in;       // Partial sum input
-    sc_out<int> y_out;     // Forward partial sum to next PE
+    sc_in<data_t> x_in;    // Input data
+    sc_in<acc_t> y_in;     // Partial sum input
+    sc_out<acc_t> y_out;   // Forward partial sum to next PE
 
-    int weight;            // Fixed weight for this PE
+    weight_t weight;       // Fixed weight for this PE
 
     // Internal registers
-    int mult_result_reg;   // Register for multiplication result
-    int y_reg;             // Register for output data
+    acc_t mult_result_reg; // Register for multiplication result
+    acc_t y_reg;           // Register for output data
   
-  	int sum;
-  	int x;
+  	acc_t sum;
+  	data_t x;
+
+    StrideGate gate;       // Skips the products of windows a strided run drops
+
+    PeCounters counters;   // Activity counters, live only with -DPE_COUNTERS
+    AccStats acc_stats;    // Overflows of sum
+
+    // Registers a clocked cycle writes and values it hands on, for common/energy.h
+    static const int register_writes = 3;
+    static const int forwarding_hops = 1;
 
     // Constructor
-    SC_CTOR(PE) {
+    SC_CTOR(PE_B1) {
         SC_METHOD(compute);
         sensitive << clk.pos();
         sensitive << rst.pos();
@@ -34,93 +49,152 @@ SC_MODULE(PE) {
         weight = w;
     }
 
+    // Registers and outputs at rest, an edge with all inputs zero changes nothing
+    bool quiescent() const {
+        return mult_result_reg == 0 && y_reg == 0 && y_out.read() == 0 && gate.still();
+    }
+
+    // Registers for common/checkpoint.h
+    template <class Archive>
+    void checkpoint(Archive& a) {
+        a(weight);
+        a(mult_result_reg);
+        a(y_reg);
+        a(sum);
+        a(x);
+        a(gate.phase);
+    }
+    
     // Compute function implementing the PE logic
     void compute() {
         if (rst.read()) {
             // Reset all registers
             mult_result_reg = 0;
             y_reg = 0;
+            gate.reset();
             y_out.write(0);
         } else if (clk.read()) {
             
             // Pipeline stage 1: Second input data register (extra delay for x path)
             x = x_in.read();
+
+            // A strided run drops the window this product belongs to: no multiply,
+            // and the partial sum leaves as 0, so y_out shows 0 for the window
+            if (!gate.next()) {
+                mult_result_reg = 0;
+                y_reg = 0;
+                sum = 0;
+                y_out.write(0);
+                counters.skipped();
+                return;
+            }
+
             // Pipeline stage 3: Perform multiplication and store in register
-            mult_result_reg = x * weight;
+            mult_result_reg = pe_multiply<acc_t>(x, weight);
             
             // Pipeline stage 4: Register output data
           	y_reg = y_in.read();
           
           	// Add multiplication result with output data
-            sum = mult_result_reg + y_reg;
+            sum = acc_stats.add(mult_result_reg, y_reg);
             
             // Forward data and partial sum
             y_out.write(sum);
+            counters.cycle(x, weight, y_reg != 0);
         }
     }
 };
 
-// Top-level systolic array module
-SC_MODULE(B1_SystolicArray) {
+// Top-level systolic array module with N PEs
+template <int N, class T>
+struct SystolicArray<Design::B1, N, T> : public sc_module {
+    typedef typename T::data_t data_t;
+    typedef typename T::weight_t weight_t;
+    typedef typename T::acc_t acc_t;
+
     sc_in<bool> clk;
     sc_in<bool> rst;
     
     // Input ports
-    sc_in<int> x_in;   // Input data stream
-    sc_in<int> y_in;   // Initial partial sum (usually 0)
+    sc_in<data_t> x_in;   // Input data stream
+    sc_in<acc_t> y_in;    // Initial partial sum (usually 0)
     
     // Output ports
-    sc_out<int> y_out; // Final result
+    sc_out<acc_t> y_out;  // Final result
     
-    // Processing elements
-    PE* pe1;
-    PE* pe2;
-    PE* pe3;
+    // Processing elements (PE1 leftmost ... PEN rightmost)
+    sc_vector<PE_B1<T> > pe;
     
     // Internal signals for connecting PEs
-    sc_signal<int> y_sig1, y_sig2;  // y connections between PEs
+    sc_vector<sc_signal<acc_t> > y_sig;  // y_sig[i] connects PE(i+1) to PE(i+2)
     
     // Constructor
-    SC_CTOR(B1_SystolicArray) {
-        // Create the processing elements
-        pe1 = new PE("PE1");
-        pe2 = new PE("PE2");
-        pe3 = new PE("PE3");
+    SC_CTOR(SystolicArray) : pe("pe"), y_sig("y_sig", N - 1) {
+        static_assert(N >= 1, "systolic array needs at least one PE");
         
-        // Set weights for each PE (w1, w2, w3) - note the order is reversed compared to W1
-        pe1->set_weight(1); // w3 (leftmost PE)
-        pe2->set_weight(2); // w2
-        pe3->set_weight(3); // w1 (rightmost PE)
-        
-        // Connect clock and reset to all PEs
-        pe1->clk(clk);
-        pe1->rst(rst);
-        pe2->clk(clk);
-        pe2->rst(rst);
-        pe3->clk(clk);
-        pe3->rst(rst);
-        
-        // Connect the PEs in series
-        // Both x and y flow from left to right: PE1 -> PE2 -> PE3
+        // Create the processing elements
+        pe.init(N, numbered<PE_B1<T> >("PE"));
         
-        // Input data connections (x flows from left to right: PE1->PE2->PE3)
-        pe1->x_in(x_in);       // Input x goes to leftmost PE (PE1)
-        pe2->x_in(x_in);     // PE2 input from PE1
-        pe3->x_in(x_in);     // PE3 input from PE2
+        // Set weights for each PE (w1 leftmost ... wN rightmost)
+        set_weights(default_weights(N));
         
-        // Partial sum connections (y also flows from left to right: PE1->PE2->PE3)
-        pe1->y_in(y_in);       // Initial y (usually 0) goes to leftmost PE (PE1)
-        pe1->y_out(y_sig1);    // PE1 output to PE2
-        pe2->y_in(y_sig1);     // PE2 input from PE1
-        pe2->y_out(y_sig2);    // PE2 output to PE3
-        pe3->y_in(y_sig2);     // PE3 input from PE2
-        pe3->y_out(y_out);     // PE3 output is the final result
+        for (int i = 0; i < N; i++) {
+            // Connect clock and reset to all PEs
+            pe[i].clk(clk);
+            pe[i].rst(rst);
+            
+            // Input x is broadcast to every PE
+            pe[i].x_in(x_in);
+            
+            // Partial sum flows from left to right: PE1 -> PE2 -> ... -> PEN
+            if (i == 0)
+                pe[i].y_in(y_in);       // Initial y (usually 0) goes to leftmost PE
+            else
+                pe[i].y_in(y_sig[i - 1]);
+            if (i == N - 1)
+                pe[i].y_out(y_out);     // Rightmost PE output is the final result
+            else
+                pe[i].y_out(y_sig[i]);
+        }
     }
     
-    // Destructor
-    ~B1_SystolicArray() {
-        delete pe1;
-        delete pe2;
-        delete pe3;
+    // Load kernel w1..wN, w1 goes to the leftmost PE
+    void set_weights(const std::vector<int>& w) {
+        for (int i = 0; i < N; i++)
+            pe[i].set_weight(w[i]);
+    }
+
+    // Strided convolution, elaboration only: of the full windows, with sample 0 on the
+    // first cycle after reset and one sample per cycle, only y_{N-1}, y_{N-1+stride},
+    // ... are computed. PE(i+1) multiplies sample c into window c + N-1-i, so it keeps
+    // the edges with (c - i) % stride == 0 and skips the rest; y_out is 0 on the cycles
+    // of the dropped windows. Stride 1 is the plain array.
+    void set_stride(int stride) {
+        for (int i = 0; i < N; i++)
+            pe[i].gate.set(stride, i);
+    }
+
+    // Accumulations and overflows summed over the PEs
+    AccStats accumulator_stats() const {
+        return total_acc_stats(pe);
+    }
+
+    // True if an edge with every input zero would change nothing, see common/idle_skip.h
+    bool quiescent() const {
+        return all_quiescent(pe);
+    }
+
+    // PE and module registers for common/checkpoint.h; its signals are walked separately
+    template <class Archive>
+    void checkpoint(Archive& a) {
+        checkpoint_all(a, pe);
+    }
+
+    // Per-PE utilization table at sc_stop(), only with -DPE_COUNTERS, and any overflows
+    void end_of_simulation() {
+        report_pe_counters(name(), pe);
+        report_acc_overflows(name(), accumulator_stats());
     }
 };
+
+typedef SystolicArray<Design::B1, 3> B1_SystolicArray;
@@ -1,3 +1,8 @@
+// Processing Element. x, its product, y_in and their sum are each registered, so
+// y_out after edge e is WEIGHT * (x_in at edge e-3) + (y_in at edge e-2), and a
+// partial sum takes three cycles from one PE's y_out to the next one's. Unlike
+// PE_B1 in design.cpp, which adds in the cycle it samples, the array therefore
+// convolves samples driven every three cycles (see ../verilator/b1_verilated.h).
 module PE #(
     parameter WEIGHT = 1
 )(
@@ -27,39 +32,33 @@ module PE #(
     end
 endmodule
 
-module b1_systolic_array(
+// N PEs with weights 1..N (PE1 leftmost), x_in broadcast to every PE and the
+// partial sum flowing PE1 -> ... -> PEN, as SystolicArray<Design::B1, N>
+module b1_systolic_array #(
+    parameter N = 3
+)(
     input wire clk,
     input wire rst,
     input wire [31:0] x_in,
     input wire [31:0] y_in,
     output wire [31:0] y_out
 );
-    wire [31:0] y_sig1, y_sig2;
-
-    // PE1: weight = 1
-    PE #(.WEIGHT(1)) pe1 (
-        .clk(clk),
-        .rst(rst),
-        .x_in(x_in),
-        .y_in(y_in),
-        .y_out(y_sig1)
-    );
+    // y_sig[k] enters PE(k+1), y_sig[N] leaves PEN
+    wire [31:0] y_sig [0:N];
 
-    // PE2: weight = 2
-    PE #(.WEIGHT(2)) pe2 (
-        .clk(clk),
-        .rst(rst),
-        .x_in(x_in),
-        .y_in(y_sig1),
-        .y_out(y_sig2)
-    );
+    assign y_sig[0] = y_in;
+    assign y_out = y_sig[N];
 
-    // PE3: weight = 3
-    PE #(.WEIGHT(3)) pe3 (
-        .clk(clk),
-        .rst(rst),
-        .x_in(x_in),
-        .y_in(y_sig2),
-        .y_out(y_out)
-    );
-endmodule
\ No newline at end of file
+    genvar k;
+    generate
+        for (k = 0; k < N; k = k + 1) begin : pe
+            PE #(.WEIGHT(k + 1)) pe_k (
+                .clk(clk),
+                .rst(rst),
+                .x_in(x_in),
+                .y_in(y_sig[k]),
+                .y_out(y_sig[k + 1])
+            );
+        end
+    endgenerate
+endmodule
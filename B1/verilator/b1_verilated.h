@@ -0,0 +1,65 @@
+#ifndef B1_VERILATED_H
+#define B1_VERILATED_H
+
+#include <systemc.h>
+#include <cstdint>
+#include "Vb1_systolic_array.h"
+
+// Taps the Verilog model was verilated with (-GN=...), set by run.sh
+#ifndef B1_TAPS
+#define B1_TAPS 3
+#endif
+
+// b1_systolic_array from ../result/design.v, compiled by Verilator, behind the
+// ports of SystolicArray<Design::B1, N> so a testbench can take either one.
+// Verilator maps the 32-bit Verilog ports to uint32_t, the array's are int, so
+// the data ports are copied through in delta cycles, which costs no clock cycle.
+//
+// The two models do not have the same timing. PE_B1 adds x * w to y_in in the
+// cycle it samples them, while the Verilog PE registers x, the product, y_in and
+// the sum, so a partial sum takes three cycles from PE to PE. Fed one sample per
+// cycle, the Verilog array applies its weights three samples apart. Neither model
+// is changed to hide that: driven with one sample every `spacing` cycles, the
+// Verilog array computes the same convolution, `latency` cycles after each sample
+// instead of right after it, and parity.cpp compares the results sample by sample.
+SC_MODULE(B1_Verilated) {
+    static const int spacing = 3;   // Input cycles per sample
+    static const int latency = 3;   // Cycles from a sample to its result on y_out
+
+    sc_in<bool> clk;
+    sc_in<bool> rst;
+
+    sc_in<int> x_in;   // Input data stream
+    sc_in<int> y_in;   // Initial partial sum (usually 0)
+
+    sc_out<int> y_out; // Final result
+
+    Vb1_systolic_array model;
+
+    sc_signal<uint32_t> x_bits, y_in_bits, y_out_bits;
+
+    SC_CTOR(B1_Verilated) : model("model") {
+        model.clk(clk);
+        model.rst(rst);
+        model.x_in(x_bits);
+        model.y_in(y_in_bits);
+        model.y_out(y_out_bits);
+
+        SC_METHOD(to_model);
+        sensitive << x_in << y_in;
+
+        SC_METHOD(from_model);
+        sensitive << y_out_bits;
+    }
+
+    void to_model() {
+        x_bits.write(uint32_t(x_in.read()));
+        y_in_bits.write(uint32_t(y_in.read()));
+    }
+
+    void from_model() {
+        y_out.write(int(y_out_bits.read()));
+    }
+};
+
+#endif
@@ -0,0 +1,267 @@
+#include <systemc.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include "verilated.h"
+#include "b1_verilated.h"
+#include "../../common/child_process.h"
+#include "../../common/stream_run.h"
+
+// Counts the cycles, of the first `cycles`, on which the SystemC and the Verilated y_out differ
+SC_MODULE(ParityMonitor) {
+    sc_in<bool> clk;
+    sc_in<int> y_systemc, y_verilated;
+
+    uint64_t cycles;        // Cycles to compare, the stream and its drain
+    uint64_t edges;
+    uint64_t mismatches;
+    uint64_t first;         // Cycle of the first mismatch
+
+    SC_HAS_PROCESS(ParityMonitor);
+    ParityMonitor(sc_module_name name, uint64_t cycles)
+        : sc_module(name), cycles(cycles), edges(0), mismatches(0), first(0) {
+        SC_METHOD(compare);
+        sensitive << clk.pos();
+        dont_initialize();
+    }
+
+    // Both outputs hold the result of the previous edge
+    void compare() {
+        if (edges > 0 && edges <= cycles && y_systemc.read() != y_verilated.read() && mismatches++ == 0)
+            first = edges - 1;
+        edges++;
+    }
+};
+
+// y_out for each sample of a source, read `latency` cycles after the sample's input cycle
+SC_MODULE(ResultRecorder) {
+    sc_in<bool> clk;
+    sc_in<int> y_out;
+
+    const StimulusSource& source;
+    int latency;
+    uint64_t edges;
+    std::vector<int> results;
+
+    SC_HAS_PROCESS(ResultRecorder);
+    ResultRecorder(sc_module_name name, const StimulusSource& source, int latency)
+        : sc_module(name), source(source), latency(latency), edges(0) {
+        results.reserve(source.count);
+        SC_METHOD(record);
+        sensitive << clk.pos();
+        dont_initialize();
+    }
+
+    // y_out now is the result of the previous edge
+    void record() {
+        if (edges > 0 && results.size() < source.count && edges - 1 == source.sample_cycle(results.size()) + latency)
+            results.push_back(y_out.read());
+        edges++;
+    }
+};
+
+// Measured in the parity child, trivially copyable so it can come back through a pipe
+struct ParityResult {
+    uint64_t cycles;            // Rising edges compared one sample per cycle
+    uint64_t cycle_mismatches;  // Of those, edges where the two y_out differ
+    uint64_t first_mismatch;    // Cycle of the first one
+    uint64_t results;           // Results compared sample by sample
+    uint64_t result_mismatches;
+    uint64_t errors;            // Golden-model mismatches and missing results of either model
+};
+
+// Measured in the child of a speed run
+struct BackendResult {
+    uint64_t cycles;
+    uint64_t results;
+    uint64_t errors;        // Golden-model mismatches and missing results
+    double seconds;
+};
+
+// Both models on one sample per cycle, compared cycle by cycle, and the Verilated one
+// again on one sample every B1_Verilated::spacing cycles, compared result by result
+static void run_parity(const std::vector<StimulusRecord>& samples, ParityResult& r) {
+    const int N = B1_TAPS;
+    sc_clock clk("clk", 10, SC_NS, 0.5, 5, SC_NS, true);
+    InputSignals in, spaced_in;
+    OutputSignals out;
+    sc_signal<int> y_verilated, y_spaced;
+    SystolicArray<Design::B1, N> array("array");
+    B1_Verilated verilated("verilated"), spaced("spaced");
+    StimulusSource source("source", samples.data(), samples.size(), 1);
+    StimulusSource spaced_source("spaced_source", samples.data(), samples.size(), B1_Verilated::spacing);
+    GoldenChecker checker = GoldenChecker::for_design(Design::B1, N, samples.size());
+    GoldenChecker spaced_checker = GoldenChecker::for_design(Design::B1, N, samples.size());
+    spaced_checker.set_output_latency(B1_Verilated::latency);
+    // Run until the spaced stream has drained, the longer of the two
+    uint64_t stop_after = spaced_source.total_cycles() + B1_Verilated::latency + 8;
+    StreamMonitor monitor("monitor", source, checker, stop_after, false);
+    StreamMonitor spaced_monitor("spaced_monitor", spaced_source, spaced_checker, stop_after, false);
+    ParityMonitor parity("parity", source.total_cycles() + 2 * N + 8);
+    ResultRecorder systemc_results("systemc_results", source, output_latency(Design::B1, N, 0));
+    ResultRecorder verilated_results("verilated_results", spaced_source, B1_Verilated::latency);
+
+    bind(array, clk, in, out);
+    verilated.clk(clk);
+    verilated.rst(in.rst);
+    verilated.x_in(in.x_in);
+    verilated.y_in(in.y_in);
+    verilated.y_out(y_verilated);
+    source.clk(clk);
+    source.rst(in.rst);
+    source.x_in(in.x_in);
+    source.y_in(in.y_in);
+    source.w_in(in.w_in);
+    source.tag_in(in.tag_in);
+    monitor.clk(clk);
+    monitor.x_in(in.x_in);
+    monitor.w_in(in.w_in);
+    monitor.y_out(out.y_out);
+    parity.clk(clk);
+    parity.y_systemc(out.y_out);
+    parity.y_verilated(y_verilated);
+    systemc_results.clk(clk);
+    systemc_results.y_out(out.y_out);
+
+    spaced.clk(clk);
+    spaced.rst(spaced_in.rst);
+    spaced.x_in(spaced_in.x_in);
+    spaced.y_in(spaced_in.y_in);
+    spaced.y_out(y_spaced);
+    spaced_source.clk(clk);
+    spaced_source.rst(spaced_in.rst);
+    spaced_source.x_in(spaced_in.x_in);
+    spaced_source.y_in(spaced_in.y_in);
+    spaced_source.w_in(spaced_in.w_in);
+    spaced_source.tag_in(spaced_in.tag_in);
+    spaced_monitor.clk(clk);
+    spaced_monitor.x_in(spaced_in.x_in);
+    spaced_monitor.w_in(spaced_in.w_in);
+    spaced_monitor.y_out(y_spaced);
+    verilated_results.clk(clk);
+    verilated_results.y_out(y_spaced);
+
+    sc_start();
+
+    r.cycles = parity.cycles;
+    r.cycle_mismatches = parity.mismatches;
+    r.first_mismatch = parity.first;
+    r.results = std::min(systemc_results.results.size(), verilated_results.results.size());
+    for (size_t i = 0; i < r.results; i++) {
+        if (systemc_results.results[i] != verilated_results.results[i] && ++r.result_mismatches <= 10)
+            cout << "Sample " << i << ": SystemC result " << systemc_results.results[i] << ", Verilated result "
+                 << verilated_results.results[i] << endl;
+    }
+    r.result_mismatches += samples.size() - r.results;
+
+    cout << "SystemC, one sample per cycle: ";
+    checker.finish();
+    cout << "Verilated, one sample every " << B1_Verilated::spacing << " cycles: ";
+    spaced_checker.finish();
+    r.errors = checker.mismatch_count() + checker.missing_count() + spaced_checker.mismatch_count() +
+               spaced_checker.missing_count();
+}
+
+// The Verilated array alone, for the speed comparison, at the input rate it needs
+static void run_verilated(const std::vector<StimulusRecord>& samples, BackendResult& r) {
+    const int N = B1_TAPS;
+    sc_clock clk("clk", 10, SC_NS, 0.5, 5, SC_NS, true);
+    InputSignals in;
+    OutputSignals out;
+    B1_Verilated verilated("verilated");
+    StimulusSource source("source", samples.data(), samples.size(), B1_Verilated::spacing);
+    GoldenChecker checker = GoldenChecker::for_design(Design::B1, N, samples.size());
+    checker.set_output_latency(B1_Verilated::latency);
+    checker.set_report_limit(0);
+    StreamMonitor monitor("monitor", source, checker, source.total_cycles() + B1_Verilated::latency + 8, false);
+
+    verilated.clk(clk);
+    verilated.rst(in.rst);
+    verilated.x_in(in.x_in);
+    verilated.y_in(in.y_in);
+    verilated.y_out(out.y_out);
+    source.clk(clk);
+    source.rst(in.rst);
+    source.x_in(in.x_in);
+    source.y_in(in.y_in);
+    source.w_in(in.w_in);
+    source.tag_in(in.tag_in);
+    monitor.clk(clk);
+    monitor.x_in(in.x_in);
+    monitor.w_in(in.w_in);
+    monitor.y_out(out.y_out);
+
+    auto start = std::chrono::steady_clock::now();
+    sc_start();
+    r.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    r.cycles = monitor.edges;
+    r.results = checker.results_checked();
+    r.errors = checker.mismatch_count() + checker.missing_count();
+}
+
+// The SystemC array alone
+static void run_systemc(const std::vector<StimulusRecord>& samples, BackendResult& r) {
+    GoldenChecker checker = GoldenChecker::for_design(Design::B1, B1_TAPS, samples.size());
+    checker.set_report_limit(0);
+    StreamStats stats = run_stream<Design::B1, B1_TAPS>(samples.data(), samples.size(), checker);
+    r.seconds = stats.seconds;
+    r.cycles = stats.cycles;
+    r.results = checker.results_checked();
+    r.errors = checker.mismatch_count() + checker.missing_count();
+}
+
+int sc_main(int argc, char* argv[]) {
+    Verilated::commandArgs(argc, argv);
+    uint64_t parity_samples = argc > 1 ? std::strtoull(argv[1], 0, 10) : 100000;
+    uint64_t speed_samples = argc > 2 ? std::strtoull(argv[2], 0, 10) : 1000000;
+    unsigned seed = argc > 3 ? std::strtoul(argv[3], 0, 10) : 1;
+
+    cout << "B1x" << B1_TAPS << ": parity over " << parity_samples << " samples" << endl;
+    ParityResult parity = ParityResult();
+    bool ok = run_in_child([&](ParityResult& r) {
+        run_parity(random_samples(parity_samples, seed, B1_TAPS), r);
+        return true;
+    }, parity);
+    bool passed = ok && parity.errors == 0 && parity.result_mismatches == 0;
+    if (ok) {
+        // Expected to differ, see b1_verilated.h; reported so a change to either model shows
+        cout << "One sample per cycle: SystemC and Verilated y_out differ on " << parity.cycle_mismatches << " of "
+             << parity.cycles << " cycles";
+        if (parity.cycle_mismatches)
+            cout << ", first on cycle " << parity.first_mismatch;
+        cout << endl;
+        cout << "One sample every " << B1_Verilated::spacing << " cycles into the Verilated array, results "
+             << B1_Verilated::latency << " cycles later: " << parity.result_mismatches << " of " << parity_samples
+             << " results differ from SystemC's" << endl;
+    }
+
+    cout << "backend\tsamples\tcycles\twall_seconds\tcycles_per_second\tsamples_per_second\tpassed" << endl;
+    double cycle_rate[2] = { 0, 0 }, sample_rate[2] = { 0, 0 };
+    for (int verilated = 0; verilated < 2; verilated++) {
+        BackendResult r = BackendResult();
+        bool run_ok = run_in_child([&](BackendResult& out) {
+            std::vector<StimulusRecord> samples = random_samples(speed_samples, seed, B1_TAPS);
+            if (verilated)
+                run_verilated(samples, out);
+            else
+                run_systemc(samples, out);
+            return true;
+        }, r);
+        bool run_passed = run_ok && r.errors == 0;
+        passed &= run_passed;
+        cycle_rate[verilated] = r.seconds > 0 ? r.cycles / r.seconds : 0;
+        sample_rate[verilated] = r.seconds > 0 ? speed_samples / r.seconds : 0;
+        cout << (verilated ? "verilated" : "systemc") << "\t" << speed_samples << "\t" << r.cycles << "\t"
+             << r.seconds << "\t" << cycle_rate[verilated] << "\t" << sample_rate[verilated] << "\t"
+             << (run_passed ? "true" : "false") << endl;
+    }
+    if (cycle_rate[0] > 0 && sample_rate[0] > 0)
+        cout << "Verilated / SystemC speed: " << cycle_rate[1] / cycle_rate[0] << "x in cycles, "
+             << sample_rate[1] / sample_rate[0] << "x in samples" << endl;
+    cout << (passed ? "PASS" : "FAIL") << endl;
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,18 @@
+cd "$(dirname "$0")"
+export SYSTEMC_INCLUDE=/playground_lib/systemc-2.3.3/include
+export SYSTEMC_LIBDIR=/playground_lib/systemc-2.3.3/lib-linux64
+export LD_LIBRARY_PATH=$SYSTEMC_LIBDIR
+# ./run.sh [parity_samples] [speed_samples] [seed]   parity test and speed comparison
+# ./run.sh tb                                        the B1 testbench on the Verilated model
+# TAPS=9 ./run.sh ...                                verilate design.v with N=9
+TAPS=${TAPS:-3}
+FLAGS="-O2 -DB1_TAPS=$TAPS $CXXFLAGS"
+if [ "$1" = "tb" ]; then
+    verilator --sc --exe --build -Wno-fatal -O3 -GN=$TAPS -Mdir obj_tb -CFLAGS "$FLAGS -DB1_VERILATOR" \
+        --top-module b1_systolic_array -o sim ../result/design.v ../result/testbench.cpp &&
+        echo "Compile done. Starting run..." && ./obj_tb/sim
+else
+    verilator --sc --exe --build -Wno-fatal -O3 -GN=$TAPS -Mdir obj_parity -CFLAGS "$FLAGS" \
+        --top-module b1_systolic_array -o parity ../result/design.v parity.cpp &&
+        echo "Compile done. Starting run..." && ./obj_parity/parity "$@"
+fi
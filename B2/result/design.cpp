@@ -1,27 +1,41 @@
 #include <systemc.h>
+#include <vector>
+#include "../../common/systolic_array.h"
 
 // Processing Element (PE) module
-SC_MODULE(PE) {
+template <class T = IntTypes>
+SC_MODULE(PE_B2) {
+    typedef typename T::data_t data_t;
+    typedef typename T::weight_t weight_t;
+    typedef typename T::acc_t acc_t;
+
     sc_in<bool> clk;
     sc_in<bool> rst;
     
-    sc_in<int> x_in;       // Input data
-    sc_in<int> w_in;       // Moving weight input
+    sc_in<data_t> x_in;    // Input data
+    sc_in<weight_t> w_in;  // Moving weight input
     sc_in<bool> tag_in;    // Input tag bit
   
-    sc_out<int> w_out;     // Moving weight output
+    sc_out<weight_t> w_out; // Moving weight output
     sc_out<bool> tag_out;  // Output tag bit
   
-    sc_out<int> y_out;     // Output data
+    sc_out<acc_t> y_out;   // Output data
 
     // Internal registers
-    int w_reg;             // Register for input weight
+    weight_t w_reg;        // Register for input weight
     int tag_reg;           // Register for input tag
-    int x;
-    int y;                 // Output accumulator
+    data_t x;
+    acc_t y;               // Output accumulator
+
+    PeCounters counters;   // Activity counters, live only with -DPE_COUNTERS
+    AccStats acc_stats;    // Overflows of y
+
+    // Registers a clocked cycle writes and values it hands on, for common/energy.h
+    static const int register_writes = 4;
+    static const int forwarding_hops = 3;
 
     // Constructor
-    SC_CTOR(PE) {
+    SC_CTOR(PE_B2) {
         SC_METHOD(compute);
         sensitive << clk.pos() << rst.pos();
         
@@ -30,6 +44,21 @@ SC_MODULE(PE) {
         y = 0;
     }
 
+    // Nothing to accumulate or emit, so an edge with x_in zero changes nothing but
+    // the weight ring, which turns the same with or without it
+    bool quiescent() const {
+        return y == 0 && y_out.read() == 0;
+    }
+
+    // Registers for common/checkpoint.h
+    template <class Archive>
+    void checkpoint(Archive& a) {
+        a(w_reg);
+        a(tag_reg);
+        a(x);
+        a(y);
+    }
+    
     // Compute function implementing the PE logic
     void compute() {
         if (rst.read()) {
@@ -45,6 +74,7 @@ SC_MODULE(PE) {
               y = 0;
               w_reg = 0;
               tag_reg = 0;
+              counters.tag_flush();
             } else {
               // If tag is low, ouput y_out = 0
               y_out.write(0);
@@ -54,129 +84,252 @@ SC_MODULE(PE) {
             x = x_in.read();
             w_reg = w_in.read();
             tag_reg = tag_in.read();
-            y = x*w_reg + y;
+            y = acc_stats.add(pe_multiply<acc_t>(x, w_reg), y);
             
             // Forward weight and tag signals
             w_out.write(w_reg);
             tag_out.write(tag_reg);
+            counters.cycle(x, w_reg, w_reg != 0);
         }
     }
 };
 
-// Combinational multiplexer module for selecting one of the three y signals
+// Combinational multiplexer module for selecting one of the PE y signals
+template <class Acc>
 SC_MODULE(YMux) {
-    sc_in<int> y1;
-    sc_in<int> y2;
-    sc_in<int> y3;
-    sc_out<int> y_out;
+    sc_vector<sc_in<Acc> > y;   // One input per PE
+    sc_out<Acc> y_out;
 
     void do_mux() {
-        int out_val = 0;
-        if (y1.read() != 0)
-            out_val = y1.read();
-        else if (y2.read() != 0)
-            out_val = y2.read();
-        else if (y3.read() != 0)
-            out_val = y3.read();
-        else
-            out_val = 0;
+        Acc out_val = 0;
+        for (size_t i = 0; i < y.size(); i++) {
+            if (y[i].read() != 0) {
+                out_val = y[i].read();
+                break;
+            }
+        }
         
         y_out.write(out_val);
     }
 
-    SC_CTOR(YMux) {
+    SC_HAS_PROCESS(YMux);
+    YMux(sc_module_name name, int n) : sc_module(name), y("y", n) {
         SC_METHOD(do_mux);
-        sensitive << y1 << y2 << y3;
+        for (int i = 0; i < n; i++)
+            sensitive << y[i];
+    }
+};
+
+// Shadow weight ring for loading a new kernel while the active ring keeps computing.
+// w_load shifts w_in into the shadow bank, w1 first; once N weights are in, the swap
+// is armed. A weight token passes PE1 at the start of every PE1 window, and each PE
+// sees the tokens in the order they passed PE1, so replacing the N tokens as they
+// enter PE1, starting with the tagged w1, switches every PE at its own tag boundary.
+// Windows starting before that cycle finish on the old kernel, the ones after use the
+// new one, and the ring never stops. No loads are taken while a swap is pending.
+template <class Weight>
+SC_MODULE(WeightLoader) {
+    sc_in<bool> clk;
+    sc_in<bool> rst;
+    
+    // Load port
+    sc_in<bool> w_load;
+    sc_in<Weight> w_in;
+    sc_out<bool> w_load_ready;
+    
+    // Ring segment from PEN into PE1
+    sc_in<Weight> w_ring;
+    sc_in<bool> tag_ring;
+    sc_out<Weight> w_pe1;
+    
+    int n;
+    std::vector<Weight> shadow;
+    int loaded;                   // Shadow weights filled so far
+    sc_signal<bool> armed;        // Shadow ring complete, waiting for the tag at PE1
+    sc_signal<int> injecting;     // Shadow weight replacing the ring token at PE1, 0 if none
+    
+    SC_HAS_PROCESS(WeightLoader);
+    WeightLoader(sc_module_name name, int n) : sc_module(name), n(n), shadow(n, 0), loaded(0) {
+        SC_METHOD(update);
+        sensitive << clk.pos() << rst.pos();
+        
+        SC_METHOD(select);
+        sensitive << w_ring << tag_ring << armed << injecting;
+        
+        SC_METHOD(ready);
+        sensitive << armed << injecting;
+    }
+    
+    void update() {
+        if (rst.read()) {
+            loaded = 0;
+            armed.write(false);
+            injecting.write(0);
+        } else if (clk.read()) {
+            // select() handed w1 of the shadow ring to PE1 at this edge if the tag was there
+            int k = injecting.read();
+            if (k > 0) {
+                injecting.write(k + 1 < n ? k + 1 : 0);
+            } else if (armed.read() && tag_ring.read()) {
+                armed.write(false);
+                injecting.write(n > 1 ? 1 : 0);
+            } else if (w_load.read() && !armed.read()) {
+                shadow[loaded++] = w_in.read();
+                if (loaded == n) {
+                    loaded = 0;
+                    armed.write(true);
+                }
+            }
+        }
+    }
+    
+    // No swap pending, so PE1 gets the ring as it is
+    bool quiescent() const {
+        return !armed.read() && injecting.read() == 0;
+    }
+
+    // Registers for common/checkpoint.h, the signals are saved with the others
+    template <class Archive>
+    void checkpoint(Archive& a) {
+        a(shadow);
+        a(loaded);
+    }
+    
+    void select() {
+        int k = injecting.read();
+        if (k > 0)
+            w_pe1.write(shadow[k]);
+        else if (armed.read() && tag_ring.read())
+            w_pe1.write(shadow[0]);
+        else
+            w_pe1.write(w_ring.read());
+    }
+    
+    void ready() {
+        w_load_ready.write(!armed.read() && injecting.read() == 0);
     }
 };
 
-// Top-level systolic array module
-SC_MODULE(B2_SystolicArray) {
+// Top-level systolic array module with N PEs
+template <int N, class T>
+struct SystolicArray<Design::B2, N, T> : public sc_module {
+    typedef typename T::data_t data_t;
+    typedef typename T::weight_t weight_t;
+    typedef typename T::acc_t acc_t;
+
     sc_in<bool> clk;
     sc_in<bool> rst;
     
     // Input port for data stream
-    sc_in<int> x_in;
+    sc_in<data_t> x_in;
+    
+    // Kernel load port, see WeightLoader; tie w_load low to keep the kernel
+    sc_in<bool> w_load;
+    sc_in<weight_t> w_in;
+    sc_out<bool> w_load_ready;
     
     // Final output port
-    sc_out<int> y_out;
+    sc_out<acc_t> y_out;
     
     // Processing elements
-    PE* pe1;
-    PE* pe2;
-    PE* pe3;
-    
-    // Internal signals for connecting PEs
-    sc_signal<int> w_sig1, w_sig2, w_sig3;    // Weight signals between PEs
-    sc_signal<bool> tag_sig1, tag_sig2, tag_sig3;  // Tag signals between PEs
-    sc_signal<int> y_sig1, y_sig2, y_sig3;      // Internal y signals from each PE
+    sc_vector<PE_B2<T> > pe;
+    
+    // Internal signals for connecting PEs, w_sig[i]/tag_sig[i] are driven by PE(i+1)
+    sc_vector<sc_signal<weight_t> > w_sig; // Weight signals between PEs
+    sc_vector<sc_signal<bool> > tag_sig;  // Tag signals between PEs
+    sc_vector<sc_signal<acc_t> > y_sig;   // Internal y signals from each PE
   
     // Multiplexer instance to combine the y signals
-    YMux* ymux;
+    YMux<acc_t>* ymux;
+    
+    // Shadow ring, its w_pe1 replaces w_sig[N - 1] as the weight input of PE1
+    WeightLoader<weight_t>* loader;
+    sc_signal<weight_t> w_pe1;
     
     // Constructor
-    SC_CTOR(B2_SystolicArray) {
-        // Instantiate processing elements
-        pe1 = new PE("PE1");
-        pe2 = new PE("PE2");
-        pe3 = new PE("PE3");
+    SC_CTOR(SystolicArray) : pe("pe"), w_sig("w_sig", N), tag_sig("tag_sig", N), y_sig("y_sig", N) {
+        static_assert(N >= 1, "systolic array needs at least one PE");
         
-        // Connect clock and reset to all PEs
-        pe1->clk(clk);
-      	pe1->rst(rst);
-        pe2->clk(clk);
-      	pe2->rst(rst);
-        pe3->clk(clk);
-        pe3->rst(rst);
+        // Instantiate processing elements
+        pe.init(N, numbered<PE_B2<T> >("PE"));
         
-        // Connect input data to all PEs
-        pe1->x_in(x_in);
-        pe2->x_in(x_in);
-        pe3->x_in(x_in);
-      
-        // Weight connections (ring structure)
-        pe1->w_in(w_sig3);
-        pe1->w_out(w_sig1);
-        pe2->w_in(w_sig1);
-        pe2->w_out(w_sig2);
-        pe3->w_in(w_sig2);
-        pe3->w_out(w_sig3);
-      
-        // Tag connections (ring structure)
-        pe1->tag_in(tag_sig3);
-        pe1->tag_out(tag_sig1);
-        pe2->tag_in(tag_sig1);
-        pe2->tag_out(tag_sig2);
-        pe3->tag_in(tag_sig2);
-        pe3->tag_out(tag_sig3);
-      
-        // Each PE drives its own internal y signal
-        pe1->y_out(y_sig1);
-        pe2->y_out(y_sig2);
-        pe3->y_out(y_sig3);
-      
         // Instantiate the combinational multiplexer module
-        ymux = new YMux("YMux");
-        ymux->y1(y_sig1);
-        ymux->y2(y_sig2);
-        ymux->y3(y_sig3);
+        ymux = new YMux<acc_t>("YMux", N);
+        
+        loader = new WeightLoader<weight_t>("WeightLoader", N);
+        loader->clk(clk);
+        loader->rst(rst);
+        loader->w_load(w_load);
+        loader->w_in(w_in);
+        loader->w_load_ready(w_load_ready);
+        loader->w_ring(w_sig[N - 1]);
+        loader->tag_ring(tag_sig[N - 1]);
+        loader->w_pe1(w_pe1);
+        
+        for (int i = 0; i < N; i++) {
+            // Connect clock and reset to all PEs
+            pe[i].clk(clk);
+            pe[i].rst(rst);
+            
+            // Connect input data to all PEs
+            pe[i].x_in(x_in);
+            
+            // Weight and tag connections (ring structure, PEN feeds PE1)
+            if (i == 0)
+                pe[i].w_in(w_pe1);
+            else
+                pe[i].w_in(w_sig[i - 1]);
+            pe[i].w_out(w_sig[i]);
+            pe[i].tag_in(tag_sig[(i + N - 1) % N]);
+            pe[i].tag_out(tag_sig[i]);
+            
+            // Each PE drives its own internal y signal
+            pe[i].y_out(y_sig[i]);
+            ymux->y[i](y_sig[i]);
+        }
         ymux->y_out(y_out);
       
         // Initialize weight and tag signals
-        w_sig3.write(1);
-        w_sig1.write(3);
-        w_sig2.write(2);
-      
-        tag_sig3.write(1);
-        tag_sig1.write(0);
-        tag_sig2.write(0);
+        set_weights(default_weights(N));
+    }
+    
+    // Seed the weight ring with kernel w1..wN, w1 enters PE1 together with the tag.
+    // Elaboration only; a running array takes a new kernel through w_load.
+    void set_weights(const std::vector<int>& w) {
+        for (int i = 0; i < N; i++) {
+            w_sig[(i + N - 1) % N].write(w[(N - i) % N]);
+            tag_sig[(i + N - 1) % N].write(i == 0);
+        }
     }
     
     // Destructor
-    ~B2_SystolicArray() {
-        delete pe1;
-        delete pe2;
-        delete pe3;
+    ~SystolicArray() {
         delete ymux;
+        delete loader;
+    }
+
+    // Accumulations and overflows summed over the PEs
+    AccStats accumulator_stats() const {
+        return total_acc_stats(pe);
     }
-};
\ No newline at end of file
+
+    // True if an edge with every input zero would change nothing, see common/idle_skip.h
+    bool quiescent() const {
+        return all_quiescent(pe) && loader->quiescent();
+    }
+
+    // PE and module registers for common/checkpoint.h; its signals are walked separately
+    template <class Archive>
+    void checkpoint(Archive& a) {
+        checkpoint_all(a, pe);
+        loader->checkpoint(a);
+    }
+
+    // Per-PE utilization table at sc_stop(), only with -DPE_COUNTERS, and any overflows
+    void end_of_simulation() {
+        report_pe_counters(name(), pe);
+        report_acc_overflows(name(), accumulator_stats());
+    }
+};
+
+typedef SystolicArray<Design::B2, 3> B2_SystolicArray;
@@ -1,20 +1,34 @@
 // Code your design here
 #include <systemc.h>
+#include <vector>
+#include "../../common/systolic_array.h"
 
 // Processing Element (PE) module
-SC_MODULE(PE) {
+template <class T = IntTypes>
+SC_MODULE(PE_F) {
+    typedef typename T::data_t data_t;
+    typedef typename T::weight_t weight_t;
+    typedef typename T::acc_t acc_t;
+
     sc_in<bool> clk;
     sc_in<bool> rst;
     
-    sc_in<int> x_in;       // Input data
-    sc_out<int> x_out;     // Forward data to next PE
-    sc_out<int> z_out;     // Multiplication result output
+    sc_in<data_t> x_in;    // Input data
+    sc_out<data_t> x_out;  // Forward data to next PE
+    sc_out<acc_t> z_out;   // Multiplication result output
     
-    int weight;            // Fixed weight for this PE
-    int x_reg;             // Register for input data
+    weight_t weight;       // Fixed weight for this PE
+    data_t x_reg;          // Register for input data
+    StrideGate gate;       // Skips the products of windows a strided run drops
     
+    PeCounters counters;   // Activity counters, live only with -DPE_COUNTERS
+
+    // Registers a clocked cycle writes and values it hands on, for common/energy.h
+    static const int register_writes = 2;
+    static const int forwarding_hops = 2;
+
     // Constructor
-    SC_CTOR(PE) {
+    SC_CTOR(PE_F) {
         SC_METHOD(compute);
         sensitive << clk.pos();
         sensitive << rst.pos();
@@ -27,18 +41,38 @@ SC_MODULE(PE) {
         weight = w;
     }
     
+    // Registers and outputs at rest, an edge with all inputs zero changes nothing
+    bool quiescent() const {
+        return x_reg == 0 && x_out.read() == 0 && z_out.read() == 0 && gate.still();
+    }
+
+    // Registers for common/checkpoint.h
+    template <class Archive>
+    void checkpoint(Archive& a) {
+        a(weight);
+        a(x_reg);
+        a(gate.phase);
+    }
+    
     // Compute function implementing the PE logic
     void compute() {
         if (rst.read()) {
             x_reg = 0;
+            gate.reset();
             x_out.write(0);
             z_out.write(0);
         } else {
             // Store input data
             x_reg = x_in.read();
             
-            // Multiply by weight and output result
-            z_out.write(x_reg * weight);
+            // Multiply by weight and output result, unless a strided run drops the window
+            if (gate.next()) {
+                z_out.write(pe_multiply<acc_t>(x_reg, weight));
+                counters.cycle(x_reg, weight, x_reg != 0);
+            } else {
+                z_out.write(0);
+                counters.skipped();
+            }
             
             // Forward x to next PE
             x_out.write(x_reg);
@@ -46,107 +80,203 @@ SC_MODULE(PE) {
     }
 };
 
-// Adder module to combine results from all PEs
-SC_MODULE(Adder) {
+// Pipelined adder tree combining the results of all PEs. The first level adds the
+// PE outputs in groups of fan_in, each further level adds the sums of the level
+// before in groups of fan_in, and every level ends in a register, so y_out follows
+// the PE outputs by levels() cycles and a new sum still leaves every cycle. A fan_in
+// below 2 gives one flat adder over all PEs, the original single-stage Adder.
+template <class Acc>
+SC_MODULE(AdderTree) {
     sc_in<bool> clk;
     sc_in<bool> rst;
     
-    sc_in<int> in1;  // Input from PE1
-    sc_in<int> in2;  // Input from PE2
-    sc_in<int> in3;  // Input from PE3
+    sc_vector<sc_in<Acc> > in;  // One input per PE (in[0] from PE1)
+    
+    sc_out<Acc> sum_out;  // Final sum output
     
-    sc_out<int> sum_out;  // Final sum output
+    int fan_in;           // Inputs per adder
+    std::vector<std::vector<Acc> > level;  // Pipeline registers per level, the last level holds one sum
     
-    SC_CTOR(Adder) {
+    AccStats acc_stats;   // Overflows of every partial sum
+    
+    SC_HAS_PROCESS(AdderTree);
+    AdderTree(sc_module_name name, int n, int fan_in)
+        : sc_module(name), in("in", n), fan_in(fan_in < 2 ? n : fan_in) {
+        int width = n;
+        do {
+            width = (width + this->fan_in - 1) / this->fan_in;
+            level.push_back(std::vector<Acc>(width, 0));
+        } while (width > 1);
+        
         SC_METHOD(compute);
         sensitive << clk.pos();
     }
     
+    // Register stages between the PE outputs and sum_out
+    int levels() const { return int(level.size()); }
+    
+    // Adders in the whole tree
+    int adders() const {
+        int count = 0;
+        for (size_t l = 0; l < level.size(); l++)
+            count += int(level[l].size());
+        return count;
+    }
+    
+    // Every partial sum zero
+    bool quiescent() const {
+        for (size_t l = 0; l < level.size(); l++)
+            for (size_t j = 0; j < level[l].size(); j++)
+                if (level[l][j] != 0)
+                    return false;
+        return sum_out.read() == 0;
+    }
+
+    // Registers for common/checkpoint.h, the signals are saved with the others
+    template <class Archive>
+    void checkpoint(Archive& a) {
+        a(level);
+    }
+    
     void compute() {
         if (rst.read()) {
+            for (size_t l = 0; l < level.size(); l++)
+                level[l].assign(level[l].size(), 0);
             sum_out.write(0);
         } else {
-            // Sum all inputs
-            sum_out.write(in1.read() + in2.read() + in3.read());
+            // Deepest level first, so every level adds what the one before held until this edge
+            for (size_t l = level.size(); l-- > 0;) {
+                size_t width = l ? level[l - 1].size() : in.size();
+                for (size_t j = 0; j < level[l].size(); j++) {
+                    Acc sum = 0;
+                    for (size_t k = j * fan_in; k < width && k < (j + 1) * fan_in; k++)
+                        sum = acc_stats.add(sum, l ? level[l - 1][k] : Acc(in[k].read()));
+                    level[l][j] = sum;
+                }
+            }
+            sum_out.write(level.back()[0]);
         }
     }
   
 };
 
-// Top-level systolic array module
-SC_MODULE(F_SystolicArray) {
+// Top-level systolic array module with N PEs
+template <int N, class T>
+struct SystolicArray<Design::F, N, T> : public sc_module {
+    typedef typename T::data_t data_t;
+    typedef typename T::weight_t weight_t;
+    typedef typename T::acc_t acc_t;
+
     sc_in<bool> clk;
     sc_in<bool> rst;
     
     // Input ports
-    sc_in<int> x_in;   // Input data stream
+    sc_in<data_t> x_in;   // Input data stream
     
     // Output ports
-    sc_out<int> x_out; // Output from last PE (added for completeness)
-    sc_out<int> y_out; // Final result
+    sc_out<data_t> x_out; // Output from last PE (added for completeness)
+    sc_out<acc_t> y_out;  // Final result
     
     // Processing elements
-    PE* pe1;
-    PE* pe2;
-    PE* pe3;
+    sc_vector<PE_F<T> > pe;
     
-    // Adder module
-    Adder* adder;
+    // Adder tree
+    AdderTree<acc_t>* adder;
     
     // Internal signals
-    sc_signal<int> x_sig1, x_sig2;         // x connections between PEs
-    sc_signal<int> z_out1, z_out2, z_out3;  // Multiplication results from PEs
+    sc_vector<sc_signal<data_t> > x_sig;  // x_sig[i] feeds PE(i+1), driven by PE(i+2)
+    sc_vector<sc_signal<acc_t> > z_out;   // Multiplication results from PEs
     
-    // Constructor
-    SC_CTOR(F_SystolicArray) {
+    // Constructor, fan_in is the number of inputs per adder of the adder tree (< 2 for one flat adder)
+    SC_HAS_PROCESS(SystolicArray);
+    SystolicArray(sc_module_name name, int fan_in = default_adder_fan_in)
+        : sc_module(name), pe("pe"), x_sig("x_sig", N - 1), z_out("z_out", N) {
+        static_assert(N >= 1, "systolic array needs at least one PE");
+        
         // Create the processing elements
-        pe1 = new PE("PE1");
-        pe2 = new PE("PE2");
-        pe3 = new PE("PE3");
+        pe.init(N, numbered<PE_F<T> >("PE"));
         
-        // Create the adder
-        adder = new Adder("Adder");
+        // Create the adder tree
+        adder = new AdderTree<acc_t>("Adder", N, fan_in);
         
-        // Set weights for each PE (w1, w2, w3)
-        pe1->set_weight(1); // w1
-        pe2->set_weight(2); // w2
-        pe3->set_weight(3); // w3
+        // Set weights for each PE (w1 ... wN)
+        set_weights(default_weights(N));
         
         // Connect clock and reset to all modules
-        pe1->clk(clk);
-        pe1->rst(rst);
-        pe2->clk(clk);
-        pe2->rst(rst);
-        pe3->clk(clk);
-        pe3->rst(rst);
         adder->clk(clk);
         adder->rst(rst);
         
-        // Connect input data (x flows through the system: x_in -> PE3 -> PE2 -> PE1)
-        pe3->x_in(x_in);
-        pe3->x_out(x_sig2);
-        pe2->x_in(x_sig2);
-        pe2->x_out(x_sig1);
-        pe1->x_in(x_sig1);
-        pe1->x_out(x_out); // Connect to top-level output
-        
-        // Connect multiplication results to adder
-        pe1->z_out(z_out1);
-        pe2->z_out(z_out2);
-        pe3->z_out(z_out3);
+        for (int i = 0; i < N; i++) {
+            pe[i].clk(clk);
+            pe[i].rst(rst);
+            
+            // Connect input data (x flows through the system: x_in -> PEN -> ... -> PE1)
+            if (i == N - 1)
+                pe[i].x_in(x_in);
+            else
+                pe[i].x_in(x_sig[i]);
+            if (i == 0)
+                pe[i].x_out(x_out); // Connect to top-level output
+            else
+                pe[i].x_out(x_sig[i - 1]);
+            
+            // Connect multiplication results to adder
+            pe[i].z_out(z_out[i]);
+            adder->in[i](z_out[i]);
+        }
         
-        // Connect adder inputs and output
-        adder->in1(z_out1);
-        adder->in2(z_out2);
-        adder->in3(z_out3);
+        // Connect adder output
         adder->sum_out(y_out);
     }
     
+    // Load kernel w1..wN, w1 goes to PE1
+    void set_weights(const std::vector<int>& w) {
+        for (int i = 0; i < N; i++)
+            pe[i].set_weight(w[i]);
+    }
+    
+    // Strided convolution, elaboration only: of the full windows, with sample 0 on the
+    // first cycle after reset and one sample per cycle, only y_{N-1}, y_{N-1+stride},
+    // ... are computed. Every PE works on the window of the newest sample, so all of
+    // them skip the same edges; the adder tree sums zeros for the dropped windows and
+    // y_out is 0 on their cycles. Stride 1 is the plain array.
+    void set_stride(int stride) {
+        for (int i = 0; i < N; i++)
+            pe[i].gate.set(stride, N - 1);
+    }
+    
+    // Cycles the adder tree adds between the PE products and y_out
+    int adder_levels() const {
+        return adder->levels();
+    }
+    
     // Destructor
-    ~F_SystolicArray() {
-        delete pe1;
-        delete pe2;
-        delete pe3;
+    ~SystolicArray() {
         delete adder;
     }
-};
\ No newline at end of file
+
+    // Accumulations and overflows of the adder, the PEs only multiply
+    AccStats accumulator_stats() const {
+        return adder->acc_stats;
+    }
+
+    // True if an edge with every input zero would change nothing, see common/idle_skip.h
+    bool quiescent() const {
+        return all_quiescent(pe) && adder->quiescent();
+    }
+
+    // PE and module registers for common/checkpoint.h; its signals are walked separately
+    template <class Archive>
+    void checkpoint(Archive& a) {
+        checkpoint_all(a, pe);
+        adder->checkpoint(a);
+    }
+
+    // Per-PE utilization table at sc_stop(), only with -DPE_COUNTERS, and any overflows
+    void end_of_simulation() {
+        report_pe_counters(name(), pe);
+        report_acc_overflows(name(), accumulator_stats());
+    }
+};
+
+typedef SystolicArray<Design::F, 3> F_SystolicArray;
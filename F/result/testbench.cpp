@@ -1,119 +1,126 @@
 #include <systemc.h>
 #include <iostream>
+#include <vector>
 #include "design.cpp"
+#include "../../common/cycle.h"
+#include "../../common/golden_checker.h"
+#include "../../common/trace.h"
 
 // Testbench for the F Systolic Array
 SC_MODULE(Testbench) {
-    sc_out<bool> clk;
+    sc_in<bool> clk;
     sc_out<bool> rst;
     sc_out<int> x_in;
     sc_in<int> x_out;
     sc_in<int> y_out;
-    
-    SC_CTOR(Testbench) {
-        SC_THREAD(clock_gen);
-        SC_THREAD(stimulus);
-        SC_THREAD(monitor);
-    }
-    
-    void clock_gen() {
-        clk.write(false);
-        while(1) {
-            wait(5, SC_NS);
-            clk.write(!clk.read());
-        }
+
+    std::vector<CycleIn> schedule;  // Inputs for each rising clock edge
+    size_t next_input;              // Next schedule entry to drive
+    size_t edges;                   // Rising edges seen by the monitor
+    GoldenChecker checker;          // Expected y_out of every sample
+    bool passed;                    // Set by the checker once the schedule has run
+
+    SC_CTOR(Testbench)
+        : next_input(0), edges(0), checker(GoldenChecker::for_design(Design::F, 3, 5)), passed(false) {
+        build_schedule();
+
+        // Inputs change on the falling edge, the array samples them on the rising edge
+        SC_METHOD(stimulus);
+        sensitive << clk.neg();
+
+        SC_METHOD(monitor);
+        sensitive << clk.pos();
+        dont_initialize();
     }
-    
-    void stimulus() {
-        // Reset the system
-        rst.write(true);
-        x_in.write(0);  // Initialize x input to 0
-        wait(15, SC_NS);
-        rst.write(false);
-        
+
+    void build_schedule() {
+        // Reset the system (x input held at 0)
+        schedule.push_back(cycle(true, 0));
+
         // Test sequence - providing inputs every cycle (not every 2 cycles like W1)
         // We'll send x1, x2, x3, x4, x5 values
-        
-        // Cycle 1: Send x1
-        x_in.write(1);  // x1 = 1
-        wait(10, SC_NS); // Wait 1 clock cycle
-        
-        // Cycle 2: Send x2
-        x_in.write(2);  // x2 = 2
-        wait(10, SC_NS); // Wait 1 clock cycle
-        
-        // Cycle 3: Send x3
-        x_in.write(3);  // x3 = 3
-        wait(10, SC_NS); // Wait 1 clock cycle
-        
-        // Cycle 4: Send x4
-        x_in.write(4);  // x4 = 4
-        wait(10, SC_NS); // Wait 1 clock cycle
-        
-        // Cycle 5: Send x5
-        x_in.write(5);  // x5 = 5
-        wait(10, SC_NS); // Wait 1 clock cycle
-        
+        const int x[] = {1, 2, 3, 4, 5};
+        for (int v : x)
+            schedule.push_back(cycle(false, v));
+
         // Send a few more inputs to flush the pipeline
-        x_in.write(0);
-        wait(70, SC_NS);
-        
-        // End simulation
-        sc_stop();
+        for (int i = 0; i < 8; i++)
+            schedule.push_back(cycle(false, 0));
+    }
+
+    static CycleIn cycle(bool reset, int x) {
+        CycleIn in = { reset, x, 0, 0, false };
+        return in;
+    }
+
+    // Drive the inputs for the next rising edge
+    void stimulus() {
+        if (next_input < schedule.size()) {
+            const CycleIn& in = schedule[next_input++];
+            rst.write(in.rst);
+            x_in.write(in.x);
+        }
     }
-    
+
+    // Check y_out against the golden model, printing only mismatches and the summary.
+    // The samples are x1..x5 on cycles 1-5.
     void monitor() {
-        cout << "Time\tx_in\ty_out" << endl;
-        while(true) {
-            wait(clk.posedge_event());
-            cout << sc_time_stamp() << "\t" 
-                 << x_in.read() << "\t" 
-                 << y_out.read() << endl;
+        if (edges > 0)
+            checker.output(edges - 1, y_out.read());
+        if (edges >= 1 && edges < 6)
+            checker.sample(edges, x_in.read());
+
+        // End simulation once the whole schedule has been sampled
+        if (++edges == schedule.size()) {
+            passed = checker.finish();
+            sc_stop();
         }
     }
 };
 
 // Main function
 int sc_main(int argc, char* argv[]) {
+    // Clock with the first rising edge at 5 ns, 10 ns period
+    sc_clock clk_sig("clk", 10, SC_NS, 0.5, 5, SC_NS, true);
+
     // Signals for connecting modules
-    sc_signal<bool> clk_sig, rst_sig;
+    sc_signal<bool> rst_sig;
     sc_signal<int> x_in_sig;
     sc_signal<int> x_out_sig, y_out_sig;
-    
+
     // Instantiate modules
     F_SystolicArray systolic_array("F_SystolicArray");
     Testbench tb("Testbench");
-    
+
     // Connect signals
     systolic_array.clk(clk_sig);
     systolic_array.rst(rst_sig);
     systolic_array.x_in(x_in_sig);
     systolic_array.x_out(x_out_sig);
     systolic_array.y_out(y_out_sig);
-    
+
     tb.clk(clk_sig);
     tb.rst(rst_sig);
     tb.x_in(x_in_sig);
     tb.x_out(x_out_sig);
     tb.y_out(y_out_sig);
-    
-    // Create VCD trace file
-    sc_trace_file* tf = sc_create_vcd_trace_file("f_systolic_array");
-    
-    // Add signals to trace
-    sc_trace(tf, clk_sig, "clk");
-    sc_trace(tf, rst_sig, "rst");
-    sc_trace(tf, x_in_sig, "x_in");
-    sc_trace(tf, y_out_sig, "y_out");
-    
+
+    // Trace to f_systolic_array.vcd unless the command line says otherwise, see common/trace.h
+    TraceConfig trace("f_systolic_array.vcd");
+    if (!trace.parse(argc, argv))
+        return 1;
+    SignalTracer tracer("tracer", trace);
+    tracer.clk(clk_sig);
+    tracer.add("rst", rst_sig);
+    tracer.add("x_in", x_in_sig);
+    tracer.add("y_out", y_out_sig);
+    tb.checker.on_mismatch([&tracer](uint64_t cycle) { tracer.trigger(cycle); });
+
     // Start simulation
     cout << "Starting F systolic array simulation..." << endl;
     sc_start();
-    
-    // Close trace file
-    sc_close_vcd_trace_file(tf);
-    
+
     cout << "Simulation completed." << endl;
-    
-    return 0;
-}
\ No newline at end of file
+
+    return tb.passed ? 0 : 1;
+}
@@ -1,30 +1,47 @@
 #include <systemc.h>
+#include <deque>
+#include <vector>
+#include "../../common/systolic_array.h"
 
 // Processing Element (PE) module
-SC_MODULE(PE) {
+template <class T = IntTypes>
+SC_MODULE(PE_R1) {
+    typedef typename T::data_t data_t;
+    typedef typename T::weight_t weight_t;
+    typedef typename T::acc_t acc_t;
+
     sc_in<bool> clk;
     sc_in<bool> rst;
+    sc_in<bool> en;        // Clock enable, low while the output FIFO is full
   
-    sc_in<int> x_in;       // Input data
-    sc_in<int> w_in;       // Moving weight input
+    sc_in<data_t> x_in;    // Input data
+    sc_in<weight_t> w_in;  // Moving weight input
     sc_in<bool> tag_in;    // Input tag bit
   
-    sc_out<int> x_out;     // Output x
-    sc_out<int> w_out;     // Moving weight output
+    sc_out<data_t> x_out;  // Output x
+    sc_out<weight_t> w_out; // Moving weight output
     sc_out<bool> tag_out;  // Output tag bit
   
-    sc_out<int> y_out;     // Output data
+    sc_out<acc_t> y_out;   // Output data
+    sc_out<bool> y_valid;  // y_out holds a result, set on the tag flush
 
     // Internal registers
-    int w_reg;             // Register for input weight
+    weight_t w_reg;        // Register for input weight
     int tag_reg;           // Register for input tag
-    int x;
-    int y;                 // Output accumulator
-    int x_reg;             // Added x_reg
-    int mult_result_reg;   // Added mult_result_reg
+    data_t x;
+    acc_t y;               // Output accumulator
+    data_t x_reg;          // Added x_reg
+    acc_t mult_result_reg; // Added mult_result_reg
+
+    PeCounters counters;   // Activity counters, live only with -DPE_COUNTERS
+    AccStats acc_stats;    // Overflows of y
+
+    // Registers a clocked cycle writes and values it hands on, for common/energy.h
+    static const int register_writes = 5;
+    static const int forwarding_hops = 4;
 
     // Constructor
-    SC_CTOR(PE) {
+    SC_CTOR(PE_R1) {
         SC_METHOD(compute);
         sensitive << clk.pos();
         sensitive << rst.pos();
@@ -36,6 +53,24 @@ SC_MODULE(PE) {
         mult_result_reg = 0;
     }
   
+    // Registers and outputs at rest, an edge with all inputs zero changes nothing.
+    // A partial sum in y waits for the next tag and survives such edges.
+    bool quiescent() const {
+        return w_reg == 0 && tag_reg == 0 && x_out.read() == 0 && w_out.read() == 0 && !tag_out.read() &&
+               y_out.read() == 0 && !y_valid.read();
+    }
+
+    // Registers for common/checkpoint.h
+    template <class Archive>
+    void checkpoint(Archive& a) {
+        a(w_reg);
+        a(tag_reg);
+        a(x);
+        a(y);
+        a(x_reg);
+        a(mult_result_reg);
+    }
+    
     // Compute function implementing the PE logic
     void compute() {
         if (rst.read()) {
@@ -46,179 +81,280 @@ SC_MODULE(PE) {
             tag_reg = 0;
             y = 0;
             y_out.write(0);
-        } else if (clk.read()) {
+            y_valid.write(false);
+        } else if (clk.read() && en.read()) {
             if (tag_in.read()){
               // If tag is high, ouput y_out = y, reset PE
               y_out.write(y);
+              y_valid.write(true);
               y = 0;
               w_reg = 0;
               tag_reg = 0;
+              counters.tag_flush();
             } else {
               // If tag is low, ouput y_out = 0
               y_out.write(0);
+              y_valid.write(false);
             }
             
             // Register inputs
             x = x_in.read();
             w_reg = w_in.read();
             tag_reg = tag_in.read();
-            y = x*w_reg + y;
+            y = acc_stats.add(pe_multiply<acc_t>(x, w_reg), y);
             
             // Forward weight and tag signals
             w_out.write(w_reg);
             tag_out.write(tag_reg);
             x_out.write(x);
+            counters.cycle(x, w_reg, x != 0 || w_reg != 0);
         }
     }
 };
 
-// Systolic Output Logic module with multiplexers
-SC_MODULE(OutputLogic) {
+// Systolic Output Logic module with multiplexers. Each register carries the valid
+// bit of its PE output, so a zero result is kept and an empty stage is told apart
+// from data. Results leave through a FIFO with a valid/ready handshake on y_out;
+// while the FIFO is full and y_ready is low, enable stalls the whole array.
+template <class Acc>
+SC_MODULE(OutputLogic_R1) {
     sc_in<bool> clk;
     sc_in<bool> rst;
     
-    // Inputs from PEs
-    sc_in<int> y_out1;  // From PE1 (leftmost)
-    sc_in<int> y_out2;  // From PE2 (middle)
-    sc_in<int> y_out3;  // From PE3 (rightmost)
+    // Inputs from PEs (y_pe[0] from PE1, leftmost)
+    sc_vector<sc_in<Acc> > y_pe;
+    sc_vector<sc_in<bool> > valid_pe;
+    
+    // Final output and its handshake, the consumer takes y_out at a rising edge with y_ready high
+    sc_out<Acc> y_out;
+    sc_out<bool> y_valid;
+    sc_in<bool> y_ready;
     
-    // Final output
-    sc_out<int> y_out;
+    // High if the array advances at the next rising edge: in_ready for the producer, enable for the PEs
+    sc_out<bool> in_ready;
+    sc_out<bool> enable;
     
-    // Three registers for systolic output
-    int reg1, reg2, reg3;
+    // One register per PE for systolic output
+    int n;
+    std::vector<Acc> reg;
+    std::vector<bool> reg_valid;
+    
+    // Results waiting for the consumer
+    std::deque<Acc> fifo;
+    size_t depth;
+    sc_signal<bool> full;
     
     // Constructor
-    SC_CTOR(OutputLogic) {
+    SC_HAS_PROCESS(OutputLogic_R1);
+    OutputLogic_R1(sc_module_name name, int n, int depth)
+        : sc_module(name), y_pe("y_pe", n), valid_pe("valid_pe", n), n(n), depth(depth) {
         // Initialize registers
-        reg1 = 0;
-        reg2 = 0;
-        reg3 = 0;
+        reg.assign(n, 0);
+        reg_valid.assign(n, false);
         
         // Process sensitive to clock and reset
         SC_METHOD(process_output);
         sensitive << clk.pos();
         sensitive << rst.pos();
+        
+        SC_METHOD(update_ready);
+        sensitive << full << y_ready;
     }
     
     // Process output function using multiplexers
     void process_output() {
         if (rst.read()) {
             // Reset all registers
-            reg1 = 0;
-            reg2 = 0;
-            reg3 = 0;
+            reg.assign(n, 0);
+            reg_valid.assign(n, false);
+            fifo.clear();
             y_out.write(0);
+            y_valid.write(false);
+            full.write(false);
         } else if (clk.read()) {
-            // Update registers using multiplexers
-            // For each stage, select PE output if it's non-zero, otherwise select previous register
+            // The consumer took the head shown since the last edge
+            if (y_ready.read() && !fifo.empty())
+                fifo.pop_front();
             
-            // First register (can only get input from PE1)
-            reg1 = y_out1.read();
-            
-            // Second register (choose between reg1 and PE2)
-            int pe2_val = y_out2.read();
-            reg2 = (pe2_val != 0) ? pe2_val : reg1;
-            
-            // Third register (choose between reg2 and PE3)
-            int pe3_val = y_out3.read();
-            reg3 = (pe3_val != 0) ? pe3_val : reg2;
+            if (enable.read()) {
+                // Update registers using multiplexers
+                // For each stage, select PE output if it's valid, otherwise select previous register
+                
+                // First register (can only get input from PE1)
+                reg[0] = y_pe[0].read();
+                reg_valid[0] = valid_pe[0].read();
+                
+                // Register i (choose between register i-1 and PE i+1)
+                for (int i = 1; i < n; i++) {
+                    bool pe_valid = valid_pe[i].read();
+                    reg[i] = pe_valid ? y_pe[i].read() : reg[i - 1];
+                    reg_valid[i] = pe_valid || reg_valid[i - 1];
+                }
+                
+                if (reg_valid[n - 1])
+                    fifo.push_back(reg[n - 1]);
+            }
             
-            // Write final output
-            y_out.write(reg3);
+            // Write final output, the last register while there is nothing to hand over
+            y_out.write(fifo.empty() ? reg[n - 1] : fifo.front());
+            y_valid.write(!fifo.empty());
+            full.write(fifo.size() >= depth);
         }
     }
+    
+    // Nothing staged, queued or shown
+    bool quiescent() const {
+        for (int i = 0; i < n; i++)
+            if (reg[i] != 0 || reg_valid[i])
+                return false;
+        return fifo.empty() && y_out.read() == 0 && !y_valid.read();
+    }
+
+    // Registers for common/checkpoint.h, the signals are saved with the others
+    template <class Archive>
+    void checkpoint(Archive& a) {
+        a(reg);
+        a(reg_valid);
+        a(fifo);
+    }
+    
+    // A full FIFO can still take a result at an edge where the consumer takes one
+    void update_ready() {
+        bool ready = !full.read() || y_ready.read();
+        in_ready.write(ready);
+        enable.write(ready);
+    }
 };
 
-// Top-level systolic array module
-SC_MODULE(R1_SystolicArray) {
+// Top-level systolic array module with N PEs
+template <int N, class T>
+struct SystolicArray<Design::R1, N, T> : public sc_module {
+    typedef typename T::data_t data_t;
+    typedef typename T::weight_t weight_t;
+    typedef typename T::acc_t acc_t;
+
     sc_in<bool> clk;
     sc_in<bool> rst;
     
     // Input ports
-    sc_in<int> x_in;   // Input data stream
-    sc_in<int> w_in;
+    sc_in<data_t> x_in;   // Input data stream
+    sc_in<weight_t> w_in;
     sc_in<bool> tag_in;
     
     // Output ports
-    sc_out<int> x_out; // Forwarded data
-    sc_out<int> w_out;
+    sc_out<data_t> x_out; // Forwarded data
+    sc_out<weight_t> w_out;
     sc_out<bool> tag_out;
-    sc_out<int> y_out; // Final result
+    sc_out<acc_t> y_out;  // Final result
+    sc_out<bool> y_valid; // y_out holds a result not yet taken
+    sc_in<bool> y_ready;  // Consumer takes y_out at the rising edge, tie high to stream at full rate
+    sc_out<bool> in_ready; // x_in, w_in and tag_in are taken at the rising edge, hold them otherwise
     
     // Processing elements
-    PE* pe1;
-    PE* pe2;
-    PE* pe3;
+    sc_vector<PE_R1<T> > pe;
     
     // Output logic module
-    OutputLogic* output_logic;
+    OutputLogic_R1<acc_t>* output_logic;
     
     // Internal signals for connecting PEs
-    sc_signal<int> x_sig1, x_sig2;  // x connections between PEs
-    sc_signal<int> w_sig1, w_sig2;  // w connections between PEs
-    sc_signal<bool> tag_sig1, tag_sig2;  // tag connections between PEs
+    sc_vector<sc_signal<data_t> > x_sig;     // x_sig[i] connects PE(i+1) to PE(i+2)
+    sc_vector<sc_signal<weight_t> > w_sig;     // w_sig[i] feeds PE(i+1), driven by PE(i+2)
+    sc_vector<sc_signal<bool> > tag_sig;  // tag_sig[i] feeds PE(i+1), driven by PE(i+2)
     
     // Signals for PE outputs
-    sc_signal<int> y_out1, y_out2, y_out3;
+    sc_vector<sc_signal<acc_t> > y_pe;
+    sc_vector<sc_signal<bool> > valid_pe;
+    
+    // Clock enable of every PE
+    sc_signal<bool> enable;
     
     // Constructor
-    SC_CTOR(R1_SystolicArray) {
+    SC_CTOR(SystolicArray)
+        : pe("pe"), x_sig("x_sig", N - 1), w_sig("w_sig", N - 1), tag_sig("tag_sig", N - 1), y_pe("y_pe", N),
+          valid_pe("valid_pe", N) {
+        static_assert(N >= 1, "systolic array needs at least one PE");
+        
         // Create the processing elements
-        pe1 = new PE("PE1");
-        pe2 = new PE("PE2");
-        pe3 = new PE("PE3");
+        pe.init(N, numbered<PE_R1<T> >("PE"));
         
-        // Create output logic module
-        output_logic = new OutputLogic("OutputLogic");
+        // Create output logic module, its FIFO holds one result per PE
+        output_logic = new OutputLogic_R1<acc_t>("OutputLogic", N, N);
         
         // Connect clock and reset to all modules
-        pe1->clk(clk);
-        pe1->rst(rst);
-        pe2->clk(clk);
-        pe2->rst(rst);
-        pe3->clk(clk);
-        pe3->rst(rst);
         output_logic->clk(clk);
         output_logic->rst(rst);
+        output_logic->enable(enable);
         
-        // Connect the input registers and PEs
-        pe3->w_in(w_in);       // Input w goes to rightmost PE (PE3)
-        pe3->w_out(w_sig2);    // PE3 output to PE2
-        pe2->w_in(w_sig2);     // PE2 input from PE3
-        pe2->w_out(w_sig1);    // PE2 output to PE1
-        pe1->w_in(w_sig1);     // PE1 input from PE2
-        pe1->w_out(w_out);     // PE1 output
-        
-        pe1->x_in(x_in);       // Initial x goes to leftmost PE (PE1)
-        pe1->x_out(x_sig1);    // PE1 output to PE2
-        pe2->x_in(x_sig1);     // PE2 input from PE1
-        pe2->x_out(x_sig2);    // PE2 output to PE3
-        pe3->x_in(x_sig2);     // PE3 input from PE2
-        pe3->x_out(x_out);     // PE3 output to external port
-      
-        pe3->tag_in(tag_in);       // Input tag goes to rightmost PE (PE3)
-        pe3->tag_out(tag_sig2);    // PE3 output to PE2
-        pe2->tag_in(tag_sig2);     // PE2 input from PE3
-        pe2->tag_out(tag_sig1);    // PE2 output to PE1
-        pe1->tag_in(tag_sig1);     // PE1 input from PE2
-        pe1->tag_out(tag_out);     // PE1 output to external port
-        
-        // Connect PE outputs to output logic module
-        pe1->y_out(y_out1);
-        pe2->y_out(y_out2);
-        pe3->y_out(y_out3);
-        output_logic->y_out1(y_out1);
-        output_logic->y_out2(y_out2);
-        output_logic->y_out3(y_out3);
+        for (int i = 0; i < N; i++) {
+            pe[i].clk(clk);
+            pe[i].rst(rst);
+            pe[i].en(enable);
+            
+            // Weight and tag flow from right to left: PEN -> ... -> PE1
+            if (i == N - 1) {
+                pe[i].w_in(w_in);       // Input w goes to rightmost PE
+                pe[i].tag_in(tag_in);   // Input tag goes to rightmost PE
+            } else {
+                pe[i].w_in(w_sig[i]);
+                pe[i].tag_in(tag_sig[i]);
+            }
+            if (i == 0) {
+                pe[i].w_out(w_out);     // PE1 output to external port
+                pe[i].tag_out(tag_out);
+            } else {
+                pe[i].w_out(w_sig[i - 1]);
+                pe[i].tag_out(tag_sig[i - 1]);
+            }
+            
+            // Data flows from left to right: PE1 -> ... -> PEN
+            if (i == 0)
+                pe[i].x_in(x_in);       // Initial x goes to leftmost PE
+            else
+                pe[i].x_in(x_sig[i - 1]);
+            if (i == N - 1)
+                pe[i].x_out(x_out);     // Rightmost PE output to external port
+            else
+                pe[i].x_out(x_sig[i]);
+            
+            // Connect PE outputs to output logic module
+            pe[i].y_out(y_pe[i]);
+            pe[i].y_valid(valid_pe[i]);
+            output_logic->y_pe[i](y_pe[i]);
+            output_logic->valid_pe[i](valid_pe[i]);
+        }
         output_logic->y_out(y_out);
+        output_logic->y_valid(y_valid);
+        output_logic->y_ready(y_ready);
+        output_logic->in_ready(in_ready);
     }
     
     // Destructor
-    ~R1_SystolicArray() {
-        delete pe1;
-        delete pe2;
-        delete pe3;
+    ~SystolicArray() {
         delete output_logic;
     }
-};
\ No newline at end of file
+
+    // Accumulations and overflows summed over the PEs
+    AccStats accumulator_stats() const {
+        return total_acc_stats(pe);
+    }
+
+    // True if an edge with every input zero would change nothing, see common/idle_skip.h
+    bool quiescent() const {
+        return all_quiescent(pe) && output_logic->quiescent();
+    }
+
+    // PE and module registers for common/checkpoint.h; its signals are walked separately
+    template <class Archive>
+    void checkpoint(Archive& a) {
+        checkpoint_all(a, pe);
+        output_logic->checkpoint(a);
+    }
+
+    // Per-PE utilization table at sc_stop(), only with -DPE_COUNTERS, and any overflows
+    void end_of_simulation() {
+        report_pe_counters(name(), pe);
+        report_acc_overflows(name(), accumulator_stats());
+    }
+};
+
+typedef SystolicArray<Design::R1, 3> R1_SystolicArray;
@@ -1,170 +1,115 @@
 #include <systemc.h>
+#include <vector>
 #include "design.cpp"
+#include "../../common/cycle.h"
+#include "../../common/golden_checker.h"
+#include "../../common/trace.h"
 
-// Testbench for the R1 Systolic Array
+// Testbench for the R2 Systolic Array
 SC_MODULE(Testbench) {
-    sc_out<bool> clk;
+    sc_in<bool> clk;
     sc_out<bool> rst;
-    
+
     // Input ports
     sc_out<int> x_in;   // Input data stream
     sc_out<int> w_in;
     sc_out<bool> tag_in;
-    
+
     // Output ports
     sc_in<int> x_out; // Forwarded data
     sc_in<int> w_out;
     sc_in<bool> tag_out;
     sc_in<int> y_out; // Final result
-    
-    SC_CTOR(Testbench) {
-        SC_THREAD(clock_gen);
-        SC_THREAD(stimulus);
-        SC_THREAD(monitor);
-    }
-    
-    void clock_gen() {
-        clk.write(false);
-        while(1) {
-            wait(5, SC_NS);
-            clk.write(!clk.read());
-        }
+
+    std::vector<CycleIn> schedule;  // Inputs for each rising clock edge
+    size_t next_input;              // Next schedule entry to drive
+    size_t edges;                   // Rising edges seen by the monitor
+    GoldenChecker checker;          // Expected y_out of every sample
+    bool passed;                    // Set by the checker once the schedule has run
+
+    SC_CTOR(Testbench)
+        : next_input(0), edges(0), checker(GoldenChecker::for_design(Design::R2, 3, 8)), passed(false) {
+        build_schedule();
+
+        // Inputs change on the falling edge, the array samples them on the rising edge
+        SC_METHOD(stimulus);
+        sensitive << clk.neg();
+
+        SC_METHOD(monitor);
+        sensitive << clk.pos();
+        dont_initialize();
     }
-    
-    void stimulus() {
+
+    void build_schedule() {
         // Reset the system
-        rst.write(true);
-        x_in.write(0);  // Initialize x input to 0
-      	tag_in.write(0);
-      	w_in.write(0);
-        wait(15, SC_NS);
-        rst.write(false);
-        
+        schedule.push_back(cycle(true, 0, 0, false));
+
         // Test sequence - providing inputs every cycle (not every 2 cycles like W1)
         // We'll send x1, x2, x3, x4, x5 values
-        
-        // Cycle 1:
-        x_in.write(0);  // x1 = 0
-      	w_in.write(2);
-      	tag_in.write(0);
-        wait(10, SC_NS); // Wait 1 clock cycle
-      
-        // Cycle 2:
-        x_in.write(0);  // x1 = 0
-      	w_in.write(3);
-      	tag_in.write(0);
-        wait(10, SC_NS); // Wait 1 clock cycle
-        
-        // Cycle 3: Send x1
-        x_in.write(1);  // x1 = 1
-      	w_in.write(1);
-      	tag_in.write(1);
-        wait(10, SC_NS); // Wait 1 clock cycle
-      
-        // Cycle 4: 
-        x_in.write(2);  // x1 = 0
-      	w_in.write(2);
-      	tag_in.write(0);
-        wait(10, SC_NS); // Wait 1 clock cycle
-        
-        // Cycle 5: Send x2
-        x_in.write(3);  // x2 = 2
-      	w_in.write(3);
-      	tag_in.write(0);
-        wait(10, SC_NS); // Wait 1 clock cycle
-      
-        // Cycle 6: Stall
-        x_in.write(4);  // x1 = 0
-      	w_in.write(1);
-      	tag_in.write(1);
-        wait(10, SC_NS); // Wait 1 clock cycle
-        
-        // Cycle 7: Send x3
-        x_in.write(5);  // x3 = 3
-      	w_in.write(2);
-      	tag_in.write(0);
-        wait(10, SC_NS); // Wait 1 clock cycle
-      
-        // Cycle 8: Stall
-        x_in.write(0);  // x1 = 0
-      	w_in.write(3);
-      	tag_in.write(0);
-        wait(10, SC_NS); // Wait 1 clock cycle
-        
-        // Cycle 9: Send x4
-        x_in.write(0);  // x4 = 4
-      	w_in.write(1);
-      	tag_in.write(1);
-        wait(10, SC_NS); // Wait 1 clock cycle
-      
-//         // Cycle 10: Stall
-//         x_in.write(0);  // x1 = 0
-//       	w_in.write(2);
-//       	tag_in.write(0);
-//         wait(10, SC_NS); // Wait 1 clock cycle
-        
-//         // Cycle 11: Send x5
-//         x_in.write(0);  // x5 = 5
-//       	w_in.write(3);
-//       	tag_in.write(0);
-//         wait(10, SC_NS); // Wait 1 clock cycle
-      
-//         // Cycle 12: Stall
-//         x_in.write(0);  // x1 = 0
-//       	w_in.write(1);
-//       	tag_in.write(1);
-//         wait(10, SC_NS); // Wait 1 clock cycle
-      
-//         // Cycle 13: Stall
-//         x_in.write(0);  // x = 0
-//       	w_in.write(2);
-//       	tag_in.write(0);
-//         wait(10, SC_NS); // Wait 1 clock cycle
-      
-//         // Cycle 14: Stall
-//         x_in.write(0);  // x1 = 0
-//       	w_in.write(3);
-//       	tag_in.write(0);
-//         wait(10, SC_NS); // Wait 1 clock cycle
-      
-//         // Cycle 15: Stall
-//         x_in.write(0);  // x = 0
-//       	w_in.write(1);
-//       	tag_in.write(1);
-//         wait(10, SC_NS); // Wait 1 clock cycle
-        
+        schedule.push_back(cycle(false, 0, 2, false));  // Cycle 1
+        schedule.push_back(cycle(false, 0, 3, false));  // Cycle 2
+        schedule.push_back(cycle(false, 1, 1, true ));  // Cycle 3: Send x1
+        schedule.push_back(cycle(false, 2, 2, false));  // Cycle 4: Send x2
+        schedule.push_back(cycle(false, 3, 3, false));  // Cycle 5: Send x3
+        schedule.push_back(cycle(false, 4, 1, true ));  // Cycle 6: Send x4
+        schedule.push_back(cycle(false, 5, 2, false));  // Cycle 7: Send x5
+        schedule.push_back(cycle(false, 0, 3, false));  // Cycle 8
+        schedule.push_back(cycle(false, 0, 1, true ));  // Cycle 9
+
         // Send a few more inputs to flush the pipeline
-        x_in.write(0);
-      	w_in.write(0);
-      	tag_in.write(0);
-        wait(100, SC_NS);
-        
-        // End simulation
-        sc_stop();
+        for (int i = 0; i < 11; i++)
+            schedule.push_back(cycle(false, 0, 0, false));
     }
-    
+
+    static CycleIn cycle(bool reset, int x, int w, bool tag) {
+        CycleIn in = { reset, x, 0, w, tag };
+        return in;
+    }
+
+    // Drive the inputs for the next rising edge
+    void stimulus() {
+        if (next_input < schedule.size()) {
+            const CycleIn& in = schedule[next_input++];
+            rst.write(in.rst);
+            x_in.write(in.x);
+            w_in.write(in.w);
+            tag_in.write(in.tag);
+        }
+    }
+
+    // Check y_out against the golden model, printing only mismatches and the summary.
+    // The samples are x1..x5 and the three cycles after them, one per cycle,
+    // from cycle 3, where w1 comes with its tag. The checker leaves out the first
+    // N-1 results, before every weight is in, and the last N, which wait on a tag.
     void monitor() {
-        cout << "Time\tx_in\ty_out" << endl;
-        while(true) {
-            wait(clk.posedge_event());
-            cout << sc_time_stamp() << "\t" 
-                 << x_in.read() << "\t" 
-                 << y_out.read() << endl;
+        if (edges > 0)
+            checker.output(edges - 1, y_out.read());
+        if (edges >= 3 && edges < 11)
+            checker.sample(edges, x_in.read());
+
+        // End simulation once the whole schedule has been sampled
+        if (++edges == schedule.size()) {
+            passed = checker.finish();
+            sc_stop();
         }
     }
 };
 
 // Main function
 int sc_main(int argc, char* argv[]) {
-    // Signals for connecting modules
+    // Clock with the first rising edge at 5 ns, 10 ns period
+    sc_clock clk_sig("clk", 10, SC_NS, 0.5, 5, SC_NS, true);
 
-    sc_signal<bool> clk_sig, rst_sig, tag_in_sig, tag_out_sig;
+    // Signals for connecting modules
+    sc_signal<bool> rst_sig, tag_in_sig, tag_out_sig;
     sc_signal<int> x_in_sig, w_in_sig, x_out_sig, w_out_sig, y_out_sig;
-    
+    sc_signal<bool> y_valid_sig, y_ready_sig, in_ready_sig;
+    y_ready_sig.write(true);    // Take every result as soon as it is valid
+
     // Instantiate modules
     R2_SystolicArray systolic_array("R2_SystolicArray");
     Testbench tb("Testbench");
-    
+
     // Connect signals to the R1_SystolicArray
     systolic_array.clk(clk_sig);
     systolic_array.rst(rst_sig);
@@ -175,7 +120,10 @@ int sc_main(int argc, char* argv[]) {
     systolic_array.w_out(w_out_sig);
     systolic_array.tag_out(tag_out_sig);
     systolic_array.y_out(y_out_sig);
-    
+    systolic_array.y_valid(y_valid_sig);
+    systolic_array.y_ready(y_ready_sig);
+    systolic_array.in_ready(in_ready_sig);
+
     // Connect signals to the Testbench
     tb.clk(clk_sig);
     tb.rst(rst_sig);
@@ -186,29 +134,29 @@ int sc_main(int argc, char* argv[]) {
     tb.w_out(w_out_sig);
     tb.tag_out(tag_out_sig);
     tb.y_out(y_out_sig);
-    
-    // Create VCD trace file
-    sc_trace_file* tf = sc_create_vcd_trace_file("r2_systolic_array");
-    
-    // Add signals to trace
-    sc_trace(tf, clk_sig, "clk");
-    sc_trace(tf, rst_sig, "rst");
-    sc_trace(tf, x_in_sig, "x_in");
-    sc_trace(tf, w_in_sig, "w_in");
-    sc_trace(tf, tag_in_sig, "tag_in");
-    sc_trace(tf, y_out_sig, "y_out");
-    sc_trace(tf, x_out_sig, "x_out");
-    sc_trace(tf, w_out_sig, "w_out");
-    sc_trace(tf, tag_out_sig, "tag_out");
-    
+
+    // Trace to r2_systolic_array.vcd unless the command line says otherwise, see common/trace.h
+    TraceConfig trace("r2_systolic_array.vcd");
+    if (!trace.parse(argc, argv))
+        return 1;
+    SignalTracer tracer("tracer", trace);
+    tracer.clk(clk_sig);
+    tracer.add("rst", rst_sig);
+    tracer.add("x_in", x_in_sig);
+    tracer.add("w_in", w_in_sig);
+    tracer.add("tag_in", tag_in_sig);
+    tracer.add("y_out", y_out_sig);
+    tracer.add("y_valid", y_valid_sig);
+    tracer.add("x_out", x_out_sig);
+    tracer.add("w_out", w_out_sig);
+    tracer.add("tag_out", tag_out_sig);
+    tb.checker.on_mismatch([&tracer](uint64_t cycle) { tracer.trigger(cycle); });
+
     // Start simulation
     cout << "Starting R2 systolic array simulation..." << endl;
     sc_start();
-    
-    // Close trace file
-    sc_close_vcd_trace_file(tf);
-    
+
     cout << "Simulation completed." << endl;
-    
-    return 0;
-}
\ No newline at end of file
+
+    return tb.passed ? 0 : 1;
+}
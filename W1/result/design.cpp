@@ -1,27 +1,43 @@
 #include <systemc.h>
+#include <algorithm>
 #include <iostream>
+#include <vector>
+#include "../../common/systolic_array.h"
 
 // Processing Element (PE) module
-SC_MODULE(PE) {
+template <class T = IntTypes>
+SC_MODULE(PE_W1) {
+    typedef typename T::data_t data_t;
+    typedef typename T::weight_t weight_t;
+    typedef typename T::acc_t acc_t;
+
     sc_in<bool> clk;
     sc_in<bool> rst;
   
-    sc_in<int> x_in;       // Input data
-    sc_in<int> y_in;       // Partial sum input
-    sc_out<int> x_out;     // Forward data to next PE
-    sc_out<int> y_out;     // Forward partial sum to previous PE
+    sc_in<data_t> x_in;    // Input data
+    sc_in<acc_t> y_in;     // Partial sum input
+    sc_out<data_t> x_out;  // Forward data to next PE
+    sc_out<acc_t> y_out;   // Forward partial sum to previous PE
 
-    int weight;            // Fixed weight for this PE
+    weight_t weight;       // Fixed weight for this PE
 
     // Internal registers
-    int x_reg;             // Register for input data
-    int mult_result_reg;   // Register for multiplication result
-    int y_reg;             // Register for output data
+    data_t x_reg;          // Register for input data
+    std::vector<data_t> x_delay;  // Dilation: 2 * (dilation - 1) more registers before x_out
+    acc_t mult_result_reg; // Register for multiplication result
+    acc_t y_reg;           // Register for output data
   
-  	int sum;
+  	acc_t sum;
+
+    PeCounters counters;   // Activity counters, live only with -DPE_COUNTERS
+    AccStats acc_stats;    // Overflows of sum
+
+    // Registers a clocked cycle writes and values it hands on, for common/energy.h
+    static const int register_writes = 4;
+    static const int forwarding_hops = 2;
 
     // Constructor
-    SC_CTOR(PE) {
+    SC_CTOR(PE_W1) {
         SC_METHOD(compute);
         sensitive << clk.pos();
         sensitive << rst.pos();
@@ -36,104 +52,393 @@ SC_MODULE(PE) {
         weight = w;
     }
 
+    // Registers and outputs at rest, an edge with all inputs zero changes nothing
+    bool quiescent() const {
+        return x_reg == 0 && mult_result_reg == 0 && y_reg == 0 && x_out.read() == 0 && y_out.read() == 0 &&
+               std::count(x_delay.begin(), x_delay.end(), data_t(0)) == std::ptrdiff_t(x_delay.size());
+    }
+
+    // x takes 2 * dilation - 1 cycles through the PE instead of 1
+    void set_dilation(int dilation) {
+        x_delay.assign(dilation > 1 ? 2 * (dilation - 1) : 0, data_t(0));
+    }
+
+    // Registers for common/checkpoint.h
+    template <class Archive>
+    void checkpoint(Archive& a) {
+        a(weight);
+        a(x_reg);
+        a(x_delay);
+        a(mult_result_reg);
+        a(y_reg);
+        a(sum);
+    }
+    
     // Compute function implementing the PE logic
     void compute() {
         if (rst.read()) {
             // Reset all registers
             x_reg = 0;
+            std::fill(x_delay.begin(), x_delay.end(), data_t(0));
             mult_result_reg = 0;
             y_reg = 0;
             x_out.write(0);
             y_out.write(0);
         } else if (clk.read()) {
+            // Dilation registers, if any, take the sample x_reg held until now
+            if (!x_delay.empty()) {
+                std::copy_backward(x_delay.begin(), x_delay.end() - 1, x_delay.end());
+                x_delay.front() = x_reg;
+            }
+
             // Pipeline stage 1: Register input data
             x_reg = x_in.read();
             
             // Pipeline stage 2: Perform multiplication and store in register
-            mult_result_reg = x_reg * weight;
+            mult_result_reg = pe_multiply<acc_t>(x_reg, weight);
             
             // Pipeline stage 3: Register output data
             y_reg = y_in.read();
           
           	// Add multiplication result with output data
-          	sum = mult_result_reg + y_reg;
+          	sum = acc_stats.add(mult_result_reg, y_reg);
             
             // Forward data and partial sum
-            x_out.write(x_reg);
+            x_out.write(x_delay.empty() ? x_reg : x_delay.back());
             y_out.write(sum);
+            counters.cycle(x_reg, weight, x_reg != 0 || y_reg != 0);
         }
     }
 };
 
-// Top-level systolic array module
-SC_MODULE(W1_SystolicArray) {
+// Top-level systolic array module with N PEs
+template <int N, class T>
+struct SystolicArray<Design::W1, N, T> : public sc_module {
+    typedef typename T::data_t data_t;
+    typedef typename T::weight_t weight_t;
+    typedef typename T::acc_t acc_t;
+
     sc_in<bool> clk;
     sc_in<bool> rst;
     
     // Input ports
-    sc_in<int> x_in;   // Input data stream
-    sc_in<int> y_in;   // Initial partial sum (usually 0)
+    sc_in<data_t> x_in;   // Input data stream
+    sc_in<acc_t> y_in;    // Initial partial sum (usually 0)
     
     // Output ports
-    sc_out<int> x_out; // Forwarded data (not used)
-    sc_out<int> y_out; // Final result
+    sc_out<data_t> x_out; // Forwarded data (not used)
+    sc_out<acc_t> y_out;  // Final result
     
     // Processing elements
-    PE* pe1;
-    PE* pe2;
-    PE* pe3;
+    sc_vector<PE_W1<T> > pe;
     
     // Internal signals for connecting PEs
-    sc_signal<int> x_sig1, x_sig2;  // x connections between PEs
-    sc_signal<int> y_sig1, y_sig2;  // y connections between PEs
-    
+    sc_vector<sc_signal<data_t> > x_sig;  // x_sig[i] feeds PE(i+1), driven by PE(i+2)
+    sc_vector<sc_signal<acc_t> > y_sig;  // y_sig[i] connects PE(i+1) to PE(i+2)
     
     // Constructor
-    SC_CTOR(W1_SystolicArray) {
-        // Create the processing elements
-        pe1 = new PE("PE1");
-        pe2 = new PE("PE2");
-        pe3 = new PE("PE3");
+    SC_CTOR(SystolicArray) : pe("pe"), x_sig("x_sig", N - 1), y_sig("y_sig", N - 1) {
+        static_assert(N >= 1, "systolic array needs at least one PE");
         
-        // Set weights for each PE (w1, w2, w3)
-        pe1->set_weight(1); // w1
-        pe2->set_weight(2); // w2
-        pe3->set_weight(3); // w3
+        // Create the processing elements
+        pe.init(N, numbered<PE_W1<T> >("PE"));
         
-        // Connect clock and reset to all PEs
-        pe1->clk(clk);
-        pe1->rst(rst);
-        pe2->clk(clk);
-        pe2->rst(rst);
-        pe3->clk(clk);
-        pe3->rst(rst);
+        // Set weights for each PE (w1 leftmost ... wN rightmost)
+        set_weights(default_weights(N));
         
         // Connect the input registers and PEs
-        // PE3 (rightmost) -> PE2 -> PE1 (leftmost) for data flow
-        // PE1 (leftmost) -> PE2 -> PE3 (rightmost) for partial sum flow
-        
-        // Input data connections (x flows from right to left: PE3->PE2->PE1)
-        pe3->x_in(x_in);       // Input x goes to rightmost PE (PE3)
-        pe3->x_out(x_sig2);    // PE3 output to PE2
-        pe2->x_in(x_sig2);     // PE2 input from PE3
-        pe2->x_out(x_sig1);    // PE2 output to PE1
-        pe1->x_in(x_sig1);     // PE1 input from PE2
-        pe1->x_out(x_out);     // PE1 output (typically not used)
-        
-        // Partial sum connections (y flows from left to right: PE1->PE2->PE3)
-        pe1->y_in(y_in);       // Initial y (usually 0) goes to leftmost PE (PE1)
-        pe1->y_out(y_sig1);    // PE1 output to PE2
-        pe2->y_in(y_sig1);     // PE2 input from PE1
-        pe2->y_out(y_sig2);    // PE2 output to PE3
-        pe3->y_in(y_sig2);     // PE3 input from PE2
-        pe3->y_out(y_out);     // PE3 output is the final result
-
+        // PEN (rightmost) -> ... -> PE1 (leftmost) for data flow
+        // PE1 (leftmost) -> ... -> PEN (rightmost) for partial sum flow
+        for (int i = 0; i < N; i++) {
+            // Connect clock and reset to all PEs
+            pe[i].clk(clk);
+            pe[i].rst(rst);
+            
+            // Input data connections (x flows from right to left: PEN -> ... -> PE1)
+            if (i == N - 1)
+                pe[i].x_in(x_in);       // Input x goes to rightmost PE
+            else
+                pe[i].x_in(x_sig[i]);
+            if (i == 0)
+                pe[i].x_out(x_out);     // PE1 output (typically not used)
+            else
+                pe[i].x_out(x_sig[i - 1]);
+            
+            // Partial sum connections (y flows from left to right: PE1 -> ... -> PEN)
+            if (i == 0)
+                pe[i].y_in(y_in);       // Initial y (usually 0) goes to leftmost PE
+            else
+                pe[i].y_in(y_sig[i - 1]);
+            if (i == N - 1)
+                pe[i].y_out(y_out);     // Rightmost PE output is the final result
+            else
+                pe[i].y_out(y_sig[i]);
+        }
     }
     
-    // Destructor
-    ~W1_SystolicArray() {
-        delete pe1;
-        delete pe2;
-        delete pe3;
+    // Load kernel w1..wN, w1 goes to the leftmost PE
+    void set_weights(const std::vector<int>& w) {
+        for (int i = 0; i < N; i++)
+            pe[i].set_weight(w[i]);
+    }
+
+    // Dilated convolution, elaboration only: y_i = w1 * x[i - (N-1) * dilation] + ...
+    // + wN * x[i], one sample every two cycles as before. x and the partial sums
+    // counter-flow one cycle per PE each, so a partial sum meets a sample one older
+    // (two cycles) at the next PE; with 2 * (dilation - 1) more x registers per PE x
+    // takes 2 * dilation - 1 cycles and the partial sum meets the sample `dilation`
+    // older. N PEs then do the work of a kernel (N-1) * dilation + 1 taps long with
+    // zeros between the weights. Dilation 1 is the plain array.
+    void set_dilation(int dilation) {
+        for (int i = 0; i < N; i++)
+            pe[i].set_dilation(dilation);
+    }
+
+    // Accumulations and overflows summed over the PEs
+    AccStats accumulator_stats() const {
+        return total_acc_stats(pe);
+    }
+
+    // True if an edge with every input zero would change nothing, see common/idle_skip.h
+    bool quiescent() const {
+        return all_quiescent(pe);
+    }
+
+    // PE and module registers for common/checkpoint.h; its signals are walked separately
+    template <class Archive>
+    void checkpoint(Archive& a) {
+        checkpoint_all(a, pe);
+    }
+
+    // Per-PE utilization table at sc_stop(), only with -DPE_COUNTERS, and any overflows
+    void end_of_simulation() {
+        report_pe_counters(name(), pe);
+        report_acc_overflows(name(), accumulator_stats());
+    }
+};
+
+typedef SystolicArray<Design::W1, 3> W1_SystolicArray;
+
+// Two independent convolution streams through one W1 array. x moves left and the
+// partial sums right, so a partial sum leaving PE1 on an even cycle only meets
+// samples that entered on even cycles, and one leaving on an odd cycle only odd
+// ones. Channel A therefore takes the even input cycles after reset and channel B
+// the odd ones that a single stream leaves empty, with no change to the PEs, and
+// y_out alternates between A and B results. The demux registers each result into
+// its channel's output one cycle after it appears on y_out.
+template <int N, class T = IntTypes>
+struct W1_Interleaved : public sc_module {
+    typedef typename T::data_t data_t;
+    typedef typename T::acc_t acc_t;
+
+    sc_in<bool> clk;
+    sc_in<bool> rst;
+
+    sc_in<data_t> x_a;    // Channel A sample, taken on A cycles
+    sc_in<data_t> x_b;    // Channel B sample, taken on B cycles
+    sc_out<acc_t> y_a;    // Latest channel A result
+    sc_out<acc_t> y_b;    // Latest channel B result
+
+    SystolicArray<Design::W1, N, T> array;
+
+    sc_signal<bool> phase_b;      // The next rising edge is a channel B cycle
+    sc_signal<data_t> x_mux;      // Array input, x_a or x_b
+    sc_signal<acc_t> y_zero;      // Initial partial sum
+    sc_signal<data_t> x_unused;
+    sc_signal<acc_t> y_mux;       // Array output, A and B results alternating
+
+    bool out_b;                // y_mux holds a channel B result
+
+    SC_CTOR(W1_Interleaved) : array("array"), out_b(false) {
+        array.clk(clk);
+        array.rst(rst);
+        array.x_in(x_mux);
+        array.y_in(y_zero);
+        array.x_out(x_unused);
+        array.y_out(y_mux);
+
+        SC_METHOD(select);
+        sensitive << phase_b << x_a << x_b;
+
+        SC_METHOD(demux);
+        sensitive << clk.pos();
+        dont_initialize();
+    }
+
+    // Input mux for the next rising edge
+    void select() {
+        x_mux.write(phase_b.read() ? x_b.read() : x_a.read());
+    }
+
+    // y_mux still holds the result of the previous edge, whose channel is out_b
+    void demux() {
+        if (rst.read()) {
+            phase_b.write(false);
+            out_b = false;
+            y_a.write(0);
+            y_b.write(0);
+            return;
+        }
+        if (out_b)
+            y_b.write(y_mux.read());
+        else
+            y_a.write(y_mux.read());
+        out_b = phase_b.read();
+        phase_b.write(!phase_b.read());
+    }
+};
+
+// Weight-stationary ROWS x COLS matrix engine from W1 PEs: PE(i, j) holds weight
+// B[i][j] and computes one term of C = A * B for the row of A passing through it.
+// Row i of A enters at the left of PE row i and moves one PE right per cycle, and
+// the partial sums move one PE down per cycle, so column j's bottom PE puts out
+// sum over i of A[m][i] * B[i][j] for each row m. Triangular register banks skew
+// the rows of A on the way in (row i i cycles late) and line the columns of C up
+// again on the way out (column j COLS-1-j cycles late), so a_in takes a whole row
+// of A per cycle and c_out shows a whole row of C `latency` cycles later.
+//
+// Weights shift in through w_load / w_in, one row of B per cycle from the top,
+// the last row of B first, so a new B takes ROWS cycles. The weight registers are
+// signals, so the PEs multiply with the weights from before a load edge on that edge
+// and with the new ones from the next. The shift changes every PE's weight at once,
+// so the rows of A of the previous B must have left the array, `latency` cycles
+// after the last one went in, before it starts; a load edge with a nonzero row of A
+// still in the array is reported as an error.
+template <int ROWS, int COLS, class T = IntTypes>
+struct W1_Gemm : public sc_module {
+    typedef typename T::data_t data_t;
+    typedef typename T::weight_t weight_t;
+    typedef typename T::acc_t acc_t;
+
+    sc_in<bool> clk;
+    sc_in<bool> rst;
+
+    sc_vector<sc_in<data_t> > a_in;     // One row of A per cycle, a_in[i] = A[m][i]
+    sc_vector<sc_out<acc_t> > c_out;    // One row of C per cycle, c_out[j] = C[m][j]
+
+    sc_in<bool> w_load;                 // Shift w_in into the top PE row this cycle
+    sc_vector<sc_in<weight_t> > w_in;   // One row of B, w_in[j] = B[i][j]
+
+    // Cycles from a row of A on a_in to its row of C on c_out, through the skew, the
+    // diagonal of the array and the deskew
+    static const int latency = ROWS + COLS - 2;
+
+    sc_vector<PE_W1<T> > pe;            // PE(i, j) is pe[i * COLS + j]
+
+    sc_vector<sc_signal<data_t> > x_sig;    // Into PE(i, j) from the left, i * COLS + j
+    sc_vector<sc_signal<acc_t> > y_sig;     // Into PE(i, j) from above, (i + 1) rows for the bottom outputs
+    sc_vector<sc_signal<data_t> > x_unused; // Out of the right column
+
+    std::vector<std::vector<data_t> > skew;     // skew[i]: the i registers of row i
+    std::vector<std::vector<acc_t> > deskew;    // deskew[j]: the COLS-1-j registers of column j
+    sc_vector<sc_signal<weight_t> > w_reg;      // PE(i, j)'s weight register at i * COLS + j
+    uint64_t a_in_flight;   // Edges until the last nonzero row of A has been through every PE
+
+    SC_CTOR(W1_Gemm)
+        : a_in("a_in", ROWS), c_out("c_out", COLS), w_in("w_in", COLS), pe("pe"), x_sig("x_sig", ROWS * COLS),
+          y_sig("y_sig", (ROWS + 1) * COLS), x_unused("x_unused", ROWS), skew(ROWS), deskew(COLS),
+          w_reg("w_reg", ROWS * COLS), a_in_flight(0) {
+        static_assert(ROWS >= 1 && COLS >= 1, "matrix engine needs at least one PE");
+        pe.init(ROWS * COLS, numbered<PE_W1<T> >("PE"));
+        for (int i = 0; i < ROWS; i++)
+            skew[i].resize(i, 0);
+        for (int j = 0; j < COLS; j++)
+            deskew[j].resize(COLS - 1 - j, 0);
+
+        // y_sig[j] is the top row's partial sum input, held at 0, and y_sig[ROWS * COLS + j]
+        // the bottom of column j. Row 0 of A and column COLS-1 of C need no registers.
+        for (int i = 0; i < ROWS; i++) {
+            for (int j = 0; j < COLS; j++) {
+                PE_W1<T>& p = pe[i * COLS + j];
+                p.clk(clk);
+                p.rst(rst);
+                p.set_weight(0);
+                if (i == 0 && j == 0)
+                    p.x_in(a_in[0]);
+                else
+                    p.x_in(x_sig[i * COLS + j]);
+                if (j == COLS - 1)
+                    p.x_out(x_unused[i]);
+                else
+                    p.x_out(x_sig[i * COLS + j + 1]);
+                p.y_in(y_sig[i * COLS + j]);
+                if (i == ROWS - 1 && j == COLS - 1)
+                    p.y_out(c_out[j]);
+                else
+                    p.y_out(y_sig[(i + 1) * COLS + j]);
+            }
+        }
+
+        SC_METHOD(shift);
+        sensitive << clk.pos();
+        sensitive << rst.pos();
+
+        // A delta after the edge that wrote them, once every PE has computed on it
+        SC_METHOD(update_weights);
+        for (int k = 0; k < ROWS * COLS; k++)
+            sensitive << w_reg[k];
+        dont_initialize();
+    }
+
+    // Load B (ROWS x COLS, row-major) at once, for setting up a run without w_load
+    void set_weights(const std::vector<int>& b) {
+        for (int k = 0; k < ROWS * COLS; k++) {
+            w_reg[k].write(b[k]);
+            pe[k].set_weight(b[k]);
+        }
+    }
+
+    void update_weights() {
+        for (int k = 0; k < ROWS * COLS; k++)
+            pe[k].set_weight(w_reg[k].read());
+    }
+
+    void shift() {
+        if (rst.read()) {
+            for (int i = 1; i < ROWS; i++) {
+                std::fill(skew[i].begin(), skew[i].end(), data_t(0));
+                x_sig[i * COLS].write(0);
+            }
+            a_in_flight = 0;
+            for (int j = 0; j < COLS - 1; j++) {
+                std::fill(deskew[j].begin(), deskew[j].end(), acc_t(0));
+                c_out[j].write(0);
+            }
+        } else if (clk.read()) {
+            // The row taking this edge is multiplied on it and the next `latency` edges
+            if (a_in_flight)
+                a_in_flight--;
+            for (int i = 0; i < ROWS; i++)
+                if (a_in[i].read() != 0)
+                    a_in_flight = latency + 1;
+            if (w_load.read() && a_in_flight > 1)
+                SC_REPORT_ERROR(name(), "w_load while a row of A is still in the array");
+
+            for (int i = 1; i < ROWS; i++) {
+                std::vector<data_t>& r = skew[i];
+                for (int s = i - 1; s > 0; s--)
+                    r[s] = r[s - 1];
+                r[0] = a_in[i].read();
+                x_sig[i * COLS].write(r[i - 1]);
+            }
+            for (int j = 0; j < COLS - 1; j++) {
+                std::vector<acc_t>& r = deskew[j];
+                for (int s = COLS - 2 - j; s > 0; s--)
+                    r[s] = r[s - 1];
+                r[0] = y_sig[ROWS * COLS + j].read();
+                c_out[j].write(r[COLS - 2 - j]);
+            }
+            if (w_load.read()) {
+                for (int k = ROWS * COLS - 1; k >= COLS; k--)
+                    w_reg[k].write(w_reg[k - COLS].read());
+                for (int j = 0; j < COLS; j++)
+                    w_reg[j].write(w_in[j].read());
+            }
+        }
+    }
+
+    // Accumulations and overflows summed over the PEs
+    AccStats accumulator_stats() const {
+        return total_acc_stats(pe);
     }
 };
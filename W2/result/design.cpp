@@ -1,28 +1,44 @@
 #include <systemc.h>
+#include <algorithm>
 #include <iostream>
+#include <vector>
+#include "../../common/systolic_array.h"
 
 // Processing Element (PE) module
-SC_MODULE(PE) {
+template <class T = IntTypes>
+SC_MODULE(PE_W2) {
+    typedef typename T::data_t data_t;
+    typedef typename T::weight_t weight_t;
+    typedef typename T::acc_t acc_t;
+
     sc_in<bool> clk;
     sc_in<bool> rst;
     
-    sc_in<int> x_in;       // Input data
-    sc_in<int> y_in;       // Partial sum input
-    sc_out<int> x_out;     // Forward data to next PE
-    sc_out<int> y_out;     // Forward partial sum to next PE
+    sc_in<data_t> x_in;    // Input data
+    sc_in<acc_t> y_in;     // Partial sum input
+    sc_out<data_t> x_out;  // Forward data to next PE
+    sc_out<acc_t> y_out;   // Forward partial sum to next PE
 
-    int weight;            // Fixed weight for this PE
+    weight_t weight;       // Fixed weight for this PE
 
     // Internal registers
-    int x_reg1;            // First register for input data
-    int x_reg2;            // Second register for input data (extra delay)
-    int mult_result_reg;   // Register for multiplication result
-    int y_reg;             // Register for output data
+    data_t x_reg1;         // First register for input data
+    data_t x_reg2;         // Second register for input data (extra delay)
+    std::vector<data_t> x_delay;  // Dilation: dilation - 1 more registers before x_reg2
+    acc_t mult_result_reg; // Register for multiplication result
+    acc_t y_reg;           // Register for output data
   
-  	int sum;
+  	acc_t sum;
+
+    PeCounters counters;   // Activity counters, live only with -DPE_COUNTERS
+    AccStats acc_stats;    // Overflows of sum
+
+    // Registers a clocked cycle writes and values it hands on, for common/energy.h
+    static const int register_writes = 5;
+    static const int forwarding_hops = 2;
 
     // Constructor
-    SC_CTOR(PE) {
+    SC_CTOR(PE_W2) {
         SC_METHOD(compute);
         sensitive << clk.pos();
         sensitive << rst.pos();
@@ -38,106 +54,339 @@ SC_MODULE(PE) {
         weight = w;
     }
 
+    // Registers and outputs at rest, an edge with all inputs zero changes nothing
+    bool quiescent() const {
+        return x_reg1 == 0 && x_reg2 == 0 && mult_result_reg == 0 && y_reg == 0 && x_out.read() == 0 && y_out.read() == 0 &&
+               std::count(x_delay.begin(), x_delay.end(), data_t(0)) == std::ptrdiff_t(x_delay.size());
+    }
+
+    // x takes dilation + 1 cycles through the PE instead of 2
+    void set_dilation(int dilation) {
+        x_delay.assign(dilation > 1 ? dilation - 1 : 0, data_t(0));
+    }
+
+    // Registers for common/checkpoint.h
+    template <class Archive>
+    void checkpoint(Archive& a) {
+        a(weight);
+        a(x_reg1);
+        a(x_reg2);
+        a(x_delay);
+        a(mult_result_reg);
+        a(y_reg);
+        a(sum);
+    }
+    
     // Compute function implementing the PE logic
     void compute() {
         if (rst.read()) {
             // Reset all registers
             x_reg1 = 0;
             x_reg2 = 0;
+            std::fill(x_delay.begin(), x_delay.end(), data_t(0));
             mult_result_reg = 0;
             y_reg = 0;
             x_out.write(0);
             y_out.write(0);
         } else if (clk.read()) {
             
-            // Pipeline stage 1: Second input data register (extra delay for x path)
-            x_reg2 = x_reg1;
+            // Pipeline stage 1: Second input data register (extra delay for x path),
+            // behind the dilation registers if there are any
+            if (x_delay.empty()) {
+                x_reg2 = x_reg1;
+            } else {
+                x_reg2 = x_delay.back();
+                std::copy_backward(x_delay.begin(), x_delay.end() - 1, x_delay.end());
+                x_delay.front() = x_reg1;
+            }
           
             // Pipeline stage 2: First input data register
             x_reg1 = x_in.read();
             
             // Pipeline stage 3: Perform multiplication and store in register
-            mult_result_reg = x_reg1 * weight;
+            mult_result_reg = pe_multiply<acc_t>(x_reg1, weight);
             
             // Pipeline stage 4: Register output data
           	y_reg = y_in.read();
           
           	// Add multiplication result with output data
-            sum = mult_result_reg + y_reg;
+            sum = acc_stats.add(mult_result_reg, y_reg);
             
             // Forward data and partial sum
             x_out.write(x_reg2);
             y_out.write(sum);
+            counters.cycle(x_reg1, weight, x_reg2 != 0 || y_reg != 0);
         }
     }
 };
 
-// Top-level systolic array module
-SC_MODULE(W2_SystolicArray) {
+// Top-level systolic array module with N PEs
+template <int N, class T>
+struct SystolicArray<Design::W2, N, T> : public sc_module {
+    typedef typename T::data_t data_t;
+    typedef typename T::weight_t weight_t;
+    typedef typename T::acc_t acc_t;
+
     sc_in<bool> clk;
     sc_in<bool> rst;
     
     // Input ports
-    sc_in<int> x_in;   // Input data stream
-    sc_in<int> y_in;   // Initial partial sum (usually 0)
+    sc_in<data_t> x_in;   // Input data stream
+    sc_in<acc_t> y_in;    // Initial partial sum (usually 0)
     
     // Output ports
-    sc_out<int> x_out; // Forwarded data (not used)
-    sc_out<int> y_out; // Final result
+    sc_out<data_t> x_out; // Forwarded data (not used)
+    sc_out<acc_t> y_out;  // Final result
     
     // Processing elements
-    PE* pe1;
-    PE* pe2;
-    PE* pe3;
+    sc_vector<PE_W2<T> > pe;
     
     // Internal signals for connecting PEs
-    sc_signal<int> x_sig1, x_sig2;  // x connections between PEs
-    sc_signal<int> y_sig1, y_sig2;  // y connections between PEs
+    sc_vector<sc_signal<data_t> > x_sig;  // x_sig[i] connects PE(i+1) to PE(i+2)
+    sc_vector<sc_signal<acc_t> > y_sig;  // y_sig[i] connects PE(i+1) to PE(i+2)
     
     // Constructor
-    SC_CTOR(W2_SystolicArray) {
-        // Create the processing elements
-        pe1 = new PE("PE1");
-        pe2 = new PE("PE2");
-        pe3 = new PE("PE3");
+    SC_CTOR(SystolicArray) : pe("pe"), x_sig("x_sig", N - 1), y_sig("y_sig", N - 1) {
+        static_assert(N >= 1, "systolic array needs at least one PE");
         
-        // Set weights for each PE (w1, w2, w3) - note the order is reversed compared to W1
-        pe1->set_weight(3); // w3 (leftmost PE)
-        pe2->set_weight(2); // w2
-        pe3->set_weight(1); // w1 (rightmost PE)
+        // Create the processing elements
+        pe.init(N, numbered<PE_W2<T> >("PE"));
         
-        // Connect clock and reset to all PEs
-        pe1->clk(clk);
-        pe1->rst(rst);
-        pe2->clk(clk);
-        pe2->rst(rst);
-        pe3->clk(clk);
-        pe3->rst(rst);
+        // Set weights for each PE (wN leftmost ... w1 rightmost) - note the order is reversed compared to W1
+        set_weights(default_weights(N));
         
         // Connect the PEs in series
-        // Both x and y flow from left to right: PE1 -> PE2 -> PE3
-        
-        // Input data connections (x flows from left to right: PE1->PE2->PE3)
-        pe1->x_in(x_in);       // Input x goes to leftmost PE (PE1)
-        pe1->x_out(x_sig1);    // PE1 output to PE2
-        pe2->x_in(x_sig1);     // PE2 input from PE1
-        pe2->x_out(x_sig2);    // PE2 output to PE3
-        pe3->x_in(x_sig2);     // PE3 input from PE2
-        pe3->x_out(x_out);     // PE3 output (final x)
-        
-        // Partial sum connections (y also flows from left to right: PE1->PE2->PE3)
-        pe1->y_in(y_in);       // Initial y (usually 0) goes to leftmost PE (PE1)
-        pe1->y_out(y_sig1);    // PE1 output to PE2
-        pe2->y_in(y_sig1);     // PE2 input from PE1
-        pe2->y_out(y_sig2);    // PE2 output to PE3
-        pe3->y_in(y_sig2);     // PE3 input from PE2
-        pe3->y_out(y_out);     // PE3 output is the final result
+        // Both x and y flow from left to right: PE1 -> ... -> PEN
+        for (int i = 0; i < N; i++) {
+            // Connect clock and reset to all PEs
+            pe[i].clk(clk);
+            pe[i].rst(rst);
+            
+            // Input data connections (x flows from left to right: PE1 -> ... -> PEN)
+            if (i == 0)
+                pe[i].x_in(x_in);       // Input x goes to leftmost PE
+            else
+                pe[i].x_in(x_sig[i - 1]);
+            if (i == N - 1)
+                pe[i].x_out(x_out);     // Rightmost PE output (final x)
+            else
+                pe[i].x_out(x_sig[i]);
+            
+            // Partial sum connections (y flows from left to right: PE1 -> ... -> PEN)
+            if (i == 0)
+                pe[i].y_in(y_in);       // Initial y (usually 0) goes to leftmost PE
+            else
+                pe[i].y_in(y_sig[i - 1]);
+            if (i == N - 1)
+                pe[i].y_out(y_out);     // Rightmost PE output is the final result
+            else
+                pe[i].y_out(y_sig[i]);
+        }
     }
     
-    // Destructor
-    ~W2_SystolicArray() {
-        delete pe1;
-        delete pe2;
-        delete pe3;
+    // Load kernel w1..wN, w1 goes to the rightmost PE
+    void set_weights(const std::vector<int>& w) {
+        for (int i = 0; i < N; i++)
+            pe[i].set_weight(w[N - 1 - i]);
+    }
+
+    // Dilated convolution, elaboration only: y_i = w1 * x[i - (N-1) * dilation] + ...
+    // + wN * x[i]. A partial sum takes one cycle per PE and x takes two, so next to
+    // each other they meet the next older sample; with dilation - 1 more x registers
+    // per PE x takes dilation + 1 cycles and they meet the sample `dilation` older.
+    // N PEs then do the work of a kernel (N-1) * dilation + 1 taps long with zeros
+    // between the weights. Dilation 1 is the plain array.
+    void set_dilation(int dilation) {
+        for (int i = 0; i < N; i++)
+            pe[i].set_dilation(dilation);
+    }
+
+    // Accumulations and overflows summed over the PEs
+    AccStats accumulator_stats() const {
+        return total_acc_stats(pe);
+    }
+
+    // True if an edge with every input zero would change nothing, see common/idle_skip.h
+    bool quiescent() const {
+        return all_quiescent(pe);
+    }
+
+    // PE and module registers for common/checkpoint.h; its signals are walked separately
+    template <class Archive>
+    void checkpoint(Archive& a) {
+        checkpoint_all(a, pe);
+    }
+
+    // Per-PE utilization table at sc_stop(), only with -DPE_COUNTERS, and any overflows
+    void end_of_simulation() {
+        report_pe_counters(name(), pe);
+        report_acc_overflows(name(), accumulator_stats());
+    }
+};
+
+typedef SystolicArray<Design::W2, 3> W2_SystolicArray;
+
+// Line buffer of a K x K image convolution: holds the last K-1 rows of a raster
+// stream, width pixels each, in one circular buffer, and on every rising edge puts
+// the pixel each row chain of W2_Conv2D takes next on row[k] (k = 0 the top row of
+// the window). row[k] is the pixel (K-1-k) rows up, and k * K cycles late, so that
+// chain k+1 takes the window column just as chain k's partial sum for it arrives.
+// The skew comes from reading the buffer K cycles further back per row, so it
+// needs no registers beyond the (K-1) * width words of the rows, as long as width
+// is at least K.
+template <int K, class T = IntTypes>
+struct W2_LineBuffer : public sc_module {
+    typedef typename T::data_t data_t;
+
+    sc_in<bool> clk;
+    sc_in<bool> rst;
+    sc_in<data_t> x_in;                 // Pixel stream, row by row
+    sc_vector<sc_out<data_t> > row;     // Next pixel of each row chain
+
+    int width;
+    std::vector<data_t> lines;          // The last (K-1) * width pixels
+    size_t at;                          // Slot of the oldest of them, written next
+
+    SC_HAS_PROCESS(W2_LineBuffer);
+    W2_LineBuffer(sc_module_name name, int width)
+        : sc_module(name), row("row", K), width(width), lines(size_t(K - 1) * width, data_t(0)), at(0) {
+        if (width < K)
+            SC_REPORT_ERROR(this->name(), "line buffer narrower than the kernel");
+        SC_METHOD(shift);
+        sensitive << clk.pos();
+        sensitive << rst.pos();
+    }
+
+    // Cycles between a pixel entering and row[k] showing it
+    int delay(int k) const { return (K - 1 - k) * width + k * K; }
+
+    // Line buffer memory in pixels
+    size_t words() const { return lines.size(); }
+
+    void shift() {
+        if (rst.read()) {
+            std::fill(lines.begin(), lines.end(), data_t(0));
+            at = 0;
+            for (int k = 0; k < K; k++)
+                row[k].write(0);
+        } else if (clk.read()) {
+            data_t x = x_in.read();
+            for (int k = 0; k < K; k++) {
+                size_t d = size_t(delay(k));
+                row[k].write(d == 0 ? x : lines[(at + lines.size() - d) % lines.size()]);
+            }
+            if (!lines.empty()) {
+                lines[at] = x;
+                at = (at + 1) % lines.size();
+            }
+        }
+    }
+};
+
+// K x K 2D convolution of a raster pixel stream, one pixel in and one result out
+// per cycle. K rows of K W2 PEs each, SystolicArray<Design::W2, K> chains, compute
+// the 1D convolution of one image row each; the line buffer feeds chain k the row
+// k of the window, and chain k's y_out is chain k+1's y_in, so chain K-1 puts out
+// the sum over all K rows:
+//   y(r, c) = sum over k, j of w[k * K + j] * image(r - K + 1 + k, c - K + 1 + j)
+// for the window whose bottom-right pixel is (r, c), which entered `latency` cycles
+// before y_out shows it. y_valid is set for windows inside the image; the others
+// wrap around a row edge (c < K-1) or a frame edge (r < K-1 within a frame).
+// Images are width pixels wide and height rows high (0 for one unbounded image),
+// the stream starts at the top-left pixel on the first cycle after reset, and
+// width must be at least K.
+template <int K, class T = IntTypes>
+struct W2_Conv2D : public sc_module {
+    typedef typename T::data_t data_t;
+    typedef typename T::acc_t acc_t;
+
+    sc_in<bool> clk;
+    sc_in<bool> rst;
+
+    sc_in<data_t> x_in;     // One pixel per cycle
+    sc_out<acc_t> y_out;    // Window result
+    sc_out<bool> y_valid;   // y_out is a window inside the image
+
+    // The line buffer register, K cycles per chain before the last and its K - 1
+    static const int latency = K * K;
+
+    W2_LineBuffer<K, T> line_buffer;
+    sc_vector<SystolicArray<Design::W2, K, T> > chain;
+
+    sc_vector<sc_signal<data_t> > row_x;    // Line buffer to chain k
+    sc_vector<sc_signal<acc_t> > row_y;     // Chain k's y_out to chain k+1's y_in
+    sc_vector<sc_signal<data_t> > x_unused;
+    sc_signal<acc_t> y_zero;                // Chain 0's y_in
+
+    int width, height;
+    uint64_t taken;         // Pixels taken since reset
+
+    SC_HAS_PROCESS(W2_Conv2D);
+    W2_Conv2D(sc_module_name name, int width, int height = 0)
+        : sc_module(name), line_buffer("line_buffer", width), chain("chain", K), row_x("row_x", K),
+          row_y("row_y", K - 1), x_unused("x_unused", K), width(width), height(height), taken(0) {
+        static_assert(K >= 1, "2D convolution needs at least a 1 x 1 kernel");
+        if (width < K)
+            SC_REPORT_ERROR(this->name(), "image narrower than the kernel");
+        line_buffer.clk(clk);
+        line_buffer.rst(rst);
+        line_buffer.x_in(x_in);
+        for (int k = 0; k < K; k++) {
+            line_buffer.row[k](row_x[k]);
+            chain[k].clk(clk);
+            chain[k].rst(rst);
+            chain[k].x_in(row_x[k]);
+            if (k == 0)
+                chain[k].y_in(y_zero);
+            else
+                chain[k].y_in(row_y[k - 1]);
+            chain[k].x_out(x_unused[k]);
+            if (k == K - 1)
+                chain[k].y_out(y_out);
+            else
+                chain[k].y_out(row_y[k]);
+        }
+        set_weights(default_weights(K * K));
+
+        SC_METHOD(track);
+        sensitive << clk.pos();
+        sensitive << rst.pos();
+    }
+
+    // Load the kernel row by row, w[k * K + j] for window row k (0 = top) and column j
+    // (0 = left), in the order of the 1D kernels: w1 meets the oldest pixel
+    void set_weights(const std::vector<int>& w) {
+        for (int k = 0; k < K; k++)
+            chain[k].set_weights(std::vector<int>(w.begin() + k * K, w.begin() + (k + 1) * K));
+    }
+
+    // Line buffer memory in pixels; the K * K PEs hold two x registers each besides
+    size_t buffer_words() const { return line_buffer.words(); }
+
+    // True if the window whose bottom-right pixel is pixel `i` of the stream lies
+    // inside the image
+    bool inside(uint64_t i) const {
+        uint64_t r = i / width, c = i % width;
+        if (height > 0)
+            r %= height;
+        return r >= uint64_t(K - 1) && c >= uint64_t(K - 1);
+    }
+
+    // y_out after this edge holds the window of the pixel taken `latency` edges ago
+    void track() {
+        if (rst.read()) {
+            taken = 0;
+            y_valid.write(false);
+        } else if (clk.read()) {
+            taken++;
+            y_valid.write(taken > uint64_t(latency) && inside(taken - 1 - latency));
+        }
+    }
+
+    AccStats accumulator_stats() const {
+        AccStats s;
+        for (int k = 0; k < K; k++)
+            s.merge(chain[k].accumulator_stats());
+        return s;
     }
 };
@@ -0,0 +1,183 @@
+#include <systemc.h>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include "../../common/child_process.h"
+#include "../../common/dispatch.h"
+#include "../../common/stream_run.h"
+
+// Measured in the child, trivially copyable so it can come back through a pipe
+struct TreeResult {
+    uint64_t cycles;        // Simulated rising edges, including reset and drain
+    uint64_t results;       // Outputs checked against the golden model
+    uint64_t errors;        // Mismatches plus results never produced
+    int levels;             // Adder tree register stages, 0 for W2 and R2
+    int adders;
+    int latency;            // Cycles from a sample entering to its output, for the first checked one
+    double seconds;         // Host wall time inside sc_start()
+};
+
+// Streams a random signal through F built with an adder tree of the given fan-in
+struct AdderTreeRun {
+    uint64_t length;
+    unsigned seed;
+    int fan_in;
+    TreeResult result;
+
+    template <Design D, int N>
+    void run() {
+        std::vector<StimulusRecord> samples = random_samples(length, seed, N);
+        sc_clock clk("clk", 10, SC_NS, 0.5, 5, SC_NS, true);
+        InputSignals in;
+        OutputSignals out;
+        SystolicArray<Design::F, N> array("array", fan_in);
+        GoldenChecker checker(Design::F, default_weights(N), samples.size(), 0, 0);
+        checker.set_report_limit(0);
+        checker.set_output_latency(array.adder_levels());
+        StimulusSource source("source", samples.data(), samples.size(), 1);
+        StreamMonitor monitor("monitor", source, checker, source.total_cycles() + 2 * N + 8, false);
+
+        bind(array, clk, in, out);
+        source.clk(clk);
+        source.rst(in.rst);
+        source.x_in(in.x_in);
+        source.y_in(in.y_in);
+        source.w_in(in.w_in);
+        source.tag_in(in.tag_in);
+        monitor.clk(clk);
+        monitor.x_in(in.x_in);
+        monitor.w_in(in.w_in);
+        monitor.y_out(out.y_out);
+
+        auto start = std::chrono::steady_clock::now();
+        sc_start();
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        result.cycles = monitor.edges;
+        result.results = checker.results_checked();
+        result.errors = checker.mismatch_count() + checker.missing_count();
+        result.levels = array.adder_levels();
+        result.adders = array.adder->adders();
+        result.latency = checker.first_output_latency();
+    }
+};
+
+// The same stream through W2 or R2 for comparison, which need no adder tree
+struct ReferenceRun {
+    uint64_t length;
+    unsigned seed;
+    TreeResult result;
+
+    template <Design D, int N>
+    void run() {
+        std::vector<StimulusRecord> samples = random_samples(length, seed, N);
+        GoldenChecker checker = GoldenChecker::for_design(D, N, samples.size());
+        checker.set_report_limit(0);
+        StreamStats stats = run_stream<D, N>(samples.data(), samples.size(), checker);
+
+        result.cycles = stats.cycles;
+        result.results = checker.results_checked();
+        result.errors = checker.mismatch_count() + checker.missing_count();
+        result.levels = 0;
+        result.adders = 0;
+        result.latency = checker.first_output_latency();
+        result.seconds = stats.seconds;
+    }
+};
+
+static void print_row(const char* design, int taps, const char* fan_in, const TreeResult& r, bool passed) {
+    cout << design << "\t" << taps << "\t" << fan_in << "\t" << r.levels << "\t" << r.adders << "\t" << r.latency
+         << "\t" << (r.levels > 1 ? r.levels - 1 : 0) << "\t" << r.results << "\t" << r.cycles << "\t"
+         << (r.cycles ? double(r.results) / r.cycles : 0) << "\t" << r.seconds << "\t"
+         << (passed ? "true" : "false") << endl;
+}
+
+static int usage() {
+    cout << "Usage: addertree [--taps 3,9,...] [--fan-in 2,4,8,0] [--compare W2,R2] [--length samples] [--seed S]"
+         << endl
+         << "       fan-in 0 is the single flat adder" << endl;
+    return 1;
+}
+
+// Comma-separated integers
+static std::vector<int> int_list(char* list) {
+    std::vector<int> values;
+    for (char* t = std::strtok(list, ","); t; t = std::strtok(0, ","))
+        values.push_back(std::atoi(t));
+    return values;
+}
+
+int sc_main(int argc, char* argv[]) {
+    std::vector<int> taps = { 3, 9, 16, 25, 32, 64, 128, 256 };
+    std::vector<int> fan_ins = { 2, 4, 8, 0 };
+    std::vector<Design> compare = { Design::W2, Design::R2 };
+    uint64_t length = 100000;
+    unsigned seed = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 == argc)
+            return usage();
+        if (std::strcmp(argv[i], "--taps") == 0) {
+            taps = int_list(argv[++i]);
+        } else if (std::strcmp(argv[i], "--fan-in") == 0) {
+            fan_ins = int_list(argv[++i]);
+        } else if (std::strcmp(argv[i], "--compare") == 0) {
+            compare.clear();
+            for (char* t = std::strtok(argv[++i], ","); t; t = std::strtok(0, ",")) {
+                Design d;
+                if (!parse_design(t, d)) {
+                    cout << "Unknown design " << t << endl;
+                    return 1;
+                }
+                compare.push_back(d);
+            }
+        } else if (std::strcmp(argv[i], "--length") == 0) {
+            length = std::strtoull(argv[++i], 0, 10);
+        } else if (std::strcmp(argv[i], "--seed") == 0) {
+            seed = std::strtoul(argv[++i], 0, 10);
+        } else {
+            return usage();
+        }
+    }
+
+    // added_latency is relative to the single flat adder F had before; fan-in 0 is that adder
+    cout << "design\ttaps\tfan_in\tlevels\tadders\tlatency\tadded_latency\tresults\tcycles\tresults_per_cycle"
+            "\twall_seconds\tpassed" << endl;
+    bool all_passed = true;
+    for (size_t t = 0; t < taps.size(); t++) {
+        for (size_t f = 0; f < fan_ins.size(); f++) {
+            TreeResult r = TreeResult();
+            bool ok = run_in_child([&](TreeResult& out) {
+                AdderTreeRun run = { length, seed, fan_ins[f], TreeResult() };
+                bool dispatched = dispatch_taps<Design::F>(taps[t], run);
+                out = run.result;
+                return dispatched;
+            }, r);
+            if (!ok) {
+                cout << "Failed to run Fx" << taps[t] << " (unsupported tap count?)" << endl;
+                all_passed = false;
+                continue;
+            }
+            bool passed = r.errors == 0 && r.latency == r.levels;
+            all_passed &= passed;
+            std::string fan_in = fan_ins[f] < 2 ? "flat" : std::to_string(fan_ins[f]);
+            print_row("F", taps[t], fan_in.c_str(), r, passed);
+        }
+        for (size_t d = 0; d < compare.size(); d++) {
+            TreeResult r = TreeResult();
+            bool ok = run_in_child([&](TreeResult& out) {
+                ReferenceRun run = { length, seed, TreeResult() };
+                bool dispatched = dispatch(compare[d], taps[t], run);
+                out = run.result;
+                return dispatched;
+            }, r);
+            bool passed = ok && r.errors == 0;
+            all_passed &= passed;
+            print_row(design_name(compare[d]), taps[t], "-", r, passed);
+        }
+    }
+    cout << (all_passed ? "PASS" : "FAIL") << endl;
+    return all_passed ? 0 : 1;
+}
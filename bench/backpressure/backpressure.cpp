@@ -0,0 +1,267 @@
+#include <systemc.h>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include "../../common/child_process.h"
+#include "../../common/dispatch.h"
+#include "../../common/stream_run.h"
+
+// The StimulusSource schedule driven through the in_ready handshake: an input cycle
+// only counts once the array has taken it at a rising edge, until then it is held.
+SC_MODULE(HandshakeSource) {
+    sc_in<bool> clk;
+    sc_in<bool> in_ready;
+    sc_out<bool> rst;
+    sc_out<int> x_in, w_in;
+    sc_out<bool> tag_in;
+
+    const StimulusRecord* records;
+    uint64_t count;
+    int spacing;
+    int w_offset;       // Cycles from a sample's x to its w/tag
+    uint64_t cycle;     // Input cycles driven so far
+    uint64_t next;      // Next sample to send
+    uint64_t stalls;    // Rising edges the array did not take its inputs on
+    bool taken;         // in_ready at the last rising edge
+
+    SC_HAS_PROCESS(HandshakeSource);
+    HandshakeSource(sc_module_name name, const StimulusRecord* records, uint64_t count, int spacing, int w_offset)
+        : sc_module(name), records(records), count(count), spacing(spacing), w_offset(w_offset), cycle(0), next(0),
+          stalls(0), taken(true) {
+        SC_METHOD(drive);
+        sensitive << clk.neg();
+        SC_METHOD(take);
+        sensitive << clk.pos();
+        dont_initialize();
+    }
+
+    // Same schedule as StimulusSource with one reset cycle
+    bool carries_sample(uint64_t c) const { return c >= 1 && (c - 1) % spacing == 0 && c < total_cycles(); }
+    bool carries_weight(uint64_t c) const { return c >= uint64_t(w_offset) && carries_sample(c - w_offset); }
+    uint64_t total_cycles() const { return 1 + count * spacing; }
+
+    void take() {
+        taken = in_ready.read();
+        if (!taken)
+            stalls++;
+    }
+
+    void drive() {
+        if (!taken)
+            return;
+        CycleIn in = { cycle < 1, 0, 0, 0, false };
+        if (carries_sample(cycle))
+            in.x = records[next++].x;
+        if (carries_weight(cycle)) {
+            const StimulusRecord& r = records[(cycle - w_offset - 1) / spacing];
+            in.w = r.w;
+            in.tag = r.tag != 0;
+        }
+        rst.write(in.rst);
+        x_in.write(in.x);
+        w_in.write(in.w);
+        tag_in.write(in.tag);
+        cycle++;
+    }
+};
+
+// Takes y_out on one cycle in `every` and hashes the results it takes. Consuming at
+// full rate the array never stalls, so y_out is also checked against the golden model.
+SC_MODULE(SlowConsumer) {
+    sc_in<bool> clk;
+    sc_in<int> x_in, w_in, y_out;
+    sc_in<bool> y_valid;
+    sc_out<bool> y_ready;
+
+    const HandshakeSource& source;
+    GoldenChecker& checker;
+    int every;
+    uint64_t drain;         // Input cycles to run past the last sample
+    uint64_t edges;
+    uint64_t results;       // Results taken
+    uint64_t hash;          // FNV-1a over the results taken, in order
+
+    SC_HAS_PROCESS(SlowConsumer);
+    SlowConsumer(sc_module_name name, const HandshakeSource& source, GoldenChecker& checker, int every,
+                 uint64_t drain)
+        : sc_module(name), source(source), checker(checker), every(every), drain(drain), edges(0), results(0),
+          hash(14695981039346656037ull) {
+        SC_METHOD(ready);
+        sensitive << clk.neg();
+        SC_METHOD(consume);
+        sensitive << clk.pos();
+        dont_initialize();
+    }
+
+    void ready() {
+        y_ready.write(edges % every == 0);
+    }
+
+    void consume() {
+        if (y_valid.read() && y_ready.read()) {
+            results++;
+            hash = (hash ^ uint32_t(y_out.read())) * 1099511628211ull;
+        }
+        if (every == 1) {
+            if (edges > 0)
+                checker.output(edges - 1, y_out.read());
+            if (source.carries_sample(edges))
+                checker.sample(edges, x_in.read(), w_in.read());
+        }
+        edges++;
+        if (source.cycle >= source.total_cycles() + drain && !y_valid.read())
+            sc_stop();
+    }
+};
+
+// Measured in the child, trivially copyable so it can come back through a pipe
+struct BackpressureResult {
+    uint64_t cycles;
+    uint64_t results;       // Results taken by the consumer
+    uint64_t stalls;        // Cycles in_ready held the array
+    uint64_t hash;
+    uint64_t errors;        // Golden-model mismatches and missing results, full rate only
+    double seconds;
+};
+
+// Streams a random signal through R1 or R2 into a consumer that is ready one cycle in `every`
+struct BackpressureRun {
+    uint64_t length;
+    unsigned seed;
+    int every;
+    BackpressureResult result;
+
+    template <Design D, int N>
+    void run() {
+        std::vector<StimulusRecord> samples = random_samples(length, seed, N);
+        GoldenChecker checker = GoldenChecker::for_design(D, N, samples.size());
+        checker.set_report_limit(0);
+        sc_clock clk("clk", 10, SC_NS, 0.5, 5, SC_NS, true);
+        InputSignals in;
+        OutputSignals out;
+        SystolicArray<D, N> array("array");
+        HandshakeSource source("source", samples.data(), samples.size(), cycles_per_sample(D),
+                               weight_offset(D, N));
+        SlowConsumer consumer("consumer", source, checker, every, 2 * N + 8);
+
+        bind(array, clk, in, out);
+        source.clk(clk);
+        source.in_ready(out.in_ready);
+        source.rst(in.rst);
+        source.x_in(in.x_in);
+        source.w_in(in.w_in);
+        source.tag_in(in.tag_in);
+        consumer.clk(clk);
+        consumer.x_in(in.x_in);
+        consumer.w_in(in.w_in);
+        consumer.y_out(out.y_out);
+        consumer.y_valid(out.y_valid);
+        consumer.y_ready(in.y_ready);
+
+        auto start = std::chrono::steady_clock::now();
+        sc_start();
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        result.cycles = consumer.edges;
+        result.results = consumer.results;
+        result.stalls = source.stalls;
+        result.hash = consumer.hash;
+        result.errors = every == 1 ? checker.mismatch_count() + checker.missing_count() : 0;
+    }
+};
+
+static int usage() {
+    cout << "Usage: backpressure [--designs R1,R2] [--taps 3,9,...] [--ready-every 1,2,4,...] [--length samples]"
+         << " [--seed S]" << endl;
+    return 1;
+}
+
+// Comma-separated integers
+static std::vector<int> int_list(char* list) {
+    std::vector<int> values;
+    for (char* t = std::strtok(list, ","); t; t = std::strtok(0, ","))
+        values.push_back(std::atoi(t));
+    return values;
+}
+
+int sc_main(int argc, char* argv[]) {
+    std::vector<Design> designs = { Design::R1, Design::R2 };
+    std::vector<int> taps = { 3, 9, 25 };
+    std::vector<int> every = { 1, 2, 4 };
+    uint64_t length = 100000;
+    unsigned seed = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 == argc)
+            return usage();
+        if (std::strcmp(argv[i], "--designs") == 0) {
+            designs.clear();
+            for (char* t = std::strtok(argv[++i], ","); t; t = std::strtok(0, ",")) {
+                Design d;
+                if (!parse_design(t, d) || (d != Design::R1 && d != Design::R2)) {
+                    cout << "Only R1 and R2 have a ready input, not " << t << endl;
+                    return 1;
+                }
+                designs.push_back(d);
+            }
+        } else if (std::strcmp(argv[i], "--taps") == 0) {
+            taps = int_list(argv[++i]);
+        } else if (std::strcmp(argv[i], "--ready-every") == 0) {
+            every = int_list(argv[++i]);
+        } else if (std::strcmp(argv[i], "--length") == 0) {
+            length = std::strtoull(argv[++i], 0, 10);
+        } else if (std::strcmp(argv[i], "--seed") == 0) {
+            seed = std::strtoul(argv[++i], 0, 10);
+        } else {
+            return usage();
+        }
+    }
+
+    // The full-rate run is checked against the golden model, the slower consumers
+    // must then take the same results in the same order
+    cout << "design\ttaps\tready_every\tcycles\tresults\tresults_per_cycle\tstall_cycles\twall_seconds\tpassed"
+         << endl;
+    bool all_passed = true;
+    for (size_t d = 0; d < designs.size(); d++) {
+        for (size_t t = 0; t < taps.size(); t++) {
+            BackpressureResult reference = BackpressureResult();
+            for (size_t e = 0; e < every.size(); e++) {
+                BackpressureResult r = BackpressureResult();
+                int consumer_every = every[e] < 1 ? 1 : every[e];
+                bool ok = run_in_child([&](BackpressureResult& out) {
+                    BackpressureRun run = { length, seed, consumer_every, BackpressureResult() };
+                    bool dispatched = designs[d] == Design::R1 ? dispatch_taps<Design::R1>(taps[t], run)
+                                                               : dispatch_taps<Design::R2>(taps[t], run);
+                    out = run.result;
+                    return dispatched;
+                }, r);
+                if (ok && consumer_every == 1)
+                    reference = r;
+                if (ok && consumer_every != 1 && reference.results == 0) {
+                    BackpressureRun full = { length, seed, 1, BackpressureResult() };
+                    ok = run_in_child([&](BackpressureResult& out) {
+                        bool dispatched = designs[d] == Design::R1 ? dispatch_taps<Design::R1>(taps[t], full)
+                                                                   : dispatch_taps<Design::R2>(taps[t], full);
+                        out = full.result;
+                        return dispatched;
+                    }, reference);
+                }
+                if (!ok) {
+                    cout << "Failed to run " << design_name(designs[d]) << "x" << taps[t]
+                         << " (unsupported tap count?)" << endl;
+                    all_passed = false;
+                    continue;
+                }
+                bool passed = reference.errors == 0 && r.results == reference.results && r.hash == reference.hash;
+                all_passed &= passed;
+                cout << design_name(designs[d]) << "\t" << taps[t] << "\t" << consumer_every << "\t" << r.cycles
+                     << "\t" << r.results << "\t" << (r.cycles ? double(r.results) / r.cycles : 0) << "\t"
+                     << r.stalls << "\t" << r.seconds << "\t" << (passed ? "true" : "false") << endl;
+            }
+        }
+    }
+    cout << (all_passed ? "PASS" : "FAIL") << endl;
+    return all_passed ? 0 : 1;
+}
@@ -0,0 +1,180 @@
+#include <systemc.h>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "../../common/checkpoint.h"
+#include "../../common/child_process.h"
+#include "../../common/dispatch.h"
+#include "../../common/stream_run.h"
+
+// Measured in the child, trivially copyable so it can come back through a pipe
+struct CheckpointResult {
+    uint64_t cycles;
+    uint64_t checked;
+    uint64_t errors;        // Golden-model mismatches and missing results
+    uint64_t output_hash;
+    uint64_t saved;         // Checkpoints written
+    uint64_t resumed_at;    // Edge the run resumed with, 0 if it ran from reset
+    double seconds;
+};
+
+// One run of the stream: from reset, writing checkpoint k to prefix + k every `every`
+// edges if every is set, or from the checkpoint in `resume` if that is set
+struct CheckpointRun {
+    const std::vector<StimulusRecord>& samples;
+    bool skip_idle;
+    uint64_t every;
+    std::string prefix;
+    const char* resume;
+    CheckpointResult result;
+
+    template <Design D, int N>
+    void run() {
+        GoldenChecker checker = GoldenChecker::for_design(D, N, samples.size());
+        checker.set_report_limit(0);
+        CheckpointPlan checkpoints;
+        Checkpoint from;
+        std::string error;
+        if (resume) {
+            if (!from.read(resume, error)) {
+                cout << error << endl;
+                return;
+            }
+            checkpoints.resume = &from;
+            result.resumed_at = from.edges;
+        }
+        checkpoints.every = every;
+        checkpoints.saved = [&](const Checkpoint& cp) {
+            std::string path = prefix + std::to_string(result.saved);
+            if (cp.write(path.c_str(), error))
+                result.saved++;
+            else
+                cout << error << endl;
+        };
+        StreamStats stats =
+            run_stream<D, N>(samples.data(), samples.size(), checker, false, TraceConfig(), skip_idle, checkpoints);
+        result.cycles = stats.cycles;
+        result.checked = checker.results_checked();
+        result.errors = checker.mismatch_count() + checker.missing_count();
+        result.output_hash = stats.output_hash;
+        result.seconds = stats.seconds;
+    }
+};
+
+static bool run_once(Design d, int taps, CheckpointRun& run) {
+    return run_in_child([&](CheckpointResult& out) {
+        bool dispatched = dispatch(d, taps, run);
+        out = run.result;
+        return dispatched;
+    }, run.result);
+}
+
+static int usage() {
+    cout << "Usage: checkpoint [--designs B1,B2,...] [--taps 3,9,...] [--length samples] [--every cycles] [--seed S]"
+         << endl
+         << "                  [--skip-idle] [--dir path]" << endl;
+    return 1;
+}
+
+// Comma-separated integers
+static std::vector<int> int_list(char* list) {
+    std::vector<int> values;
+    for (char* t = std::strtok(list, ","); t; t = std::strtok(0, ","))
+        values.push_back(std::atoi(t));
+    return values;
+}
+
+int sc_main(int argc, char* argv[]) {
+    std::vector<Design> designs = { Design::B1, Design::B2, Design::F, Design::R1, Design::R2, Design::W1,
+                                    Design::W2 };
+    std::vector<int> taps = { 3, 9 };
+    uint64_t length = 50000;
+    uint64_t every = 12347;     // Prime, so the snapshots fall at every phase of the weight streams
+    unsigned seed = 1;
+    bool skip_idle = false;
+    std::string dir = "/tmp";
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--skip-idle") == 0) {
+            skip_idle = true;
+            continue;
+        }
+        if (i + 1 == argc)
+            return usage();
+        if (std::strcmp(argv[i], "--designs") == 0) {
+            designs.clear();
+            for (char* t = std::strtok(argv[++i], ","); t; t = std::strtok(0, ",")) {
+                Design d;
+                if (!parse_design(t, d)) {
+                    cout << "Unknown design " << t << endl;
+                    return 1;
+                }
+                designs.push_back(d);
+            }
+        } else if (std::strcmp(argv[i], "--taps") == 0) {
+            taps = int_list(argv[++i]);
+        } else if (std::strcmp(argv[i], "--length") == 0) {
+            length = std::strtoull(argv[++i], 0, 10);
+        } else if (std::strcmp(argv[i], "--every") == 0) {
+            every = std::strtoull(argv[++i], 0, 10);
+        } else if (std::strcmp(argv[i], "--seed") == 0) {
+            seed = std::strtoul(argv[++i], 0, 10);
+        } else if (std::strcmp(argv[i], "--dir") == 0) {
+            dir = argv[++i];
+        } else {
+            return usage();
+        }
+    }
+    if (length == 0 || every == 0)
+        return usage();
+
+    // Every run resumed from a checkpoint must end exactly like the run from reset:
+    // same cycles, same y_out on every cycle, same results checked, no errors
+    cout << "design\ttaps\tsamples\tcycles\tcheckpoints\tresumed_at\tfull_seconds\tresumed_seconds\tmatches_full"
+            "\tpassed" << endl;
+    bool all_passed = true;
+    for (size_t d = 0; d < designs.size(); d++) {
+        for (size_t t = 0; t < taps.size(); t++) {
+            std::vector<StimulusRecord> samples = random_samples(length, seed, taps[t]);
+            std::string prefix = dir + "/checkpoint_" + design_name(designs[d]) + "x" + std::to_string(taps[t]) + "_";
+
+            CheckpointRun full = { samples, skip_idle, 0, prefix, 0, CheckpointResult() };
+            CheckpointRun saving = { samples, skip_idle, every, prefix, 0, CheckpointResult() };
+            if (!run_once(designs[d], taps[t], full) || !run_once(designs[d], taps[t], saving)) {
+                cout << "Failed to run " << design_name(designs[d]) << "x" << taps[t]
+                     << " (unsupported tap count?)" << endl;
+                all_passed = false;
+                continue;
+            }
+            // Taking checkpoints must not change the run either
+            bool clean = full.result.errors == 0 && saving.result.output_hash == full.result.output_hash &&
+                         saving.result.cycles == full.result.cycles && saving.result.saved > 0;
+            if (!clean) {
+                cout << design_name(designs[d]) << "\t" << taps[t] << "\t" << length << "\t" << full.result.cycles
+                     << "\t" << saving.result.saved << "\t-\t" << full.result.seconds << "\t-\tfalse\tfalse" << endl;
+                all_passed = false;
+            }
+
+            for (uint64_t k = 0; k < saving.result.saved; k++) {
+                std::string path = prefix + std::to_string(k);
+                CheckpointRun resumed = { samples, skip_idle, 0, prefix, path.c_str(), CheckpointResult() };
+                bool ran = run_once(designs[d], taps[t], resumed);
+                std::remove(path.c_str());
+                const CheckpointResult& r = resumed.result;
+                bool matches = ran && r.output_hash == full.result.output_hash && r.cycles == full.result.cycles &&
+                               r.checked == full.result.checked;
+                bool passed = clean && matches && r.errors == 0;
+                all_passed &= passed;
+                cout << design_name(designs[d]) << "\t" << taps[t] << "\t" << length << "\t" << r.cycles << "\t"
+                     << saving.result.saved << "\t" << r.resumed_at << "\t" << full.result.seconds << "\t"
+                     << r.seconds << "\t" << (matches ? "true" : "false") << "\t" << (passed ? "true" : "false")
+                     << endl;
+            }
+        }
+    }
+    cout << (all_passed ? "PASS" : "FAIL") << endl;
+    return all_passed ? 0 : 1;
+}
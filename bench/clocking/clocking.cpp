@@ -0,0 +1,238 @@
+#include <systemc.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "../../common/child_process.h"
+#include "../../common/dispatch.h"
+#include "../../common/harness.h"
+#include "../../common/stimulus.h"
+
+// What one elaboration of the testbench measured
+struct RunResult {
+    double seconds;           // Wall time inside sc_start()
+    uint64_t edges;           // Rising edges seen by the monitor
+    uint64_t thread_resumes;  // Testbench thread wake-ups, one coroutine switch each
+    uint64_t method_calls;    // Testbench method activations
+    uint64_t checksum;        // Hash of every output the monitor read
+};
+
+// FNV-1a over the outputs seen at each edge, so both modes can be compared
+static void hash_output(uint64_t& h, const CycleOut& out) {
+    const int words[] = { out.y, out.x, out.w, out.tag };
+    for (int v : words) {
+        h ^= static_cast<uint32_t>(v);
+        h *= 1099511628211ull;
+    }
+}
+
+// Ports and stimulus shared by both testbench styles, clk is declared by each.
+// Constructed as a base of the sc_module, so the ports belong to that module.
+struct TestbenchPorts {
+    sc_out<bool> rst;
+    sc_out<int> x_in, y_in, w_in;
+    sc_out<bool> tag_in;
+    sc_in<int> x_out, y_out, w_out;
+    sc_in<bool> tag_out;
+
+    const std::vector<CycleIn>& schedule;
+    RunResult& result;
+
+    TestbenchPorts(const std::vector<CycleIn>& schedule, RunResult& result)
+        : schedule(schedule), result(result) {}
+
+    void drive(const CycleIn& in) {
+        rst.write(in.rst);
+        x_in.write(in.x);
+        y_in.write(in.y);
+        w_in.write(in.w);
+        tag_in.write(in.tag);
+    }
+
+    CycleOut sample() const {
+        CycleOut out = { y_out.read(), x_out.read(), w_out.read(), tag_out.read() };
+        return out;
+    }
+};
+
+// The original testbench: clock_gen, stimulus and monitor are SC_THREADs
+struct ThreadTestbench : public sc_module, public TestbenchPorts {
+    sc_out<bool> clk;
+
+    SC_HAS_PROCESS(ThreadTestbench);
+    ThreadTestbench(sc_module_name name, const std::vector<CycleIn>& schedule, RunResult& result)
+        : sc_module(name), TestbenchPorts(schedule, result) {
+        SC_THREAD(clock_gen);
+        SC_THREAD(stimulus);
+        SC_THREAD(monitor);
+    }
+
+    void clock_gen() {
+        clk.write(false);
+        while (1) {
+            wait(5, SC_NS);
+            result.thread_resumes++;
+            clk.write(!clk.read());
+        }
+    }
+
+    // Entry k is written on the falling edge before rising edge k
+    void stimulus() {
+        for (size_t k = 0; k < schedule.size(); k++) {
+            drive(schedule[k]);
+            wait(10, SC_NS);
+            result.thread_resumes++;
+        }
+    }
+
+    void monitor() {
+        while (true) {
+            wait(clk.posedge_event());
+            result.thread_resumes++;
+            hash_output(result.checksum, sample());
+            if (++result.edges == schedule.size())
+                sc_stop();
+        }
+    }
+};
+
+// sc_clock drives the edges, stimulus and monitor are SC_METHODs
+struct MethodTestbench : public sc_module, public TestbenchPorts {
+    sc_in<bool> clk;
+    size_t next_input;
+
+    SC_HAS_PROCESS(MethodTestbench);
+    MethodTestbench(sc_module_name name, const std::vector<CycleIn>& schedule, RunResult& result)
+        : sc_module(name), TestbenchPorts(schedule, result), next_input(0) {
+        SC_METHOD(stimulus);
+        sensitive << clk.neg();
+
+        SC_METHOD(monitor);
+        sensitive << clk.pos();
+        dont_initialize();
+    }
+
+    void stimulus() {
+        result.method_calls++;
+        if (next_input < schedule.size())
+            drive(schedule[next_input++]);
+    }
+
+    void monitor() {
+        result.method_calls++;
+        hash_output(result.checksum, sample());
+        if (++result.edges == schedule.size())
+            sc_stop();
+    }
+};
+
+template <class Testbench>
+static void bind_testbench(Testbench& tb, InputSignals& in, OutputSignals& out) {
+    tb.rst(in.rst);
+    tb.x_in(in.x_in);
+    tb.y_in(in.y_in);
+    tb.w_in(in.w_in);
+    tb.tag_in(in.tag_in);
+    tb.x_out(out.x_out);
+    tb.y_out(out.y_out);
+    tb.w_out(out.w_out);
+    tb.tag_out(out.tag_out);
+}
+
+// Elaborate and run one array. Only callable once per process.
+template <Design D, int N>
+static RunResult run_array(bool threads, const std::vector<CycleIn>& schedule) {
+    RunResult result = { 0, 0, 0, 0, 14695981039346656037ull };
+    InputSignals in;
+    OutputSignals out;
+    SystolicArray<D, N> array("array");
+
+    if (threads) {
+        ThreadTestbench tb("tb", schedule, result);
+        bind(array, in.clk, in, out);
+        tb.clk(in.clk);
+        bind_testbench(tb, in, out);
+        auto start = std::chrono::steady_clock::now();
+        sc_start();
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } else {
+        sc_clock clk("clk", 10, SC_NS, 0.5, 5, SC_NS, true);
+        MethodTestbench tb("tb", schedule, result);
+        bind(array, clk, in, out);
+        tb.clk(clk);
+        bind_testbench(tb, in, out);
+        auto start = std::chrono::steady_clock::now();
+        sc_start();
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    return result;
+}
+
+// Runs the array picked by dispatch() in one testbench style
+struct ClockingRun {
+    bool threads;
+    const std::vector<CycleIn>& schedule;
+    RunResult result;
+
+    template <Design D, int N>
+    void run() {
+        result = run_array<D, N>(threads, schedule);
+    }
+};
+
+// Runs one testbench style in a child process
+static bool run_mode(Design d, int taps, bool threads, const std::vector<CycleIn>& schedule, RunResult& result) {
+    return run_in_child([&](RunResult& r) {
+        ClockingRun run = { threads, schedule, RunResult() };
+        bool ok = dispatch(d, taps, run);
+        r = run.result;
+        return ok;
+    }, result);
+}
+
+static void print_row(const char* mode, const RunResult& r, double per_million) {
+    cout << mode << "\t" << r.seconds << "\t" << r.seconds * per_million << "\t\t"
+         << uint64_t(r.thread_resumes * per_million + 0.5) << "\t\t"
+         << uint64_t(r.method_calls * per_million + 0.5) << endl;
+}
+
+int sc_main(int argc, char* argv[]) {
+    Design design = Design::R2;
+    if (argc > 1 && !parse_design(argv[1], design)) {
+        cout << "Unknown design " << argv[1] << endl;
+        return 1;
+    }
+    int taps = argc > 2 ? std::atoi(argv[2]) : 3;
+    size_t cycles = argc > 3 ? std::strtoul(argv[3], 0, 10) : 1000000;
+    if (std::find(supported_taps().begin(), supported_taps().end(), taps) == supported_taps().end()) {
+        cout << "Unsupported tap count " << taps << endl;
+        return 1;
+    }
+
+    std::vector<CycleIn> schedule = random_stream(cycles, 1);
+
+    cout << "Clocking " << design_name(design) << "x" << taps << " over " << cycles << " cycles" << endl;
+    RunResult threads, methods;
+    if (!run_mode(design, taps, true, schedule, threads) || !run_mode(design, taps, false, schedule, methods)) {
+        cout << "FAIL: a simulation run did not complete" << endl;
+        return 1;
+    }
+
+    // Everything below is scaled to one million clock cycles
+    double per_million = 1e6 / cycles;
+    cout << "Mode\tSeconds\tSeconds/Mcycle\tSwitches/Mcycle\tMethods/Mcycle" << endl;
+    print_row("thread", threads, per_million);
+    print_row("method", methods, per_million);
+
+    double saved = (threads.seconds - methods.seconds) * per_million;
+    uint64_t switches_saved = uint64_t((double(threads.thread_resumes) - double(methods.thread_resumes)) * per_million + 0.5);
+    cout << "Saved per Mcycle: " << switches_saved << " context switches, " << saved << " s ("
+         << (threads.seconds > 0 ? 100 * (threads.seconds - methods.seconds) / threads.seconds : 0) << "%)" << endl;
+
+    bool same = threads.edges == methods.edges && threads.checksum == methods.checksum;
+    cout << (same ? "PASS" : "FAIL") << ": outputs " << (same ? "match" : "differ") << " between modes" << endl;
+    return same ? 0 : 1;
+}
@@ -0,0 +1,210 @@
+#include <systemc.h>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "../../common/child_process.h"
+#include "../../common/dispatch.h"
+#include "../../common/golden_checker_2d.h"
+#include "../../common/harness.h"
+
+// Drives reset on the first cycle, then one pixel per cycle, then zeros
+SC_MODULE(ImageSource) {
+    sc_in<bool> clk;
+    sc_out<bool> rst;
+    sc_out<int> x_in;
+
+    const std::vector<int>& pixels;
+    uint64_t cycle;     // Input cycles driven so far
+
+    SC_HAS_PROCESS(ImageSource);
+    ImageSource(sc_module_name name, const std::vector<int>& pixels) : sc_module(name), pixels(pixels), cycle(0) {
+        SC_METHOD(drive);
+        sensitive << clk.neg();
+    }
+
+    // True if input cycle `c` carries a pixel
+    bool carries_pixel(uint64_t c) const { return c >= 1 && c <= pixels.size(); }
+
+    void drive() {
+        rst.write(cycle < 1);
+        x_in.write(carries_pixel(cycle) ? pixels[cycle - 1] : 0);
+        cycle++;
+    }
+};
+
+// Checks y_out / y_valid against the 2D golden model at every rising edge
+SC_MODULE(ImageMonitor) {
+    sc_in<bool> clk;
+    sc_in<int> x_in, y_out;
+    sc_in<bool> y_valid;
+
+    const ImageSource& source;
+    GoldenChecker2D& checker;
+    uint64_t stop_after;
+    uint64_t edges;
+
+    SC_HAS_PROCESS(ImageMonitor);
+    ImageMonitor(sc_module_name name, const ImageSource& source, GoldenChecker2D& checker, uint64_t stop_after)
+        : sc_module(name), source(source), checker(checker), stop_after(stop_after), edges(0) {
+        SC_METHOD(monitor);
+        sensitive << clk.pos();
+        dont_initialize();
+    }
+
+    void monitor() {
+        if (edges > 0)
+            checker.output(edges - 1, y_out.read(), y_valid.read());
+        if (source.carries_pixel(edges))
+            checker.sample(edges, x_in.read());
+        if (++edges == stop_after)
+            sc_stop();
+    }
+};
+
+// Measured in the child, trivially copyable so it can come back through a pipe
+struct Conv2DResult {
+    uint64_t pixels;
+    uint64_t cycles;
+    uint64_t windows;       // Results checked
+    uint64_t errors;        // Mismatches, stray y_valid and windows never produced
+    uint64_t buffer_words;
+    double seconds;
+};
+
+// One random width x height image through W2_Conv2D<K>, K taken from the tap count
+struct Conv2DRun {
+    int width, height;
+    unsigned seed;
+    int range;
+    Conv2DResult result;
+
+    template <Design D, int K>
+    void run() {
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<int> value(0, range);
+        std::vector<int> pixels(size_t(width) * height);
+        for (size_t i = 0; i < pixels.size(); i++)
+            pixels[i] = value(rng);
+
+        typedef W2_Conv2D<K> Engine;
+        GoldenChecker2D checker(default_weights(K * K), K, width, height, Engine::latency);
+        checker.set_report_limit(0);
+
+        sc_clock clk("clk", 10, SC_NS, 0.5, 5, SC_NS, true);
+        sc_signal<bool> rst, y_valid;
+        sc_signal<int> x_in, y_out;
+        Engine engine("engine", width, height);
+        ImageSource source("source", pixels);
+        // Stops on the edge that shows the last window: the zeros after the image
+        // would be the next frame's first row to the engine
+        ImageMonitor monitor("monitor", source, checker, 1 + pixels.size() + Engine::latency + 1);
+        engine.clk(clk);
+        engine.rst(rst);
+        engine.x_in(x_in);
+        engine.y_out(y_out);
+        engine.y_valid(y_valid);
+        source.clk(clk);
+        source.rst(rst);
+        source.x_in(x_in);
+        monitor.clk(clk);
+        monitor.x_in(x_in);
+        monitor.y_out(y_out);
+        monitor.y_valid(y_valid);
+
+        auto start = std::chrono::steady_clock::now();
+        sc_start();
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        result.pixels = pixels.size();
+        result.cycles = monitor.edges;
+        result.windows = checker.results_checked();
+        result.errors = checker.mismatch_count() + checker.missing_count();
+        result.buffer_words = engine.buffer_words();
+    }
+};
+
+static int usage() {
+    cout << "Usage: conv2d [--taps 3,5,...] [--widths 16,64,...] [--rows H] [--range R] [--seed S]" << endl;
+    return 1;
+}
+
+// Comma-separated integers
+static std::vector<int> int_list(char* list) {
+    std::vector<int> values;
+    for (char* t = std::strtok(list, ","); t; t = std::strtok(0, ","))
+        values.push_back(std::atoi(t));
+    return values;
+}
+
+int sc_main(int argc, char* argv[]) {
+    std::vector<int> taps = { 3, 5 };
+    std::vector<int> widths = { 16, 64, 256, 1024 };
+    int rows = 32;
+    int range = 255;
+    unsigned seed = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 == argc)
+            return usage();
+        if (std::strcmp(argv[i], "--taps") == 0) {
+            taps = int_list(argv[++i]);
+        } else if (std::strcmp(argv[i], "--widths") == 0) {
+            widths = int_list(argv[++i]);
+        } else if (std::strcmp(argv[i], "--rows") == 0) {
+            rows = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--range") == 0) {
+            range = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--seed") == 0) {
+            seed = std::strtoul(argv[++i], 0, 10);
+        } else {
+            return usage();
+        }
+    }
+    if (rows < 1 || range < 0)
+        return usage();
+    for (size_t t = 0; t < taps.size(); t++) {
+        for (size_t w = 0; w < widths.size(); w++) {
+            if (widths[w] < taps[t] || rows < taps[t]) {
+                cout << "A " << taps[t] << "x" << taps[t] << " kernel needs an image of at least " << taps[t]
+                     << "x" << taps[t] << " pixels, not " << widths[w] << "x" << rows << endl;
+                return usage();
+            }
+        }
+    }
+
+    // pixels_per_cycle counts fill and drain, windows_per_cycle only results inside
+    // the image, of which a full frame has (width - K + 1) * (rows - K + 1)
+    cout << "kernel\twidth\trows\tpixels\tcycles\tpixels_per_cycle\twindows\twindows_per_cycle\tpes"
+            "\tline_buffer_words\tline_buffer_bytes\twall_seconds\tpassed"
+         << endl;
+    bool all_passed = true;
+    for (size_t t = 0; t < taps.size(); t++) {
+        for (size_t w = 0; w < widths.size(); w++) {
+            Conv2DResult r = Conv2DResult();
+            bool ok = run_in_child([&](Conv2DResult& out) {
+                Conv2DRun run = { widths[w], rows, seed, range, Conv2DResult() };
+                bool dispatched = dispatch_taps<Design::W2>(taps[t], run);
+                out = run.result;
+                return dispatched;
+            }, r);
+            if (!ok) {
+                cout << "Failed to run a " << taps[t] << "x" << taps[t] << " kernel (unsupported tap count?)" << endl;
+                all_passed = false;
+                continue;
+            }
+            uint64_t expected = uint64_t(widths[w] - taps[t] + 1) * (rows - taps[t] + 1);
+            bool passed = r.errors == 0 && r.windows == expected;
+            all_passed &= passed;
+            cout << taps[t] << "x" << taps[t] << "\t" << widths[w] << "\t" << rows << "\t" << r.pixels << "\t"
+                 << r.cycles << "\t" << (r.cycles ? double(r.pixels) / r.cycles : 0) << "\t" << r.windows << "\t"
+                 << (r.cycles ? double(r.windows) / r.cycles : 0) << "\t" << taps[t] * taps[t] << "\t"
+                 << r.buffer_words << "\t" << r.buffer_words * sizeof(int) << "\t" << r.seconds << "\t"
+                 << (passed ? "true" : "false") << endl;
+        }
+    }
+    cout << (all_passed ? "PASS" : "FAIL") << endl;
+    return all_passed ? 0 : 1;
+}
@@ -0,0 +1,208 @@
+// Energy comes from the PE activity counters, and the PEs take the zero-skip path
+#define PE_COUNTERS
+#define ZERO_GATING
+
+#include <systemc.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "../../common/child_process.h"
+#include "../../common/dispatch.h"
+#include "../../common/energy.h"
+#include "../../common/stream_run.h"
+
+// Random samples with a fraction of x set to zero, like activations after a ReLU.
+// w and tag keep cycling through the kernel, so every design can check them.
+static std::vector<StimulusRecord> sparse_samples(uint64_t length, unsigned seed, int taps, int zero_percent) {
+    std::vector<StimulusRecord> samples = random_samples(length, seed, taps);
+    std::mt19937 rng(seed + 1);
+    std::uniform_int_distribution<int> percent(0, 99);
+    for (uint64_t i = 0; i < length; i++)
+        if (percent(rng) < zero_percent)
+            samples[i].x = 0;
+    return samples;
+}
+
+// Measured in the child, trivially copyable so it can come back through a pipe
+struct EnergyResult {
+    uint64_t cycles;
+    uint64_t errors;        // Golden-model mismatches and missing results
+    EnergyCounts counts;
+};
+
+struct EnergyRun {
+    const StimulusRecord* samples;
+    uint64_t count;
+    EnergyResult result;
+
+    template <Design D, int N>
+    void run() {
+        GoldenChecker checker = GoldenChecker::for_design(D, N, count);
+        checker.set_report_limit(0);
+        // Keep the per-PE tables -DPE_COUNTERS prints at sc_stop() out of the report
+        std::streambuf* out = cout.rdbuf(0);
+        StreamStats stats = run_stream<D, N>(samples, count, checker);
+        cout.rdbuf(out);
+        cout.clear();
+        result.cycles = stats.cycles;
+        result.errors = checker.mismatch_count() + checker.missing_count();
+        result.counts = stats.energy;
+    }
+};
+
+// One line of the table, printed once its group is ranked
+struct Row {
+    Design design;
+    int taps;
+    double zero_percent;    // Of the x samples actually streamed
+    uint64_t samples;
+    EnergyResult r;
+    double pj, gated_pj;    // Whole run, without and with zero gating
+    bool passed;
+};
+
+static int usage() {
+    cout << "Usage: energy [--designs B1,B2,...] [--taps 3,9,...] [--zeros 0,50,80] [--length samples] [--file stimulus]"
+         << endl
+         << "              [--seed S] [--mac-pj E] [--register-pj E] [--hop-pj E]" << endl
+         << "       --zeros is the share of zero x samples in percent, energies are in pJ" << endl;
+    return 1;
+}
+
+// Comma-separated integers
+static std::vector<int> int_list(char* list) {
+    std::vector<int> values;
+    for (char* t = std::strtok(list, ","); t; t = std::strtok(0, ","))
+        values.push_back(std::atoi(t));
+    return values;
+}
+
+int sc_main(int argc, char* argv[]) {
+    std::vector<Design> designs = { Design::B1, Design::B2, Design::F, Design::R1, Design::R2, Design::W1,
+                                    Design::W2 };
+    std::vector<int> taps = { 9 };
+    std::vector<int> zeros = { 0, 50, 80 };
+    uint64_t length = 100000;
+    const char* path = 0;
+    unsigned seed = 1;
+    EnergyModel model;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 == argc)
+            return usage();
+        if (std::strcmp(argv[i], "--designs") == 0) {
+            designs.clear();
+            for (char* t = std::strtok(argv[++i], ","); t; t = std::strtok(0, ",")) {
+                Design d;
+                if (!parse_design(t, d)) {
+                    cout << "Unknown design " << t << endl;
+                    return 1;
+                }
+                designs.push_back(d);
+            }
+        } else if (std::strcmp(argv[i], "--taps") == 0) {
+            taps = int_list(argv[++i]);
+        } else if (std::strcmp(argv[i], "--zeros") == 0) {
+            zeros = int_list(argv[++i]);
+        } else if (std::strcmp(argv[i], "--length") == 0) {
+            length = std::strtoull(argv[++i], 0, 10);
+        } else if (std::strcmp(argv[i], "--file") == 0) {
+            path = argv[++i];
+        } else if (std::strcmp(argv[i], "--seed") == 0) {
+            seed = std::strtoul(argv[++i], 0, 10);
+        } else if (std::strcmp(argv[i], "--mac-pj") == 0) {
+            model.mac_pj = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--register-pj") == 0) {
+            model.register_pj = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--hop-pj") == 0) {
+            model.hop_pj = std::atof(argv[++i]);
+        } else {
+            return usage();
+        }
+    }
+
+    // A stimulus file replaces the random streams, at its own kernel size
+    StimulusFile file;
+    if (path) {
+        if (!file.open(path)) {
+            cout << file.error() << endl;
+            return 1;
+        }
+        zeros.assign(1, -1);
+        if (file.taps())
+            taps.assign(1, int(file.taps()));
+    }
+
+    // Energy per sample ranks the designs within each kernel size and sparsity; rank 1
+    // uses the least with zero gating. The gated multiplies must be exactly the ones
+    // with a zero operand.
+    cout << "design\ttaps\tzero_x_percent\tsamples\tcycles\tmultiplies\tuseful_macs\tgated_macs\tregister_writes"
+            "\thops\tenergy_nj\tgated_energy_nj\tpj_per_sample\tgated_pj_per_sample\tsaving_percent\trank\tpassed"
+         << endl;
+    bool all_passed = true;
+    for (size_t t = 0; t < taps.size(); t++) {
+        for (size_t z = 0; z < zeros.size(); z++) {
+            std::vector<StimulusRecord> generated;
+            const StimulusRecord* samples = file.data();
+            uint64_t count = file.size();
+            if (!path) {
+                generated = sparse_samples(length, seed, taps[t], zeros[z]);
+                samples = generated.data();
+                count = generated.size();
+            }
+            uint64_t zero_x = 0;
+            for (uint64_t i = 0; i < count; i++)
+                zero_x += samples[i].x == 0;
+
+            std::vector<Row> rows;
+            for (size_t d = 0; d < designs.size(); d++) {
+                EnergyResult r = EnergyResult();
+                bool ok = run_in_child([&](EnergyResult& out) {
+                    EnergyRun run = { samples, count, EnergyResult() };
+                    bool dispatched = dispatch(designs[d], taps[t], run);
+                    out = run.result;
+                    return dispatched;
+                }, r);
+                if (!ok) {
+                    cout << "Failed to run " << design_name(designs[d]) << "x" << taps[t]
+                         << " (unsupported tap count?)" << endl;
+                    all_passed = false;
+                    continue;
+                }
+                Row row = { designs[d], taps[t], count ? 100.0 * zero_x / count : 0, count, r,
+                            model.total(r.counts, false) / 1000, model.total(r.counts, true) / 1000, false };
+                row.passed = r.errors == 0 && r.counts.counted &&
+                             r.counts.gated_macs == r.counts.cycles - r.counts.useful_macs;
+                all_passed &= row.passed;
+                rows.push_back(row);
+            }
+
+            std::vector<size_t> order(rows.size());
+            for (size_t i = 0; i < order.size(); i++)
+                order[i] = i;
+            std::stable_sort(order.begin(), order.end(),
+                             [&rows](size_t a, size_t b) { return rows[a].gated_pj < rows[b].gated_pj; });
+            std::vector<size_t> rank(rows.size());
+            for (size_t i = 0; i < order.size(); i++)
+                rank[order[i]] = i + 1;
+
+            for (size_t i = 0; i < rows.size(); i++) {
+                const Row& row = rows[i];
+                const EnergyCounts& c = row.r.counts;
+                double per = row.samples ? 1000.0 / row.samples : 0;
+                cout << design_name(row.design) << "\t" << row.taps << "\t" << row.zero_percent << "\t" << row.samples
+                     << "\t" << row.r.cycles << "\t" << c.cycles << "\t" << c.useful_macs << "\t" << c.gated_macs
+                     << "\t" << c.register_writes << "\t" << c.hops << "\t" << row.pj << "\t" << row.gated_pj << "\t"
+                     << row.pj * per << "\t" << row.gated_pj * per << "\t"
+                     << (row.pj > 0 ? 100 * (1 - row.gated_pj / row.pj) : 0) << "\t" << rank[i] << "\t"
+                     << (row.passed ? "true" : "false") << endl;
+            }
+        }
+    }
+    cout << (all_passed ? "PASS" : "FAIL") << endl;
+    return all_passed ? 0 : 1;
+}
@@ -0,0 +1,238 @@
+#include <systemc.h>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "../../common/child_process.h"
+#include "../../common/designs.h"
+#include "../../common/gemm.h"
+
+// Measured in the child, trivially copyable so it can come back through a pipe
+struct GemmResult {
+    uint64_t cycles;
+    uint64_t errors;        // Outputs of the layer that differ from the direct convolution
+    uint64_t gemm_errors;   // Entries of C that differ from A * B
+    double seconds;
+};
+
+// One conv layer through W1_Gemm<ROWS, COLS>: im2col, then every tile of B shifted
+// in through w_load, every row of A streamed through it and each row of C added
+// into the accumulator as it leaves the array, driven cycle by cycle from sc_main
+struct GemmRun {
+    const ConvLayer& layer;
+    const std::vector<int>& input;
+    const std::vector<int>& weights;
+    GemmResult result;
+
+    template <int ROWS, int COLS>
+    void run() {
+        typedef W1_Gemm<ROWS, COLS> Engine;
+        Matrix a = im2col(layer, input);
+        Matrix b = conv_weight_matrix(layer, weights);
+        GemmTiling tiling = { a.rows, a.cols, b.cols, ROWS, COLS, Engine::latency };
+
+        sc_signal<bool> clk, rst, w_load;
+        sc_vector<sc_signal<int> > a_in("a_in", ROWS), c_out("c_out", COLS), w_in("w_in", COLS);
+        Engine engine("engine");
+        engine.clk(clk);
+        engine.rst(rst);
+        engine.w_load(w_load);
+        for (int i = 0; i < ROWS; i++)
+            engine.a_in[i](a_in[i]);
+        for (int j = 0; j < COLS; j++) {
+            engine.c_out[j](c_out[j]);
+            engine.w_in[j](w_in[j]);
+        }
+
+        Matrix c(a.rows, b.cols);
+        uint64_t edges = 0;
+        auto start = std::chrono::steady_clock::now();
+
+        // One rising edge, then the falling edge, as InputSignals::cycle() does
+        auto cycle = [&]() {
+            clk.write(true);
+            sc_start(5, SC_NS);
+            clk.write(false);
+            sc_start(5, SC_NS);
+            edges++;
+        };
+
+        rst.write(true);
+        cycle();
+        rst.write(false);
+        for (int n0 = 0; n0 < b.cols; n0 += COLS) {
+            for (int k0 = 0; k0 < a.cols; k0 += ROWS) {
+                // Rows of the tile bottom-up, each shifts the ones before down a PE row
+                w_load.write(true);
+                for (int s = 0; s < ROWS; s++) {
+                    int k = k0 + ROWS - 1 - s;
+                    for (int j = 0; j < COLS; j++)
+                        w_in[j].write(k < b.rows && n0 + j < b.cols ? b.at(k, n0 + j) : 0);
+                    cycle();
+                }
+                w_load.write(false);
+
+                // Row m of A goes in on edge first + m, its row of C is on c_out
+                // right after edge first + m + latency
+                uint64_t first = edges;
+                for (int m = 0; m < a.rows + Engine::latency; m++) {
+                    for (int i = 0; i < ROWS; i++)
+                        a_in[i].write(m < a.rows && k0 + i < a.cols ? a.at(m, k0 + i) : 0);
+                    cycle();
+                    long long out = (long long)(edges - 1 - first) - Engine::latency;
+                    if (out >= 0)
+                        for (int j = 0; j < COLS && n0 + j < b.cols; j++)
+                            c.at(int(out), n0 + j) += c_out[j].read();
+                }
+            }
+        }
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        result.cycles = edges;
+
+        Matrix expected = gemm_reference(a, b);
+        for (size_t i = 0; i < c.v.size(); i++)
+            result.gemm_errors += c.v[i] != expected.v[i];
+        std::vector<int> out = col2im(layer, c), reference = conv_reference(layer, input, weights);
+        for (size_t i = 0; i < out.size(); i++)
+            result.errors += out[i] != reference[i];
+        if (edges != tiling.cycles())
+            cout << "Ran " << edges << " cycles, the tiling says " << tiling.cycles() << endl;
+    }
+};
+
+// Array sizes built into the bench, rows and columns each one of these
+static const int array_sizes[] = { 4, 8, 16, 32 };
+
+template <int ROWS, class Fn>
+static bool dispatch_cols(int cols, Fn& fn) {
+    switch (cols) {
+    case 4:  fn.template run<ROWS, 4>(); return true;
+    case 8:  fn.template run<ROWS, 8>(); return true;
+    case 16: fn.template run<ROWS, 16>(); return true;
+    case 32: fn.template run<ROWS, 32>(); return true;
+    }
+    return false;
+}
+
+template <class Fn>
+static bool dispatch_array(int rows, int cols, Fn& fn) {
+    switch (rows) {
+    case 4:  return dispatch_cols<4>(cols, fn);
+    case 8:  return dispatch_cols<8>(cols, fn);
+    case 16: return dispatch_cols<16>(cols, fn);
+    case 32: return dispatch_cols<32>(cols, fn);
+    }
+    return false;
+}
+
+static int usage() {
+    cout << "Usage: gemm [--arrays 4x4,8x8,...] [--layers C,H,W,filters,K/...] [--range R] [--seed S]" << endl
+         << "       array rows and columns each one of";
+    for (size_t i = 0; i < sizeof(array_sizes) / sizeof(array_sizes[0]); i++)
+        cout << " " << array_sizes[i];
+    cout << endl;
+    return 1;
+}
+
+// Comma-separated integers
+static std::vector<int> int_list(char* list) {
+    std::vector<int> values;
+    for (char* t = std::strtok(list, ","); t; t = std::strtok(0, ","))
+        values.push_back(std::atoi(t));
+    return values;
+}
+
+int sc_main(int argc, char* argv[]) {
+    std::vector<std::pair<int, int> > arrays = { { 4, 4 }, { 8, 8 }, { 16, 16 } };
+    // An RGB input layer and a deeper one with more channels than the arrays have rows
+    std::vector<ConvLayer> layers = { { 3, 32, 32, 16, 3 }, { 16, 16, 16, 32, 3 } };
+    int range = 8;
+    unsigned seed = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 == argc)
+            return usage();
+        if (std::strcmp(argv[i], "--arrays") == 0) {
+            arrays.clear();
+            for (char* t = std::strtok(argv[++i], ","); t; t = std::strtok(0, ",")) {
+                int rows = 0, cols = 0;
+                if (std::sscanf(t, "%dx%d", &rows, &cols) != 2)
+                    return usage();
+                arrays.push_back(std::make_pair(rows, cols));
+            }
+        } else if (std::strcmp(argv[i], "--layers") == 0) {
+            layers.clear();
+            std::vector<std::string> specs;
+            for (char* t = std::strtok(argv[++i], "/"); t; t = std::strtok(0, "/"))
+                specs.push_back(t);
+            for (size_t s = 0; s < specs.size(); s++) {
+                std::vector<int> v = int_list(&specs[s][0]);
+                if (v.size() != 5)
+                    return usage();
+                ConvLayer l = { v[0], v[1], v[2], v[3], v[4] };
+                if (!l.valid()) {
+                    cout << "Layer " << specs[s] << " has no output" << endl;
+                    return 1;
+                }
+                layers.push_back(l);
+            }
+        } else if (std::strcmp(argv[i], "--range") == 0) {
+            range = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--seed") == 0) {
+            seed = std::strtoul(argv[++i], 0, 10);
+        } else {
+            return usage();
+        }
+    }
+    if (range < 0)
+        return usage();
+
+    // macs counts the layer's multiply-adds, utilization divides them by every
+    // PE-cycle of the run and stream_utilization only by those of the streaming
+    // cycles, so the difference between the two is the tile-switch overhead: shifting
+    // each tile's weights in and draining the array before the next
+    cout << "array\tlayer\tM\tK\tN\ttiles\tcycles\tmacs\tmacs_per_cycle\tutilization\tstream_utilization"
+            "\tload_cycles\tdrain_cycles\tswitch_overhead\twall_seconds\tpassed"
+         << endl;
+    bool all_passed = true;
+    for (size_t l = 0; l < layers.size(); l++) {
+        const ConvLayer& layer = layers[l];
+        std::vector<int> input = random_values(size_t(layer.in_channels) * layer.height * layer.width, seed, range);
+        std::vector<int> weights = random_values(size_t(layer.out_channels) * layer.gemm_k(), seed + 1, range);
+        std::string name = std::to_string(layer.in_channels) + "x" + std::to_string(layer.height) + "x" +
+                           std::to_string(layer.width) + "->" + std::to_string(layer.out_channels) + "@" +
+                           std::to_string(layer.kernel) + "x" + std::to_string(layer.kernel);
+
+        for (size_t s = 0; s < arrays.size(); s++) {
+            int rows = arrays[s].first, cols = arrays[s].second;
+            GemmResult r = GemmResult();
+            bool ok = run_in_child([&](GemmResult& out) {
+                GemmRun run = { layer, input, weights, GemmResult() };
+                bool dispatched = dispatch_array(rows, cols, run);
+                out = run.result;
+                return dispatched;
+            }, r);
+            if (!ok) {
+                cout << "Failed to run a " << rows << "x" << cols << " array (unsupported size?)" << endl;
+                all_passed = false;
+                continue;
+            }
+
+            GemmTiling t = { layer.gemm_m(), layer.gemm_k(), layer.gemm_n(), rows, cols, rows + cols - 2 };
+            bool passed = r.errors == 0 && r.gemm_errors == 0 && r.cycles == t.cycles();
+            all_passed &= passed;
+            double pe_cycles = double(r.cycles) * rows * cols;
+            cout << rows << "x" << cols << "\t" << name << "\t" << t.m << "\t" << t.k << "\t" << t.n << "\t"
+                 << t.tiles() << "\t" << r.cycles << "\t" << t.useful_macs() << "\t"
+                 << double(t.useful_macs()) / r.cycles << "\t" << t.useful_macs() / pe_cycles << "\t"
+                 << double(t.useful_macs()) / t.streamed_macs() << "\t" << t.load_cycles() << "\t"
+                 << t.drain_cycles() << "\t" << double(t.load_cycles() + t.drain_cycles()) / r.cycles << "\t"
+                 << r.seconds << "\t" << (passed ? "true" : "false") << endl;
+        }
+    }
+    cout << (all_passed ? "PASS" : "FAIL") << endl;
+    return all_passed ? 0 : 1;
+}
@@ -0,0 +1,152 @@
+#include <systemc.h>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include "../../common/child_process.h"
+#include "../../common/dispatch.h"
+#include "../../common/stream_run.h"
+
+// Bursts of `burst` random samples separated by `gap` samples with x, w and tag all
+// zero. R1 and R2 load their weights from the stream, so for them both lengths are
+// rounded up to a multiple of N and every burst starts on a w1 tag.
+static std::vector<StimulusRecord> sparse_samples(Design d, int n, uint64_t length, uint64_t burst, uint64_t gap,
+                                                  unsigned seed) {
+    if (d == Design::R1 || d == Design::R2) {
+        burst = (burst + n - 1) / n * n;
+        gap = (gap + n - 1) / n * n;
+    }
+    std::vector<StimulusRecord> samples = random_samples(length, seed, n);
+    for (uint64_t i = 0; i < length; i++) {
+        if (i % (burst + gap) >= burst) {
+            samples[i].x = 0;
+            samples[i].w = 0;
+            samples[i].tag = 0;
+        }
+    }
+    return samples;
+}
+
+// Measured in the child, trivially copyable so it can come back through a pipe
+struct IdleResult {
+    uint64_t cycles;
+    uint64_t skipped;
+    uint64_t errors;        // Golden-model mismatches and missing results, not counted for R1/R2
+    uint64_t output_hash;
+    double seconds;
+};
+
+// One run of the sparse stream, with or without skipping idle edges
+struct IdleRun {
+    const std::vector<StimulusRecord>& samples;
+    bool skip_idle;
+    IdleResult result;
+
+    template <Design D, int N>
+    void run() {
+        GoldenChecker checker = GoldenChecker::for_design(D, N, samples.size());
+        checker.set_report_limit(0);
+        StreamStats stats = run_stream<D, N>(samples.data(), samples.size(), checker, false, TraceConfig(), skip_idle);
+        result.cycles = stats.cycles;
+        result.skipped = stats.skipped;
+        // The golden model of R1/R2 expects the kernel on every sample, the gaps break that
+        bool streamed = D == Design::R1 || D == Design::R2;
+        result.errors = streamed ? 0 : checker.mismatch_count() + checker.missing_count();
+        result.output_hash = stats.output_hash;
+        result.seconds = stats.seconds;
+    }
+};
+
+static int usage() {
+    cout << "Usage: idle [--designs B1,B2,...] [--taps 3,9,...] [--length samples] [--burst samples] [--gap samples]"
+         << endl
+         << "            [--seed S]" << endl;
+    return 1;
+}
+
+// Comma-separated integers
+static std::vector<int> int_list(char* list) {
+    std::vector<int> values;
+    for (char* t = std::strtok(list, ","); t; t = std::strtok(0, ","))
+        values.push_back(std::atoi(t));
+    return values;
+}
+
+int sc_main(int argc, char* argv[]) {
+    std::vector<Design> designs = { Design::B1, Design::B2, Design::F, Design::R1, Design::R2, Design::W1,
+                                    Design::W2 };
+    std::vector<int> taps = { 3, 9 };
+    uint64_t length = 200000;
+    uint64_t burst = 100, gap = 900;
+    unsigned seed = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 == argc)
+            return usage();
+        if (std::strcmp(argv[i], "--designs") == 0) {
+            designs.clear();
+            for (char* t = std::strtok(argv[++i], ","); t; t = std::strtok(0, ",")) {
+                Design d;
+                if (!parse_design(t, d)) {
+                    cout << "Unknown design " << t << endl;
+                    return 1;
+                }
+                designs.push_back(d);
+            }
+        } else if (std::strcmp(argv[i], "--taps") == 0) {
+            taps = int_list(argv[++i]);
+        } else if (std::strcmp(argv[i], "--length") == 0) {
+            length = std::strtoull(argv[++i], 0, 10);
+        } else if (std::strcmp(argv[i], "--burst") == 0) {
+            burst = std::strtoull(argv[++i], 0, 10);
+        } else if (std::strcmp(argv[i], "--gap") == 0) {
+            gap = std::strtoull(argv[++i], 0, 10);
+        } else if (std::strcmp(argv[i], "--seed") == 0) {
+            seed = std::strtoul(argv[++i], 0, 10);
+        } else {
+            return usage();
+        }
+    }
+    if (burst == 0 || length == 0)
+        return usage();
+
+    // Skipping must leave y_out identical on every cycle, skipped ones included
+    cout << "design\ttaps\tsamples\tcycles\tskipped_cycles\tskipped_percent\tfull_seconds\tskip_seconds\tspeedup"
+            "\tmatches_full\tpassed" << endl;
+    bool all_passed = true;
+    for (size_t d = 0; d < designs.size(); d++) {
+        for (size_t t = 0; t < taps.size(); t++) {
+            std::vector<StimulusRecord> samples = sparse_samples(designs[d], taps[t], length, burst, gap, seed);
+            IdleResult full = IdleResult(), skipping = IdleResult();
+            bool ok = run_in_child([&](IdleResult& out) {
+                IdleRun run = { samples, false, IdleResult() };
+                bool dispatched = dispatch(designs[d], taps[t], run);
+                out = run.result;
+                return dispatched;
+            }, full);
+            ok = ok && run_in_child([&](IdleResult& out) {
+                IdleRun run = { samples, true, IdleResult() };
+                bool dispatched = dispatch(designs[d], taps[t], run);
+                out = run.result;
+                return dispatched;
+            }, skipping);
+            if (!ok) {
+                cout << "Failed to run " << design_name(designs[d]) << "x" << taps[t]
+                     << " (unsupported tap count?)" << endl;
+                all_passed = false;
+                continue;
+            }
+            bool matches = full.output_hash == skipping.output_hash && full.cycles == skipping.cycles;
+            bool passed = matches && full.errors == 0 && skipping.errors == 0;
+            all_passed &= passed;
+            cout << design_name(designs[d]) << "\t" << taps[t] << "\t" << length << "\t" << skipping.cycles << "\t"
+                 << skipping.skipped << "\t" << (skipping.cycles ? 100.0 * skipping.skipped / skipping.cycles : 0)
+                 << "\t" << full.seconds << "\t" << skipping.seconds << "\t"
+                 << (skipping.seconds > 0 ? full.seconds / skipping.seconds : 0) << "\t"
+                 << (matches ? "true" : "false") << "\t" << (passed ? "true" : "false") << endl;
+        }
+    }
+    cout << (all_passed ? "PASS" : "FAIL") << endl;
+    return all_passed ? 0 : 1;
+}
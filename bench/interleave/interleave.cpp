@@ -0,0 +1,201 @@
+#include <systemc.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "../../common/child_process.h"
+#include "../../common/dispatch.h"
+#include "../../common/stream_run.h"
+
+// Checks both demultiplexed outputs of W1_Interleaved against their own golden
+// model and stops once the pipeline has drained
+SC_MODULE(InterleaveMonitor) {
+    sc_in<bool> clk;
+    sc_in<int> x_a, x_b;
+    sc_in<int> y_a, y_b;
+
+    const StimulusSource& source_a;
+    const StimulusSource& source_b;
+    GoldenChecker& checker_a;
+    GoldenChecker& checker_b;
+    uint64_t stop_after;
+    uint64_t edges;
+
+    SC_HAS_PROCESS(InterleaveMonitor);
+    InterleaveMonitor(sc_module_name name, const StimulusSource& source_a, const StimulusSource& source_b,
+                      GoldenChecker& checker_a, GoldenChecker& checker_b, uint64_t stop_after)
+        : sc_module(name), source_a(source_a), source_b(source_b), checker_a(checker_a), checker_b(checker_b),
+          stop_after(stop_after), edges(0) {
+        SC_METHOD(monitor);
+        sensitive << clk.pos();
+        dont_initialize();
+    }
+
+    // The demux adds a cycle, so y_a and y_b now hold the results of two edges ago
+    void monitor() {
+        if (edges > 1) {
+            checker_a.output(edges - 2, y_a.read());
+            checker_b.output(edges - 2, y_b.read());
+        }
+        if (source_a.carries_sample(edges))
+            checker_a.sample(edges, x_a.read());
+        if (source_b.carries_sample(edges))
+            checker_b.sample(edges, x_b.read());
+        if (++edges == stop_after)
+            sc_stop();
+    }
+};
+
+// Stream a on the even input cycles and b on the odd ones of one W1_Interleaved<N>.
+// Only callable once per process.
+template <int N>
+inline StreamStats run_interleaved(const std::vector<StimulusRecord>& a, const std::vector<StimulusRecord>& b,
+                                   GoldenChecker& checker_a, GoldenChecker& checker_b) {
+    sc_clock clk("clk", 10, SC_NS, 0.5, 5, SC_NS, true);
+    sc_signal<bool> rst, rst_b;
+    sc_signal<int> x_a, x_b, y_a, y_b;
+    sc_signal<int> y_in_a, y_in_b, w_in_a, w_in_b;
+    sc_signal<bool> tag_in_a, tag_in_b;
+    W1_Interleaved<N> array("array");
+    StimulusSource source_a("source_a", a.data(), a.size(), 2);
+    StimulusSource source_b("source_b", b.data(), b.size(), 2, 1, 1);
+    uint64_t stop_after = std::max(source_a.total_cycles(), source_b.total_cycles()) + 2 * N + 8;
+    InterleaveMonitor monitor("monitor", source_a, source_b, checker_a, checker_b, stop_after);
+
+    array.clk(clk);
+    array.rst(rst);
+    array.x_a(x_a);
+    array.x_b(x_b);
+    array.y_a(y_a);
+    array.y_b(y_b);
+    // Source a drives the shared reset, source b's goes nowhere
+    source_a.clk(clk);
+    source_a.rst(rst);
+    source_a.x_in(x_a);
+    source_a.y_in(y_in_a);
+    source_a.w_in(w_in_a);
+    source_a.tag_in(tag_in_a);
+    source_b.clk(clk);
+    source_b.rst(rst_b);
+    source_b.x_in(x_b);
+    source_b.y_in(y_in_b);
+    source_b.w_in(w_in_b);
+    source_b.tag_in(tag_in_b);
+    monitor.clk(clk);
+    monitor.x_a(x_a);
+    monitor.x_b(x_b);
+    monitor.y_a(y_a);
+    monitor.y_b(y_b);
+
+    auto start = std::chrono::steady_clock::now();
+    sc_start();
+    StreamStats stats;
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    stats.samples = a.size() + b.size();
+    stats.cycles = monitor.edges;
+    return stats;
+}
+
+// Measured in the child, trivially copyable so it can come back through a pipe
+struct InterleaveResult {
+    uint64_t samples;
+    uint64_t cycles;
+    uint64_t results;
+    uint64_t errors;        // Mismatches plus results never produced
+    double seconds;
+};
+
+// One length-sample stream through W1, or two through W1_Interleaved
+struct InterleaveRun {
+    uint64_t length;
+    unsigned seed;
+    bool interleaved;
+    InterleaveResult result;
+
+    template <Design D, int N>
+    void run() {
+        std::vector<StimulusRecord> a = random_samples(length, seed, N);
+        GoldenChecker checker_a = GoldenChecker::for_design(Design::W1, N, a.size());
+        checker_a.set_report_limit(0);
+        StreamStats stats;
+        if (interleaved) {
+            std::vector<StimulusRecord> b = random_samples(length, seed + 1, N);
+            GoldenChecker checker_b = GoldenChecker::for_design(Design::W1, N, b.size());
+            checker_b.set_report_limit(0);
+            stats = run_interleaved<N>(a, b, checker_a, checker_b);
+            result.results = checker_a.results_checked() + checker_b.results_checked();
+            result.errors = checker_a.mismatch_count() + checker_a.missing_count() + checker_b.mismatch_count() +
+                            checker_b.missing_count();
+        } else {
+            stats = run_stream<Design::W1, N>(a.data(), a.size(), checker_a);
+            result.results = checker_a.results_checked();
+            result.errors = checker_a.mismatch_count() + checker_a.missing_count();
+        }
+        result.samples = stats.samples;
+        result.cycles = stats.cycles;
+        result.seconds = stats.seconds;
+    }
+};
+
+static int usage() {
+    cout << "Usage: interleave [--taps 3,9,...] [--length samples] [--seed S]" << endl;
+    return 1;
+}
+
+int sc_main(int argc, char* argv[]) {
+    std::vector<int> taps = { 3, 9, 25 };
+    uint64_t length = 100000;
+    unsigned seed = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 == argc)
+            return usage();
+        if (std::strcmp(argv[i], "--taps") == 0) {
+            taps.clear();
+            for (char* t = std::strtok(argv[++i], ","); t; t = std::strtok(0, ","))
+                taps.push_back(std::atoi(t));
+        } else if (std::strcmp(argv[i], "--length") == 0) {
+            length = std::strtoull(argv[++i], 0, 10);
+        } else if (std::strcmp(argv[i], "--seed") == 0) {
+            seed = std::strtoul(argv[++i], 0, 10);
+        } else {
+            return usage();
+        }
+    }
+
+    // Same per-stream length both ways, so throughput is samples per simulated cycle
+    cout << "taps\tmode\tstreams\tsamples\tcycles\tsamples_per_cycle\twall_seconds\tsamples_per_second\tpassed"
+         << endl;
+    bool all_passed = true;
+    for (size_t t = 0; t < taps.size(); t++) {
+        double per_cycle[2] = { 0, 0 };
+        for (int mode = 0; mode < 2; mode++) {
+            InterleaveResult r = InterleaveResult();
+            bool ok = run_in_child([&](InterleaveResult& out) {
+                InterleaveRun run = { length, seed, mode == 1, InterleaveResult() };
+                bool dispatched = dispatch_taps<Design::W1>(taps[t], run);
+                out = run.result;
+                return dispatched;
+            }, r);
+            if (!ok) {
+                cout << "Failed to run W1x" << taps[t] << " (unsupported tap count?)" << endl;
+                all_passed = false;
+                continue;
+            }
+            bool passed = r.errors == 0 && r.results > 0;
+            all_passed &= passed;
+            per_cycle[mode] = r.cycles ? double(r.samples) / r.cycles : 0;
+            cout << taps[t] << "\t" << (mode ? "interleaved" : "single") << "\t" << (mode ? 2 : 1) << "\t"
+                 << r.samples << "\t" << r.cycles << "\t" << per_cycle[mode] << "\t" << r.seconds << "\t"
+                 << (r.seconds > 0 ? r.samples / r.seconds : 0) << "\t" << (passed ? "true" : "false") << endl;
+        }
+        if (per_cycle[0] > 0)
+            cout << "W1x" << taps[t] << " throughput gain: " << per_cycle[1] / per_cycle[0] << "x" << endl;
+    }
+    cout << (all_passed ? "PASS" : "FAIL") << endl;
+    return all_passed ? 0 : 1;
+}
@@ -0,0 +1,253 @@
+#include <systemc.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "../../common/child_process.h"
+#include "../../common/dispatch.h"
+#include "../../common/harness.h"
+#include "../../common/multi_filter.h"
+#include "../../common/schedule.h"
+
+// Measured in the child, trivially copyable so it can come back through a pipe
+struct MultiResult {
+    uint64_t cycles;
+    uint64_t checked;       // Results compared, over all filters
+    uint64_t mismatches;
+    double seconds;
+};
+
+// Filter f's inputs: the schedule's x, tags and stalls, with its own kernel on w_in
+static std::vector<CycleIn> filter_cycles(const Schedule& s, const std::vector<int>& kernel) {
+    return schedule_cycles(s.design, kernel, s.x, s.shape, s.cycles.size());
+}
+
+// Compares y_out at the schedule's result cycles with the full windows of x under `kernel`
+static void check(const Schedule& s, const std::vector<int>& kernel, const std::vector<int>& y, MultiResult& r) {
+    std::vector<int> expected = convolve_full(kernel, s.x);
+    for (size_t m = 0; m < expected.size(); m++) {
+        r.mismatches += y[s.result_cycles[m]] != expected[m];
+        r.checked++;
+    }
+}
+
+// All filters at once through MultiFilter<D, N>, one x stream, driven cycle by cycle
+struct ParallelRun {
+    const Schedule& schedule;
+    const std::vector<std::vector<int> >& kernels;
+    MultiResult result;
+
+    template <Design D, int N>
+    void run() {
+        int filters = int(kernels.size());
+        InputSignals in;
+        sc_vector<sc_signal<int> > w_in("w_in", filters), y_out("y_out", filters);
+        sc_vector<sc_signal<bool> > y_valid("y_valid", filters);
+        MultiFilter<D, N> bank("bank", filters);
+        bank.clk(in.clk);
+        bank.rst(in.rst);
+        bank.x_in(in.x_in);
+        bank.y_in(in.y_in);
+        bank.tag_in(in.tag_in);
+        bank.w_load(in.w_load);
+        std::vector<std::vector<CycleIn> > cycles(filters);
+        for (int f = 0; f < filters; f++) {
+            bank.w_in[f](w_in[f]);
+            bank.y_out[f](y_out[f]);
+            bank.y_valid[f](y_valid[f]);
+            bank.set_weights(f, kernels[f]);
+            cycles[f] = filter_cycles(schedule, kernels[f]);
+        }
+
+        size_t length = schedule.cycles.size();
+        std::vector<std::vector<int> > y(filters, std::vector<int>(length));
+        auto start = std::chrono::steady_clock::now();
+        for (size_t c = 0; c < length; c++) {
+            for (int f = 0; f < filters; f++)
+                w_in[f].write(cycles[f][c].w);
+            in.cycle(cycles[0][c]);
+            for (int f = 0; f < filters; f++)
+                y[f][c] = y_out[f].read();
+        }
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        result.cycles = length;
+        for (int f = 0; f < filters; f++)
+            check(schedule, kernels[f], y[f], result);
+    }
+};
+
+// One filter through a single SystolicArray<D, N>, as one of M sequential runs
+struct SingleRun {
+    const Schedule& schedule;
+    const std::vector<int>& kernel;
+    MultiResult result;
+
+    template <Design D, int N>
+    void run() {
+        InputSignals in;
+        OutputSignals out;
+        SystolicArray<D, N> array("array");
+        bind(array, in, out);
+        load_kernel(array, kernel);
+        std::vector<CycleIn> cycles = filter_cycles(schedule, kernel);
+
+        std::vector<int> y(cycles.size());
+        auto start = std::chrono::steady_clock::now();
+        for (size_t c = 0; c < cycles.size(); c++) {
+            in.cycle(cycles[c]);
+            y[c] = out.read().y;
+        }
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        result.cycles = cycles.size();
+        check(schedule, kernel, y, result);
+    }
+};
+
+// M runs, each in a fresh child, summed; false if one fails to run
+static bool run_sequential(const Schedule& s, const std::vector<std::vector<int> >& kernels, MultiResult& total) {
+    total = MultiResult();
+    for (size_t f = 0; f < kernels.size(); f++) {
+        MultiResult r = MultiResult();
+        bool ok = run_in_child([&](MultiResult& out) {
+            SingleRun run = { s, kernels[f], MultiResult() };
+            bool dispatched = dispatch(s.design, s.taps(), run);
+            out = run.result;
+            return dispatched;
+        }, r);
+        if (!ok)
+            return false;
+        total.cycles += r.cycles;
+        total.checked += r.checked;
+        total.mismatches += r.mismatches;
+        total.seconds += r.seconds;
+    }
+    return true;
+}
+
+static int usage() {
+    cout << "Usage: multifilter [--designs B1,R2,...] [--taps 3,9,...] [--filters 1,2,4,...] [--samples L]" << endl
+         << "                   [--range R] [--seed S]" << endl;
+    return 1;
+}
+
+// Comma-separated integers
+static std::vector<int> int_list(char* list) {
+    std::vector<int> values;
+    for (char* t = std::strtok(list, ","); t; t = std::strtok(0, ","))
+        values.push_back(std::atoi(t));
+    return values;
+}
+
+int sc_main(int argc, char* argv[]) {
+    std::vector<Design> designs = { Design::B1, Design::B2, Design::F, Design::R1,
+                                    Design::R2, Design::W1, Design::W2 };
+    std::vector<int> taps = { 3, 9 };
+    std::vector<int> filters = { 1, 2, 4, 8, 16 };
+    uint64_t samples = 1000;
+    int range = 8;
+    unsigned seed = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 == argc)
+            return usage();
+        if (std::strcmp(argv[i], "--designs") == 0) {
+            designs.clear();
+            for (char* t = std::strtok(argv[++i], ","); t; t = std::strtok(0, ",")) {
+                Design d;
+                if (!parse_design(t, d)) {
+                    cout << "Unknown design " << t << endl;
+                    return 1;
+                }
+                designs.push_back(d);
+            }
+        } else if (std::strcmp(argv[i], "--taps") == 0) {
+            taps = int_list(argv[++i]);
+        } else if (std::strcmp(argv[i], "--filters") == 0) {
+            filters = int_list(argv[++i]);
+        } else if (std::strcmp(argv[i], "--samples") == 0) {
+            samples = std::strtoull(argv[++i], 0, 10);
+        } else if (std::strcmp(argv[i], "--range") == 0) {
+            range = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--seed") == 0) {
+            seed = std::strtoul(argv[++i], 0, 10);
+        } else {
+            return usage();
+        }
+    }
+    if (samples == 0 || range < 0 || filters.empty())
+        return usage();
+    for (size_t m = 0; m < filters.size(); m++)
+        if (filters[m] < 1)
+            return usage();
+
+    // The schedule of filter 0's kernel (common/schedule.h) sets the x, tag and stall
+    // cycles every filter shares. cycles is one pass of the stream through M arrays
+    // at once, sequential_cycles M passes through one; results_per_cycle counts every
+    // filter's windows. x_loads are the PE inputs the one x_in net drives and
+    // x_buffer_levels the depth of a fan-out-4 buffer tree that drives them.
+    cout << "design\ttaps\tfilters\tsamples\tcycles\tsequential_cycles\tresults_per_cycle"
+            "\tsequential_results_per_cycle\tthroughput_gain\tx_loads\tx_buffer_levels\twall_seconds"
+            "\tsequential_wall_seconds\twall_speedup\tpassed"
+         << endl;
+    bool all_passed = true;
+    for (size_t d = 0; d < designs.size(); d++) {
+        for (size_t t = 0; t < taps.size(); t++) {
+            std::mt19937 rng(seed);
+            std::uniform_int_distribution<int> value(-range, range);
+            std::vector<int> x(samples);
+            for (size_t i = 0; i < x.size(); i++)
+                x[i] = value(rng);
+
+            int max_filters = *std::max_element(filters.begin(), filters.end());
+            std::vector<std::vector<int> > kernels(max_filters, std::vector<int>(taps[t]));
+            for (int f = 0; f < max_filters; f++)
+                for (int k = 0; k < taps[t]; k++)
+                    kernels[f][k] = value(rng);
+
+            Schedule s;
+            if (!make_schedule(designs[d], kernels[0], x, s)) {
+                cout << "No schedule delivers every window of " << design_name(designs[d]) << "x" << taps[t]
+                     << endl;
+                all_passed = false;
+                continue;
+            }
+
+            for (size_t m = 0; m < filters.size(); m++) {
+                std::vector<std::vector<int> > bank(kernels.begin(), kernels.begin() + filters[m]);
+                MultiResult p = MultiResult(), q = MultiResult();
+                bool ok = run_in_child([&](MultiResult& out) {
+                    ParallelRun run = { s, bank, MultiResult() };
+                    bool dispatched = dispatch(s.design, s.taps(), run);
+                    out = run.result;
+                    return dispatched;
+                }, p);
+                ok = ok && run_sequential(s, bank, q);
+                if (!ok) {
+                    cout << "Failed to run " << design_name(designs[d]) << "x" << taps[t]
+                         << " (unsupported tap count?)" << endl;
+                    all_passed = false;
+                    continue;
+                }
+
+                uint64_t results = uint64_t(filters[m]) * s.expected.size();
+                bool passed = p.mismatches == 0 && q.mismatches == 0 && p.checked == results && q.checked == results;
+                all_passed &= passed;
+                long long loads = (long long)filters[m] * x_in_loads(designs[d], taps[t]);
+                double per_cycle = double(results) / p.cycles, sequential_per_cycle = double(results) / q.cycles;
+                cout << design_name(designs[d]) << "\t" << taps[t] << "\t" << filters[m] << "\t" << x.size() << "\t"
+                     << p.cycles << "\t" << q.cycles << "\t" << per_cycle << "\t" << sequential_per_cycle << "\t"
+                     << per_cycle / sequential_per_cycle << "\t" << loads << "\t" << fanout_levels(loads) << "\t"
+                     << p.seconds << "\t" << q.seconds << "\t" << (p.seconds > 0 ? q.seconds / p.seconds : 0) << "\t"
+                     << (passed ? "true" : "false") << endl;
+                if (p.mismatches || q.mismatches)
+                    cout << p.mismatches << " parallel and " << q.mismatches << " sequential results differ" << endl;
+            }
+        }
+    }
+    cout << (all_passed ? "PASS" : "FAIL") << endl;
+    return all_passed ? 0 : 1;
+}
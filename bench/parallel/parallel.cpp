@@ -0,0 +1,277 @@
+#include <systemc.h>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sys/mman.h>
+#include <vector>
+#include "../../common/child_process.h"
+#include "../../common/dispatch.h"
+#include "../../common/stream_run.h"
+
+// One piece of an overlap-save split: the array streams samples in_first..in_last-1
+// and its results for first..last-1 go into the combined stream. The samples before
+// `first` refill the N-1 samples of history the first window needs; R1 and R2 also
+// start on a w1 tag, so their chunks start on a multiple of N, and run N samples past
+// `last` for the tags that flush the last results.
+struct Chunk {
+    uint64_t first, last;
+    uint64_t in_first, in_last;
+};
+
+static std::vector<Chunk> plan_chunks(Design d, int n, uint64_t samples, size_t chunks) {
+    bool streamed = d == Design::R1 || d == Design::R2;
+    uint64_t length = (samples + chunks - 1) / chunks;
+    std::vector<Chunk> plan;
+    for (uint64_t first = 0; first < samples; first += length) {
+        Chunk c;
+        c.first = first;
+        c.last = std::min(samples, first + length);
+        c.in_first = first >= uint64_t(n - 1) ? first - (n - 1) : 0;
+        if (streamed)
+            c.in_first -= c.in_first % n;
+        c.in_last = std::min(samples, c.last + (streamed ? n : 0));
+        plan.push_back(c);
+    }
+    return plan;
+}
+
+// Writes y_out into y[i - first] on the cycle the result of sample i is due, for
+// first <= i < last, and feeds the golden checker like StreamMonitor
+SC_MODULE(CaptureMonitor) {
+    sc_in<bool> clk;
+    sc_in<int> x_in, w_in, y_out;
+
+    const StimulusSource& source;
+    GoldenChecker& checker;
+    Design design;
+    int n;
+    uint64_t first, last;
+    int* y;
+    uint64_t stop_after;
+    uint64_t next;          // Next sample whose result is captured
+    uint64_t edges;
+
+    SC_HAS_PROCESS(CaptureMonitor);
+    CaptureMonitor(sc_module_name name, const StimulusSource& source, GoldenChecker& checker, Design design, int n,
+                   uint64_t first, uint64_t last, int* y, uint64_t stop_after)
+        : sc_module(name), source(source), checker(checker), design(design), n(n), first(first), last(last), y(y),
+          stop_after(stop_after), next(first), edges(0) {
+        SC_METHOD(monitor);
+        sensitive << clk.pos();
+        dont_initialize();
+    }
+
+    uint64_t due(uint64_t i) const { return source.sample_cycle(i) + output_latency(design, n, i); }
+
+    void monitor() {
+        if (edges > 0) {
+            uint64_t cycle = edges - 1;
+            for (; next < last && due(next) <= cycle; next++)
+                if (due(next) == cycle)
+                    y[next - first] = y_out.read();
+            checker.output(cycle, y_out.read());
+        }
+        if (source.carries_sample(edges))
+            checker.sample(edges, x_in.read(), w_in.read());
+        if (++edges == stop_after)
+            sc_stop();
+    }
+};
+
+// Per-chunk figures, written by the worker into shared memory
+struct ChunkResult {
+    uint64_t cycles;
+    uint64_t errors;        // Golden-model mismatches and missing results within the chunk
+    uint64_t captured;      // Results written to the combined stream
+    double seconds;         // Host wall time inside sc_start()
+};
+
+// Streams one chunk through a fresh array and captures its share of the results
+struct ChunkRun {
+    const StimulusRecord* samples;
+    const Chunk& chunk;
+    int* y;                 // Combined stream, shared with the parent
+    ChunkResult& result;
+
+    template <Design D, int N>
+    void run() {
+        uint64_t count = chunk.in_last - chunk.in_first;
+        GoldenChecker checker = GoldenChecker::for_design(D, N, count);
+        checker.set_report_limit(0);
+        sc_clock clk("clk", 10, SC_NS, 0.5, 5, SC_NS, true);
+        InputSignals in;
+        OutputSignals out;
+        SystolicArray<D, N> array("array");
+        StimulusSource source("source", samples + chunk.in_first, count, cycles_per_sample(D), 1, 0,
+                              weight_offset(D, N));
+        CaptureMonitor monitor("monitor", source, checker, D, N, chunk.first - chunk.in_first,
+                               chunk.last - chunk.in_first, y + chunk.first, source.total_cycles() + 2 * N + 8);
+
+        bind(array, clk, in, out);
+        source.clk(clk);
+        source.rst(in.rst);
+        source.x_in(in.x_in);
+        source.y_in(in.y_in);
+        source.w_in(in.w_in);
+        source.tag_in(in.tag_in);
+        monitor.clk(clk);
+        monitor.x_in(in.x_in);
+        monitor.w_in(in.w_in);
+        monitor.y_out(out.y_out);
+
+        auto start = std::chrono::steady_clock::now();
+        sc_start();
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        result.cycles = monitor.edges;
+        result.errors = checker.mismatch_count() + checker.missing_count();
+        result.captured = monitor.next - monitor.first;
+    }
+};
+
+// Anonymous memory the forked workers write into and the parent reads
+template <class T>
+static T* shared_array(size_t count) {
+    void* p = mmap(0, count * sizeof(T) + 1, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    return p == MAP_FAILED ? 0 : static_cast<T*>(p);
+}
+
+template <class T>
+static void free_shared(T* p, size_t count) {
+    if (p)
+        munmap(p, count * sizeof(T) + 1);
+}
+
+// What one split of the stream took
+struct SplitResult {
+    double seconds;         // Wall time from the first fork to the last worker exiting
+    uint64_t cycles;        // Simulated cycles over all chunks
+    uint64_t errors;
+    bool ok;
+};
+
+// Runs the chunks of `plan` on up to `workers` processes, results into y
+static SplitResult run_split(Design d, int taps, const std::vector<StimulusRecord>& samples,
+                             const std::vector<Chunk>& plan, int workers, int* y) {
+    SplitResult split = { 0, 0, 0, false };
+    ChunkResult* results = shared_array<ChunkResult>(plan.size());
+    if (!results)
+        return split;
+    std::memset(results, 0, plan.size() * sizeof(ChunkResult));
+
+    auto start = std::chrono::steady_clock::now();
+    split.ok = run_in_children(plan.size(), workers, [&](size_t c) {
+        ChunkRun run = { samples.data(), plan[c], y, results[c] };
+        return dispatch(d, taps, run);
+    });
+    split.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    for (size_t c = 0; c < plan.size(); c++) {
+        split.cycles += results[c].cycles;
+        split.errors += results[c].errors;
+        split.ok = split.ok && results[c].captured == plan[c].last - plan[c].first;
+    }
+    free_shared(results, plan.size());
+    return split;
+}
+
+static int usage() {
+    cout << "Usage: parallel [--designs B1,B2,...] [--taps 3,9,...] [--workers 1,2,4,...] [--chunks-per-worker K]"
+         << endl
+         << "                [--length samples] [--seed S]" << endl
+         << "       workers default to 1, 2, 4, ... up to the cores of the host" << endl;
+    return 1;
+}
+
+// Comma-separated integers
+static std::vector<int> int_list(char* list) {
+    std::vector<int> values;
+    for (char* t = std::strtok(list, ","); t; t = std::strtok(0, ","))
+        values.push_back(std::atoi(t));
+    return values;
+}
+
+int sc_main(int argc, char* argv[]) {
+    std::vector<Design> designs = { Design::B2, Design::R2, Design::W2 };
+    std::vector<int> taps = { 9, 16 };
+    std::vector<int> workers;
+    int chunks_per_worker = 1;
+    uint64_t length = 1000000;
+    unsigned seed = 1;
+    for (long cores = sysconf(_SC_NPROCESSORS_ONLN), w = 1; w <= cores; w *= 2)
+        workers.push_back(int(w));
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 == argc)
+            return usage();
+        if (std::strcmp(argv[i], "--designs") == 0) {
+            designs.clear();
+            for (char* t = std::strtok(argv[++i], ","); t; t = std::strtok(0, ",")) {
+                Design d;
+                if (!parse_design(t, d)) {
+                    cout << "Unknown design " << t << endl;
+                    return 1;
+                }
+                designs.push_back(d);
+            }
+        } else if (std::strcmp(argv[i], "--taps") == 0) {
+            taps = int_list(argv[++i]);
+        } else if (std::strcmp(argv[i], "--workers") == 0) {
+            workers = int_list(argv[++i]);
+        } else if (std::strcmp(argv[i], "--chunks-per-worker") == 0) {
+            chunks_per_worker = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--length") == 0) {
+            length = std::strtoull(argv[++i], 0, 10);
+        } else if (std::strcmp(argv[i], "--seed") == 0) {
+            seed = std::strtoul(argv[++i], 0, 10);
+        } else {
+            return usage();
+        }
+    }
+    if (chunks_per_worker < 1 || length == 0)
+        return usage();
+
+    // The one-chunk run on one worker is the single-instance reference; every split must
+    // reproduce its result stream exactly
+    cout << "design\ttaps\tworkers\tchunks\tsamples\tcycles\twall_seconds\tsamples_per_second\tspeedup"
+            "\tmatches_single\tpassed" << endl;
+    bool all_passed = true;
+    for (size_t d = 0; d < designs.size(); d++) {
+        for (size_t t = 0; t < taps.size(); t++) {
+            std::vector<StimulusRecord> samples = random_samples(length, seed, taps[t]);
+            int* single = shared_array<int>(length);
+            int* combined = shared_array<int>(length);
+            if (!single || !combined) {
+                cout << "Cannot map " << length << " results" << endl;
+                return 1;
+            }
+
+            std::vector<Chunk> whole = plan_chunks(designs[d], taps[t], length, 1);
+            SplitResult reference = run_split(designs[d], taps[t], samples, whole, 1, single);
+            if (!reference.ok) {
+                cout << "Failed to run " << design_name(designs[d]) << "x" << taps[t]
+                     << " (unsupported tap count?)" << endl;
+                all_passed = false;
+            }
+            for (size_t w = 0; reference.ok && w < workers.size(); w++) {
+                int count = workers[w] < 1 ? 1 : workers[w];
+                std::vector<Chunk> plan = plan_chunks(designs[d], taps[t], length, size_t(count) * chunks_per_worker);
+                std::memset(combined, 0, length * sizeof(int));
+                SplitResult split = run_split(designs[d], taps[t], samples, plan, count, combined);
+                bool matches = std::memcmp(single, combined, length * sizeof(int)) == 0;
+                bool passed = split.ok && matches && split.errors == 0 && reference.errors == 0;
+                all_passed &= passed;
+                cout << design_name(designs[d]) << "\t" << taps[t] << "\t" << count << "\t" << plan.size() << "\t"
+                     << length << "\t" << split.cycles << "\t" << split.seconds << "\t"
+                     << (split.seconds > 0 ? length / split.seconds : 0) << "\t"
+                     << (split.seconds > 0 ? reference.seconds / split.seconds : 0) << "\t"
+                     << (matches ? "true" : "false") << "\t" << (passed ? "true" : "false") << endl;
+            }
+            free_shared(single, length);
+            free_shared(combined, length);
+        }
+    }
+    cout << (all_passed ? "PASS" : "FAIL") << endl;
+    return all_passed ? 0 : 1;
+}
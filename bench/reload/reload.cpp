@@ -0,0 +1,307 @@
+#include <systemc.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "../../common/child_process.h"
+#include "../../common/dispatch.h"
+#include "../../common/stream_run.h"
+
+// Kernels the stream alternates between, weights uniform in [-range, range]
+static std::vector<std::vector<int> > random_kernels(int filters, int taps, unsigned seed, int range) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> value(-range, range);
+    std::vector<std::vector<int> > kernels(filters, std::vector<int>(taps));
+    for (int f = 0; f < filters; f++)
+        for (int k = 0; k < taps; k++)
+            kernels[f][k] = value(rng);
+    return kernels;
+}
+
+// A kernel asked for at the first sample of a segment
+struct Request {
+    uint64_t cycle;
+    size_t kernel;
+};
+
+// Streams one sample per cycle after a reset cycle, and at the first sample of each
+// segment requests the next kernel through w_load, one weight per cycle while the
+// array is ready. Tells the checker where the new kernel takes over and records how
+// long each switch took.
+SC_MODULE(ReloadSource) {
+    sc_in<bool> clk;
+    sc_in<bool> w_load_ready;
+    sc_out<bool> rst;
+    sc_out<int> x_in;
+    sc_out<bool> w_load;
+    sc_out<int> w_in;
+
+    const StimulusRecord* records;
+    uint64_t count;
+    uint64_t segment;                       // Samples per kernel
+    const std::vector<std::vector<int> >& kernels;
+    GoldenChecker& checker;
+    int n;
+    uint64_t cycle;                         // Input cycles driven so far
+    uint64_t next;                          // Next sample to send
+    std::deque<int> to_load;                // Weights of the requested kernels not yet loaded
+    std::deque<Request> requests;           // Requests not yet loaded
+    size_t kernel;                          // Kernel of the current segment
+    std::vector<uint64_t> latencies;        // Request to first output with the new kernel, in cycles
+
+    SC_HAS_PROCESS(ReloadSource);
+    ReloadSource(sc_module_name name, const StimulusRecord* records, uint64_t count, uint64_t segment,
+                 const std::vector<std::vector<int> >& kernels, GoldenChecker& checker)
+        : sc_module(name), records(records), count(count), segment(segment), kernels(kernels), checker(checker),
+          n(int(kernels[0].size())), cycle(0), next(0), kernel(0) {
+        SC_METHOD(drive);
+        sensitive << clk.neg();
+    }
+
+    bool carries_sample(uint64_t c) const { return c >= 1 && c < total_cycles(); }
+    uint64_t total_cycles() const { return 1 + count; }
+
+    void drive() {
+        bool sample = carries_sample(cycle);
+        if (sample && next > 0 && next % segment == 0) {
+            kernel = (kernel + 1) % kernels.size();
+            to_load.insert(to_load.end(), kernels[kernel].begin(), kernels[kernel].end());
+            Request r = { cycle, kernel };
+            requests.push_back(r);
+        }
+
+        bool load = !to_load.empty() && w_load_ready.read() && cycle >= 1;
+        rst.write(cycle < 1);
+        x_in.write(sample ? records[next++].x : 0);
+        w_load.write(load);
+        w_in.write(load ? to_load.front() : 0);
+        if (load) {
+            to_load.pop_front();
+            // Last weight taken at this cycle's edge: the loader swaps at the next cycle
+            // that brings the tag to PE1, every N cycles from cycle 1, reset holds the ring
+            if (to_load.size() % n == 0) {
+                uint64_t swap = 1 + (cycle + n - 1) / n * n;
+                checker.switch_kernel(swap - 1, kernels[requests.front().kernel]);
+                // The window starting at the swap ends at swap + N - 1 and shows on y_out one edge later
+                latencies.push_back(swap + n - requests.front().cycle);
+                requests.pop_front();
+            }
+        }
+        cycle++;
+    }
+};
+
+// Checks y_out against the golden model at every rising edge
+SC_MODULE(ReloadMonitor) {
+    sc_in<bool> clk;
+    sc_in<int> x_in, y_out;
+
+    const ReloadSource& source;
+    GoldenChecker& checker;
+    uint64_t stop_after;
+    uint64_t edges;
+
+    SC_HAS_PROCESS(ReloadMonitor);
+    ReloadMonitor(sc_module_name name, const ReloadSource& source, GoldenChecker& checker, uint64_t stop_after)
+        : sc_module(name), source(source), checker(checker), stop_after(stop_after), edges(0) {
+        SC_METHOD(monitor);
+        sensitive << clk.pos();
+        dont_initialize();
+    }
+
+    void monitor() {
+        if (edges > 0)
+            checker.output(edges - 1, y_out.read());
+        if (source.carries_sample(edges))
+            checker.sample(edges, x_in.read());
+        if (++edges == stop_after)
+            sc_stop();
+    }
+};
+
+// Measured in the child, trivially copyable so it can come back through a pipe
+struct ReloadResult {
+    uint64_t cycles;
+    uint64_t results;
+    uint64_t errors;        // Mismatches plus results never produced
+    uint64_t switches;
+    uint64_t latency_min, latency_max;
+    double latency_mean;
+    double seconds;         // Host wall time, for the re-elaborated runs including elaboration
+};
+
+// One B2 array taking every kernel through w_load
+struct ReloadRun {
+    const std::vector<StimulusRecord>& samples;
+    uint64_t segment;
+    const std::vector<std::vector<int> >& kernels;
+    ReloadResult result;
+
+    template <Design D, int N>
+    void run() {
+        sc_clock clk("clk", 10, SC_NS, 0.5, 5, SC_NS, true);
+        InputSignals in;
+        OutputSignals out;
+        SystolicArray<Design::B2, N> array("array");
+        array.set_weights(kernels[0]);
+        GoldenChecker checker(Design::B2, kernels[0], samples.size(), 0, 0);
+        checker.set_report_limit(0);
+        ReloadSource source("source", samples.data(), samples.size(), segment, kernels, checker);
+        ReloadMonitor monitor("monitor", source, checker, source.total_cycles() + 2 * N + 8);
+
+        bind(array, clk, in, out);
+        source.clk(clk);
+        source.w_load_ready(out.w_load_ready);
+        source.rst(in.rst);
+        source.x_in(in.x_in);
+        source.w_load(in.w_load);
+        source.w_in(in.w_in);
+        monitor.clk(clk);
+        monitor.x_in(in.x_in);
+        monitor.y_out(out.y_out);
+
+        auto start = std::chrono::steady_clock::now();
+        sc_start();
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        result.cycles = monitor.edges;
+        result.results = checker.results_checked();
+        result.errors = checker.mismatch_count() + checker.missing_count();
+        result.switches = source.latencies.size();
+        result.latency_min = result.latency_max = 0;
+        double sum = 0;
+        for (size_t i = 0; i < source.latencies.size(); i++) {
+            uint64_t l = source.latencies[i];
+            result.latency_min = i == 0 || l < result.latency_min ? l : result.latency_min;
+            result.latency_max = l > result.latency_max ? l : result.latency_max;
+            sum += l;
+        }
+        result.latency_mean = source.latencies.empty() ? 0 : sum / source.latencies.size();
+    }
+};
+
+// One segment in a freshly elaborated B2 array with its kernel set at elaboration,
+// the way kernels were switched before w_load
+struct SegmentRun {
+    const StimulusRecord* samples;
+    uint64_t count;
+    const std::vector<int>& kernel;
+    ReloadResult result;
+
+    template <Design D, int N>
+    void run() {
+        auto start = std::chrono::steady_clock::now();
+        sc_clock clk("clk", 10, SC_NS, 0.5, 5, SC_NS, true);
+        InputSignals in;
+        OutputSignals out;
+        SystolicArray<Design::B2, N> array("array");
+        array.set_weights(kernel);
+        GoldenChecker checker(Design::B2, kernel, count, 0, 0);
+        checker.set_report_limit(0);
+        StimulusSource source("source", samples, count, 1);
+        StreamMonitor monitor("monitor", source, checker, source.total_cycles() + 2 * N + 8, false);
+
+        bind(array, clk, in, out);
+        source.clk(clk);
+        source.rst(in.rst);
+        source.x_in(in.x_in);
+        source.y_in(in.y_in);
+        source.w_in(in.w_in);
+        source.tag_in(in.tag_in);
+        monitor.clk(clk);
+        monitor.x_in(in.x_in);
+        monitor.w_in(in.w_in);
+        monitor.y_out(out.y_out);
+        sc_start();
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        result.cycles = monitor.edges;
+        result.results = checker.results_checked();
+        result.errors = checker.mismatch_count() + checker.missing_count();
+    }
+};
+
+static int usage() {
+    cout << "Usage: reload [--taps 3,9,...] [--filters K] [--segment samples] [--length samples] [--seed S]" << endl;
+    return 1;
+}
+
+int sc_main(int argc, char* argv[]) {
+    std::vector<int> taps = { 3, 9, 25 };
+    int filters = 16;
+    uint64_t segment = 1000;
+    uint64_t length = 64000;
+    unsigned seed = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 == argc)
+            return usage();
+        if (std::strcmp(argv[i], "--taps") == 0) {
+            taps.clear();
+            for (char* t = std::strtok(argv[++i], ","); t; t = std::strtok(0, ","))
+                taps.push_back(std::atoi(t));
+        } else if (std::strcmp(argv[i], "--filters") == 0) {
+            filters = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--segment") == 0) {
+            segment = std::strtoull(argv[++i], 0, 10);
+        } else if (std::strcmp(argv[i], "--length") == 0) {
+            length = std::strtoull(argv[++i], 0, 10);
+        } else if (std::strcmp(argv[i], "--seed") == 0) {
+            seed = std::strtoul(argv[++i], 0, 10);
+        } else {
+            return usage();
+        }
+    }
+    if (filters < 1 || segment < 1)
+        return usage();
+
+    cout << "taps\tmode\tsegments\tcycles\tresults\tswitch_latency_min\tswitch_latency_mean\tswitch_latency_max"
+            "\twall_seconds\tpassed" << endl;
+    bool all_passed = true;
+    for (size_t t = 0; t < taps.size(); t++) {
+        std::vector<StimulusRecord> samples = random_samples(length, seed, taps[t]);
+        std::vector<std::vector<int> > kernels = random_kernels(filters, taps[t], seed + 1, 8);
+        uint64_t segments = (length + segment - 1) / segment;
+
+        // One run, kernels switched through w_load
+        ReloadResult r = ReloadResult();
+        bool ok = run_in_child([&](ReloadResult& out) {
+            ReloadRun run = { samples, segment, kernels, ReloadResult() };
+            bool dispatched = dispatch_taps<Design::B2>(taps[t], run);
+            out = run.result;
+            return dispatched;
+        }, r);
+        bool passed = ok && r.errors == 0 && r.switches == segments - 1;
+        all_passed &= passed;
+        cout << taps[t] << "\treload\t" << segments << "\t" << r.cycles << "\t" << r.results << "\t" << r.latency_min
+             << "\t" << r.latency_mean << "\t" << r.latency_max << "\t" << r.seconds << "\t"
+             << (passed ? "true" : "false") << endl;
+
+        // One elaboration per segment; windows across segment boundaries are lost
+        ReloadResult total = ReloadResult();
+        bool split_passed = true;
+        for (uint64_t s = 0; s < segments; s++) {
+            ReloadResult part = ReloadResult();
+            uint64_t first = s * segment;
+            uint64_t count = std::min<uint64_t>(segment, length - first);
+            bool part_ok = run_in_child([&](ReloadResult& out) {
+                SegmentRun run = { samples.data() + first, count, kernels[s % kernels.size()], ReloadResult() };
+                bool dispatched = dispatch_taps<Design::B2>(taps[t], run);
+                out = run.result;
+                return dispatched;
+            }, part);
+            split_passed &= part_ok && part.errors == 0;
+            total.cycles += part.cycles;
+            total.results += part.results;
+            total.seconds += part.seconds;
+        }
+        all_passed &= split_passed;
+        cout << taps[t] << "\trestart\t" << segments << "\t" << total.cycles << "\t" << total.results << "\t-\t-\t-\t"
+             << total.seconds << "\t" << (split_passed ? "true" : "false") << endl;
+    }
+    cout << (all_passed ? "PASS" : "FAIL") << endl;
+    return all_passed ? 0 : 1;
+}
@@ -0,0 +1,312 @@
+// Multiplies come from the PE activity counters
+#define PE_COUNTERS
+
+#include <systemc.h>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "../../common/child_process.h"
+#include "../../common/conv_modes.h"
+#include "../../common/dispatch.h"
+#include "../../common/energy.h"
+#include "../../common/harness.h"
+#include "../../common/stimulus_file.h"
+
+// Measured in the child, trivially copyable so it can come back through a pipe
+struct ModeResult {
+    uint64_t cycles;        // Reset to the edge that shows the last wanted window
+    uint64_t checked;
+    uint64_t errors;        // Wanted windows that differ, dropped ones that are not 0
+    uint64_t multiplies;    // PE cycles that multiplied, from the activity counters
+    int latency;            // Cycles from a window's newest sample to y_out, -1 if none fits
+    double seconds;
+};
+
+// B1 and F gate the output by stride, W1 and W2 stretch the x delay line by dilation
+template <class Array>
+static bool set_mode(Array&, const ConvMode&) { return false; }
+
+template <int N, class T>
+static bool set_mode(SystolicArray<Design::B1, N, T>& a, const ConvMode& m) { a.set_stride(m.stride); return true; }
+
+template <int N, class T>
+static bool set_mode(SystolicArray<Design::F, N, T>& a, const ConvMode& m) { a.set_stride(m.stride); return true; }
+
+template <int N, class T>
+static bool set_mode(SystolicArray<Design::W1, N, T>& a, const ConvMode& m) { a.set_dilation(m.dilation); return true; }
+
+template <int N, class T>
+static bool set_mode(SystolicArray<Design::W2, N, T>& a, const ConvMode& m) { a.set_dilation(m.dilation); return true; }
+
+// Inputs: reset, then sample j on cycle 1 + j * spacing, then `tail` idle cycles
+static std::vector<CycleIn> stream_cycles(const std::vector<int>& x, int spacing, uint64_t tail) {
+    CycleIn idle = { false, 0, 0, 0, false };
+    std::vector<CycleIn> in(1 + (x.size() - 1) * spacing + 1 + tail, idle);
+    in[0].rst = true;
+    for (size_t j = 0; j < x.size(); j++)
+        in[1 + j * spacing].x = x[j];
+    return in;
+}
+
+// Smallest latency at which y (after every cycle) holds each wanted window, and the
+// dropped full windows show 0 if `dropped_zero`; -1 if there is none below `limit`
+static int find_latency(const std::vector<int>& y, const std::vector<int>& expected, int span, int spacing,
+                        const ConvMode& mode, bool dropped_zero, int limit) {
+    for (int latency = 0; latency < limit; latency++) {
+        bool fits = true;
+        size_t m = 0;
+        for (uint64_t i = uint64_t(span - 1); fits && m < expected.size(); i++) {
+            uint64_t c = 1 + i * spacing + latency;
+            if (c >= y.size())
+                fits = false;
+            else if (kept_window(i, span, mode.stride))
+                fits = y[c] == expected[m++];
+            else if (dropped_zero)
+                fits = y[c] == 0;
+        }
+        if (fits)
+            return latency;
+    }
+    return -1;
+}
+
+// Cycles from reset to the edge that shows window `last` at `latency`
+static uint64_t job_length(uint64_t last, int spacing, int latency) {
+    return 1 + last * spacing + latency + 1;
+}
+
+// One stream through SystolicArray<D, N> in the given mode, checked against the
+// strided/dilated reference
+struct ModeRun {
+    const std::vector<int>& kernel;
+    const std::vector<int>& x;
+    ConvMode mode;
+    ModeResult result;
+
+    template <Design D, int N>
+    void run() {
+        int span = dilated_span(N, mode.dilation), spacing = cycles_per_sample(D);
+        int limit = 4 * (span + 2) * spacing + 8;
+        InputSignals in;
+        OutputSignals out;
+        SystolicArray<D, N> array("array");
+        bind(array, in, out);
+        load_kernel(array, kernel);
+        if (!set_mode(array, mode)) {
+            result.latency = -1;
+            return;
+        }
+
+        std::vector<CycleIn> cycles = stream_cycles(x, spacing, limit);
+        std::vector<int> y(cycles.size());
+        EnergyCounts before = EnergyCounts();   // Counted before the first edge after reset
+        auto start = std::chrono::steady_clock::now();
+        for (size_t c = 0; c < cycles.size(); c++) {
+            if (c == 1)
+                before = energy_counts(array.pe);
+            in.cycle(cycles[c]);
+            y[c] = out.read().y;
+        }
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::vector<int> expected = convolve_mode(kernel, x, mode);
+        result.latency = find_latency(y, expected, span, spacing, mode, mode.stride > 1, limit);
+        result.checked = expected.size();
+        if (result.latency < 0) {
+            result.errors = expected.size();
+            return;
+        }
+        uint64_t last = span - 1 + (expected.size() - 1) * uint64_t(mode.stride);
+        result.cycles = job_length(last, spacing, result.latency);
+
+        // The counters ran on past the job while looking for the latency, so take
+        // the multiplies of its edges from the gates, and check them once against
+        // the counters over the whole run
+        EnergyCounts counts = energy_counts(array.pe);
+        uint64_t edges = cycles.size() - 1, job_edges = result.cycles - 1;
+        uint64_t counted = (counts.cycles - counts.gated_macs) - (before.cycles - before.gated_macs);
+        uint64_t gated = 0, job = 0;
+        for (int i = 0; i < N; i++) {
+            int first = D == Design::B1 ? i : N - 1;
+            gated += mode.stride > 1 ? kept_edges(edges, mode.stride, first) : edges;
+            job += mode.stride > 1 ? kept_edges(job_edges, mode.stride, first) : job_edges;
+        }
+        if (counts.counted && counted != gated)
+            result.errors++;
+        result.multiplies = job;
+    }
+};
+
+// Every window of x at stride 1 through the fast model of the plain array with the
+// zero-padded kernel: what computing a strided or dilated layer without the modes
+// costs, then decimating. Same result fields as ModeRun.
+template <Design D>
+static ModeResult reference_run(const std::vector<int>& kernel, const std::vector<int>& x, const ConvMode& mode) {
+    ModeResult r = ModeResult();
+    std::vector<int> padded = dilate_kernel(kernel, mode.dilation);
+    int span = int(padded.size()), spacing = cycles_per_sample(D);
+    int limit = 4 * (span + 2) * spacing + 8;
+    FastModel<D> model(span, padded);
+    std::vector<CycleIn> cycles = stream_cycles(x, spacing, limit);
+    std::vector<int> y(cycles.size());
+    auto start = std::chrono::steady_clock::now();
+    for (size_t c = 0; c < cycles.size(); c++)
+        y[c] = model.step(cycles[c]).y;
+    r.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    ConvMode plain = { 1, 1 };
+    std::vector<int> every = convolve_mode(padded, x, plain), expected = convolve_mode(kernel, x, mode);
+    r.latency = find_latency(y, every, span, spacing, plain, false, limit);
+    r.checked = expected.size();
+    if (r.latency < 0) {
+        r.errors = expected.size();
+        return r;
+    }
+    // The last wanted window, though the plain array computes every one up to it
+    uint64_t last = span - 1 + (expected.size() - 1) * uint64_t(mode.stride);
+    r.cycles = job_length(last, spacing, r.latency);
+    r.multiplies = uint64_t(span) * (r.cycles - 1);
+    return r;
+}
+
+static ModeResult reference_run(Design d, const std::vector<int>& kernel, const std::vector<int>& x,
+                                const ConvMode& mode) {
+    switch (d) {
+    case Design::B1: return reference_run<Design::B1>(kernel, x, mode);
+    case Design::F:  return reference_run<Design::F>(kernel, x, mode);
+    case Design::W1: return reference_run<Design::W1>(kernel, x, mode);
+    case Design::W2: return reference_run<Design::W2>(kernel, x, mode);
+    default:         return ModeResult();
+    }
+}
+
+static int usage() {
+    cout << "Usage: strided [--designs B1,F,W1,W2] [--taps 3,9,...] [--strides 1,2,4] [--dilations 1,2,4]" << endl
+         << "               [--samples L] [--range R] [--seed S]" << endl
+         << "       strides apply to B1 and F, dilations to W1 and W2" << endl;
+    return 1;
+}
+
+// Comma-separated integers
+static std::vector<int> int_list(char* list) {
+    std::vector<int> values;
+    for (char* t = std::strtok(list, ","); t; t = std::strtok(0, ","))
+        values.push_back(std::atoi(t));
+    return values;
+}
+
+int sc_main(int argc, char* argv[]) {
+    std::vector<Design> designs = { Design::B1, Design::F, Design::W1, Design::W2 };
+    std::vector<int> taps = { 3, 9 };
+    std::vector<int> strides = { 1, 2, 4 };
+    std::vector<int> dilations = { 1, 2, 4 };
+    uint64_t samples = 1000;
+    int range = 8;
+    unsigned seed = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 == argc)
+            return usage();
+        if (std::strcmp(argv[i], "--designs") == 0) {
+            designs.clear();
+            for (char* t = std::strtok(argv[++i], ","); t; t = std::strtok(0, ",")) {
+                Design d;
+                if (!parse_design(t, d) || (d != Design::B1 && d != Design::F && d != Design::W1 && d != Design::W2)) {
+                    cout << "No stride or dilation mode for design " << t << endl;
+                    return 1;
+                }
+                designs.push_back(d);
+            }
+        } else if (std::strcmp(argv[i], "--taps") == 0) {
+            taps = int_list(argv[++i]);
+        } else if (std::strcmp(argv[i], "--strides") == 0) {
+            strides = int_list(argv[++i]);
+        } else if (std::strcmp(argv[i], "--dilations") == 0) {
+            dilations = int_list(argv[++i]);
+        } else if (std::strcmp(argv[i], "--samples") == 0) {
+            samples = std::strtoull(argv[++i], 0, 10);
+        } else if (std::strcmp(argv[i], "--range") == 0) {
+            range = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--seed") == 0) {
+            seed = std::strtoul(argv[++i], 0, 10);
+        } else {
+            return usage();
+        }
+    }
+    if (samples == 0 || range < 0)
+        return usage();
+    for (size_t s = 0; s < strides.size(); s++)
+        if (strides[s] < 1)
+            return usage();
+    for (size_t s = 0; s < dilations.size(); s++)
+        if (dilations[s] < 1)
+            return usage();
+
+    // The reference computes every window at stride 1 on the plain array with the
+    // zero-padded kernel, (taps - 1) * dilation + 1 PEs, and keeps the wanted ones.
+    // multiplies counts PE cycles that multiply up to the last wanted window, and
+    // multiply_savings is the share of the reference's the mode no longer does; a
+    // dilated array also needs fewer PEs and a shorter pipeline.
+    cout << "design\ttaps\tstride\tdilation\tsamples\twindows\tpes\treference_pes\tlatency\treference_latency"
+            "\tcycles\treference_cycles\tmultiplies\treference_multiplies\tmultiply_savings\twall_seconds\tpassed"
+         << endl;
+    bool all_passed = true;
+    for (size_t d = 0; d < designs.size(); d++) {
+        bool strided = designs[d] == Design::B1 || designs[d] == Design::F;
+        const std::vector<int>& values = strided ? strides : dilations;
+        for (size_t t = 0; t < taps.size(); t++) {
+            for (size_t v = 0; v < values.size(); v++) {
+                ConvMode mode = { strided ? values[v] : 1, strided ? 1 : values[v] };
+                int span = dilated_span(taps[t], mode.dilation);
+                if (samples < uint64_t(span)) {
+                    cout << "Skipping " << design_name(designs[d]) << "x" << taps[t] << " at dilation "
+                         << mode.dilation << ": fewer samples than a window spans" << endl;
+                    continue;
+                }
+                std::mt19937 rng(seed);
+                std::uniform_int_distribution<int> value(-range, range);
+                std::vector<int> x(samples), kernel(taps[t]);
+                for (size_t i = 0; i < x.size(); i++)
+                    x[i] = value(rng);
+                for (size_t k = 0; k < kernel.size(); k++)
+                    kernel[k] = value(rng);
+
+                ModeResult r = ModeResult();
+                bool ok = run_in_child([&](ModeResult& out) {
+                    ModeRun run = { kernel, x, mode, ModeResult() };
+                    bool dispatched = dispatch(designs[d], taps[t], run);
+                    out = run.result;
+                    return dispatched;
+                }, r);
+                if (!ok) {
+                    cout << "Failed to run " << design_name(designs[d]) << "x" << taps[t]
+                         << " (unsupported tap count?)" << endl;
+                    all_passed = false;
+                    continue;
+                }
+                ModeResult ref = reference_run(designs[d], kernel, x, mode);
+
+                bool passed = r.errors == 0 && r.latency >= 0 && ref.errors == 0 && ref.latency >= 0 &&
+                              r.checked == ref.checked && r.cycles <= ref.cycles;
+                all_passed &= passed;
+                cout << design_name(designs[d]) << "\t" << taps[t] << "\t" << mode.stride << "\t" << mode.dilation
+                     << "\t" << x.size() << "\t" << r.checked << "\t" << taps[t] << "\t" << span << "\t" << r.latency
+                     << "\t" << ref.latency << "\t" << r.cycles << "\t" << ref.cycles << "\t" << r.multiplies << "\t"
+                     << ref.multiplies << "\t"
+                     << (ref.multiplies ? 1 - double(r.multiplies) / ref.multiplies : 0) << "\t" << r.seconds
+                     << "\t" << (passed ? "true" : "false") << endl;
+                if (r.latency < 0)
+                    cout << "No latency puts every wanted window of " << design_name(designs[d]) << "x" << taps[t]
+                         << " on y_out" << endl;
+                else if (r.errors)
+                    cout << r.errors << " errors (multiplies differ from the stride gates' count)" << endl;
+            }
+        }
+    }
+    cout << (all_passed ? "PASS" : "FAIL") << endl;
+    return all_passed ? 0 : 1;
+}
@@ -0,0 +1,208 @@
+#include <systemc.h>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../../common/child_process.h"
+#include "../../common/dispatch.h"
+#include "../../common/stream_run.h"
+
+// One design x taps x length point of the sweep
+struct SweepPoint {
+    Design design;
+    int taps;
+    uint64_t length;    // Input samples
+};
+
+// Measured in the child, trivially copyable so it can come back through a pipe
+struct SweepResult {
+    uint64_t cycles;            // Simulated rising edges, including reset and drain
+    uint64_t results;           // Outputs checked against the golden model
+    uint64_t mismatches;
+    uint64_t missing;           // Expected outputs that never appeared
+    int64_t first_latency;      // Cycles from a sample entering to its output, for the first checked one
+    double seconds;             // Host wall time inside sc_start()
+    bool counted;               // Built with -DPE_COUNTERS, the two counts below are set
+    uint64_t pe_cycles;         // Clocked PE cycles, summed over the PEs
+    uint64_t useful_macs;       // Multiplies with both operands nonzero
+};
+
+// Streams a random signal through the array picked by dispatch()
+struct SweepRun {
+    const SweepPoint& point;
+    unsigned seed;
+    SweepResult result;
+
+    template <Design D, int N>
+    void run() {
+        std::vector<StimulusRecord> samples = random_samples(point.length, seed, N);
+        GoldenChecker checker = GoldenChecker::for_design(D, N, samples.size());
+        checker.set_report_limit(0);
+        // Keep the per-PE tables -DPE_COUNTERS prints at sc_stop() out of the table
+        std::streambuf* out = cout.rdbuf(0);
+        StreamStats stats = run_stream<D, N>(samples.data(), samples.size(), checker);
+        cout.rdbuf(out);
+        cout.clear();
+
+        result.cycles = stats.cycles;
+        result.results = checker.results_checked();
+        result.mismatches = checker.mismatch_count();
+        result.missing = checker.missing_count();
+        result.first_latency = checker.first_output_latency();
+        result.seconds = stats.seconds;
+        result.counted = stats.energy.counted;
+        result.pe_cycles = stats.energy.cycles;
+        result.useful_macs = stats.energy.useful_macs;
+    }
+};
+
+// Derived figures for one point
+struct SweepRow {
+    SweepPoint point;
+    SweepResult r;
+    bool ok;
+
+    double outputs_per_cycle() const { return r.cycles ? double(r.results) / r.cycles : 0; }
+    // Useful MACs per clocked PE cycle from the PE counters. Without -DPE_COUNTERS it
+    // is analytic: every sample meets each of the N weights once, so length * N MACs
+    // out of N * cycles PE cycles, zero operands included.
+    double pe_utilization() const {
+        if (r.counted)
+            return r.pe_cycles ? double(r.useful_macs) / r.pe_cycles : 0;
+        return r.cycles ? double(point.length) / r.cycles : 0;
+    }
+    const char* utilization_source() const { return r.counted ? "counted" : "analytic"; }
+    double cycles_per_second() const { return r.seconds > 0 ? r.cycles / r.seconds : 0; }
+    bool passed() const { return ok && r.mismatches == 0 && r.missing == 0; }
+};
+
+static void write_csv(std::ostream& os, const std::vector<SweepRow>& rows) {
+    os << "design,taps,length,cycles,outputs,outputs_per_cycle,first_output_latency,pe_utilization,"
+          "utilization_source,wall_seconds,cycles_per_second,passed" << endl;
+    for (size_t i = 0; i < rows.size(); i++) {
+        const SweepRow& row = rows[i];
+        os << design_name(row.point.design) << "," << row.point.taps << "," << row.point.length << ","
+           << row.r.cycles << "," << row.r.results << "," << row.outputs_per_cycle() << ","
+           << row.r.first_latency << "," << row.pe_utilization() << "," << row.utilization_source() << ","
+           << row.r.seconds << ","
+           << row.cycles_per_second() << "," << (row.passed() ? "true" : "false") << endl;
+    }
+}
+
+static void write_json(std::ostream& os, const std::vector<SweepRow>& rows) {
+    os << "[" << endl;
+    for (size_t i = 0; i < rows.size(); i++) {
+        const SweepRow& row = rows[i];
+        os << "  {\"design\": \"" << design_name(row.point.design) << "\", \"taps\": " << row.point.taps
+           << ", \"length\": " << row.point.length << ", \"cycles\": " << row.r.cycles
+           << ", \"outputs\": " << row.r.results << ", \"outputs_per_cycle\": " << row.outputs_per_cycle()
+           << ", \"first_output_latency\": " << row.r.first_latency
+           << ", \"pe_utilization\": " << row.pe_utilization() << ", \"utilization_source\": \""
+           << row.utilization_source() << "\", \"wall_seconds\": " << row.r.seconds
+           << ", \"cycles_per_second\": " << row.cycles_per_second()
+           << ", \"passed\": " << (row.passed() ? "true" : "false") << "}" << (i + 1 < rows.size() ? "," : "")
+           << endl;
+    }
+    os << "]" << endl;
+}
+
+// Comma-separated list argument
+static std::vector<std::string> split(const char* list) {
+    std::vector<std::string> items;
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ','))
+        if (!item.empty())
+            items.push_back(item);
+    return items;
+}
+
+static int usage() {
+    cout << "Usage: sweep [--designs B1,B2,...] [--taps 3,9,...] [--lengths 1000,...] [--seed S]" << endl
+         << "             [--format csv|json] [--out file]" << endl
+         << "       pe_utilization is counted when built with -DPE_COUNTERS, else analytic" << endl;
+    return 1;
+}
+
+int sc_main(int argc, char* argv[]) {
+    std::vector<std::string> designs = split("B1,B2,F,R1,R2,W1,W2");
+    std::vector<std::string> taps = split("3,9,25");
+    std::vector<std::string> lengths = split("1000,100000");
+    unsigned seed = 1;
+    std::string format = "csv";
+    const char* out_path = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 == argc)
+            return usage();
+        if (std::strcmp(argv[i], "--designs") == 0)
+            designs = split(argv[++i]);
+        else if (std::strcmp(argv[i], "--taps") == 0)
+            taps = split(argv[++i]);
+        else if (std::strcmp(argv[i], "--lengths") == 0)
+            lengths = split(argv[++i]);
+        else if (std::strcmp(argv[i], "--seed") == 0)
+            seed = std::strtoul(argv[++i], 0, 10);
+        else if (std::strcmp(argv[i], "--format") == 0)
+            format = argv[++i];
+        else if (std::strcmp(argv[i], "--out") == 0)
+            out_path = argv[++i];
+        else
+            return usage();
+    }
+    if (format != "csv" && format != "json")
+        return usage();
+
+    std::vector<SweepPoint> points;
+    for (size_t d = 0; d < designs.size(); d++) {
+        Design design;
+        if (!parse_design(designs[d].c_str(), design)) {
+            cout << "Unknown design " << designs[d] << endl;
+            return 1;
+        }
+        for (size_t t = 0; t < taps.size(); t++) {
+            for (size_t l = 0; l < lengths.size(); l++) {
+                SweepPoint p = { design, std::atoi(taps[t].c_str()), std::strtoull(lengths[l].c_str(), 0, 10) };
+                points.push_back(p);
+            }
+        }
+    }
+
+    // Each point elaborates its own array, so each runs in its own child process
+    std::vector<SweepRow> rows;
+    for (size_t i = 0; i < points.size(); i++) {
+        SweepRow row = { points[i], SweepResult(), false };
+        row.ok = run_in_child([&](SweepResult& r) {
+            SweepRun run = { points[i], seed, SweepResult() };
+            bool ok = dispatch(points[i].design, points[i].taps, run);
+            r = run.result;
+            return ok;
+        }, row.r);
+        if (!row.ok)
+            cout << "Failed to run " << design_name(points[i].design) << "x" << points[i].taps
+                 << " (unsupported tap count?)" << endl;
+        else if (out_path)
+            cout << design_name(points[i].design) << "x" << points[i].taps << ", " << points[i].length
+                 << " samples: " << row.r.cycles << " cycles, " << row.r.seconds << " s" << endl;
+        rows.push_back(row);
+    }
+
+    std::ofstream file;
+    if (out_path) {
+        file.open(out_path);
+        if (!file) {
+            cout << "Cannot write " << out_path << endl;
+            return 1;
+        }
+    }
+    std::ostream& os = out_path ? static_cast<std::ostream&>(file) : cout;
+    if (format == "json")
+        write_json(os, rows);
+    else
+        write_csv(os, rows);
+    return 0;
+}
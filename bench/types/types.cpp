@@ -0,0 +1,174 @@
+// The table counts the additions each accumulator type could not hold
+#define ACC_OVERFLOW
+#define SC_INCLUDE_FX
+#include <systemc.h>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <sys/resource.h>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "../../common/child_process.h"
+#include "../../common/dispatch.h"
+#include "../../common/stream_run.h"
+
+// One type set x design x taps point
+struct TypesPoint {
+    std::string types;
+    Design design;
+    int taps;
+};
+
+// Measured in the child, trivially copyable so it can come back through a pipe
+struct TypesResult {
+    uint64_t cycles;            // Simulated rising edges, including reset and drain
+    uint64_t results;           // Outputs checked against the int golden model
+    uint64_t errors;            // Mismatches plus results never produced
+    uint64_t accumulations;
+    uint64_t overflows;         // Accumulations acc_t could not hold
+    uint64_t pe_bytes;          // sizeof one PE module
+    uint64_t max_rss_kb;        // Peak resident set of the child
+    double seconds;             // Host wall time inside sc_start()
+};
+
+// Streams a random signal through SystolicArray<D, N, T>, picked by dispatch()
+template <class T>
+struct TypesRun {
+    uint64_t length;
+    unsigned seed;
+    int range;
+    TypesResult result;
+
+    template <Design D, int N>
+    void run() {
+        typedef typename std::remove_reference<decltype(std::declval<SystolicArray<D, N, T>&>().pe[0])>::type PE;
+        std::vector<StimulusRecord> samples = random_samples(length, seed, N, range);
+        GoldenChecker checker = GoldenChecker::for_design(D, N, samples.size());
+        checker.set_report_limit(0);
+        StreamStats stats = run_stream<D, N, T>(samples.data(), samples.size(), checker);
+
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        result.cycles = stats.cycles;
+        result.results = checker.results_checked();
+        result.errors = checker.mismatch_count() + checker.missing_count();
+        result.accumulations = stats.accumulators.accumulations();
+        result.overflows = stats.accumulators.overflows();
+        result.pe_bytes = sizeof(PE);
+        result.max_rss_kb = usage.ru_maxrss;
+        result.seconds = stats.seconds;
+    }
+};
+
+template <class T>
+static bool run_point(const TypesPoint& p, uint64_t length, unsigned seed, int range, TypesResult& r) {
+    TypesRun<T> run = { length, seed, range, TypesResult() };
+    bool ok = dispatch(p.design, p.taps, run);
+    r = run.result;
+    return ok;
+}
+
+// Type sets by name, see common/pe_types.h
+static bool run_types(const TypesPoint& p, uint64_t length, unsigned seed, int range, TypesResult& r) {
+    if (p.types == "int")
+        return run_point<IntTypes>(p, length, seed, range, r);
+    if (p.types == "int16")
+        return run_point<Int16Types>(p, length, seed, range, r);
+    if (p.types == "int8")
+        return run_point<Int8Types>(p, length, seed, range, r);
+    if (p.types == "int8_acc16")
+        return run_point<Int8Acc16Types>(p, length, seed, range, r);
+    if (p.types == "sc_int8")
+        return run_point<ScInt8Types>(p, length, seed, range, r);
+    if (p.types == "sc_fixed")
+        return run_point<FixedTypes>(p, length, seed, range, r);
+    return false;
+}
+
+// Comma-separated list argument
+static std::vector<std::string> split(const char* list) {
+    std::vector<std::string> items;
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ','))
+        if (!item.empty())
+            items.push_back(item);
+    return items;
+}
+
+static int usage() {
+    cout << "Usage: types [--types int,int16,int8,int8_acc16,sc_int8,sc_fixed] [--designs B1,B2,...]" << endl
+         << "             [--taps 3,9,...] [--length L] [--range R] [--seed S]" << endl
+         << "       e.g. --types int8_acc16 --taps 64 --range 127 overflows the 16-bit accumulator" << endl;
+    return 1;
+}
+
+int sc_main(int argc, char* argv[]) {
+    std::vector<std::string> types = split("int,int16,int8,int8_acc16,sc_int8,sc_fixed");
+    std::vector<std::string> designs = split("B1,B2,F,R1,R2,W1,W2");
+    std::vector<std::string> taps = split("3,9,25");
+    uint64_t length = 100000;
+    int range = 8;      // Samples are uniform in [-range, range]; 127 with 64 taps overflows int8_acc16
+    unsigned seed = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 == argc)
+            return usage();
+        if (std::strcmp(argv[i], "--types") == 0)
+            types = split(argv[++i]);
+        else if (std::strcmp(argv[i], "--designs") == 0)
+            designs = split(argv[++i]);
+        else if (std::strcmp(argv[i], "--taps") == 0)
+            taps = split(argv[++i]);
+        else if (std::strcmp(argv[i], "--length") == 0)
+            length = std::strtoull(argv[++i], 0, 10);
+        else if (std::strcmp(argv[i], "--range") == 0)
+            range = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--seed") == 0)
+            seed = std::strtoul(argv[++i], 0, 10);
+        else
+            return usage();
+    }
+
+    std::vector<TypesPoint> points;
+    for (size_t t = 0; t < types.size(); t++) {
+        for (size_t d = 0; d < designs.size(); d++) {
+            Design design;
+            if (!parse_design(designs[d].c_str(), design)) {
+                cout << "Unknown design " << designs[d] << endl;
+                return 1;
+            }
+            for (size_t k = 0; k < taps.size(); k++) {
+                TypesPoint p = { types[t], design, std::atoi(taps[k].c_str()) };
+                points.push_back(p);
+            }
+        }
+    }
+
+    // Each point elaborates its own array, so each runs in its own child process
+    cout << "types,design,taps,cycles,wall_seconds,cycles_per_second,max_rss_kb,pe_bytes,accumulations,"
+            "overflows,errors,passed" << endl;
+    bool all_passed = true;
+    for (size_t i = 0; i < points.size(); i++) {
+        const TypesPoint& p = points[i];
+        TypesResult r = TypesResult();
+        bool ok = run_in_child([&](TypesResult& out) { return run_types(p, length, seed, range, out); }, r);
+        if (!ok) {
+            cout << "Failed to run " << p.types << " " << design_name(p.design) << "x" << p.taps
+                 << " (unknown type set or unsupported tap count?)" << endl;
+            all_passed = false;
+            continue;
+        }
+        // Overflowing accumulators are expected to disagree with the int golden model
+        bool passed = r.errors == 0 || r.overflows > 0;
+        all_passed &= passed;
+        cout << p.types << "," << design_name(p.design) << "," << p.taps << "," << r.cycles << "," << r.seconds
+             << "," << (r.seconds > 0 ? r.cycles / r.seconds : 0) << "," << r.max_rss_kb << "," << r.pe_bytes
+             << "," << r.accumulations << "," << r.overflows << "," << r.errors << ","
+             << (passed ? "true" : "false") << endl;
+    }
+    return all_passed ? 0 : 1;
+}
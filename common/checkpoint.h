@@ -0,0 +1,262 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <systemc.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <functional>
+#include <set>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#include "design.h"
+
+// Visits the state of a model in a fixed order, either copying every value into a
+// list or loading them back from one. PEs, helper modules and the golden checker
+// have a checkpoint(Archive&) member that names their registers in that order, so
+// one method does both. Values are kept as doubles, which hold every data type of
+// common/pe_types.h and any counter below 2^53 exactly.
+class CheckpointArchive {
+public:
+    CheckpointArchive(std::vector<double>& values, bool loading) : values(values), loading(loading), at(0) {}
+
+    template <class V>
+    void operator()(V& v) {
+        if (loading)
+            v = V(take());
+        else
+            values.push_back(static_cast<double>(v));
+    }
+
+    // A signal is written back, it takes the value at the next update phase
+    template <class V>
+    void operator()(sc_signal<V>& s) {
+        if (loading)
+            s.write(V(take()));
+        else
+            values.push_back(static_cast<double>(s.read()));
+    }
+
+    // Containers as their length and then each element
+    template <class V>
+    void operator()(std::vector<V>& c) { sequence(c); }
+
+    template <class V>
+    void operator()(std::deque<V>& c) { sequence(c); }
+
+    // n when saving, the length saved in its place when loading
+    size_t size(size_t n) {
+        double v = double(n);
+        (*this)(v);
+        return size_t(v);
+    }
+
+    // False if a load ran past the values or stopped short of them
+    bool complete() const { return !loading || at == values.size(); }
+    bool failed() const { return at > values.size(); }
+
+private:
+    double take() {
+        return at < values.size() ? values[at++] : (at++, 0.0);
+    }
+
+    // Elements go through a copy, so std::vector<bool> works too
+    template <class C>
+    void sequence(C& c) {
+        c.resize(size(c.size()));
+        for (size_t i = 0; i < c.size(); i++) {
+            typename C::value_type v = c[i];
+            (*this)(v);
+            c[i] = v;
+        }
+    }
+
+    std::vector<double>& values;
+    bool loading;
+    size_t at;
+};
+
+// Archives every sc_signal below root whose value type is bool, int or one of the
+// types T of the array, in elaboration order, except clocks. This covers the wires
+// between PEs as well as signals modules keep as state (B2 WeightLoader::armed,
+// R1/R2 OutputLogic::full).
+template <class T>
+class CheckpointSignals {
+public:
+    void add(sc_object& root) { visit(root); }
+
+    void archive(CheckpointArchive& a) {
+        for (size_t i = 0; i < signals.size(); i++)
+            signals[i](a);
+    }
+
+    size_t size() const { return signals.size(); }
+
+private:
+    void visit(sc_object& object) {
+        if (!seen.insert(&object).second || dynamic_cast<sc_clock*>(&object))
+            return;
+        if (signal<bool>(object) || signal<int>(object) || signal<typename T::data_t>(object) ||
+            signal<typename T::weight_t>(object) || signal<typename T::acc_t>(object))
+            return;
+        const std::vector<sc_object*>& children = object.get_child_objects();
+        for (size_t i = 0; i < children.size(); i++)
+            visit(*children[i]);
+    }
+
+    template <class V>
+    bool signal(sc_object& object) {
+        sc_signal<V>* s = dynamic_cast<sc_signal<V>*>(&object);
+        if (s)
+            signals.push_back([s](CheckpointArchive& a) { a(*s); });
+        return s != 0;
+    }
+
+    std::set<const sc_object*> seen;
+    std::vector<std::function<void(CheckpointArchive&)> > signals;
+};
+
+// Snapshot of a streamed run (common/stream_run.h), taken between a falling edge and
+// the next rising edge: the stimulus position, the monitor and golden checker, every
+// PE and module register and every signal. A run resumed from it elaborates the same
+// array, lets it settle, loads all of that back and carries on with rising edge
+// `edges` at the same simulated time, so its outputs are bit-identical to those of
+// the run it was taken from. Traces, PE counters and accumulator statistics start
+// afresh in the resumed run.
+struct Checkpoint {
+    Design design;
+    uint32_t taps;              // 0 while nothing has been saved
+    uint64_t edges;             // Rising edges simulated, the resumed run goes on with edge `edges`
+    uint64_t source_cycle;      // Input cycles the stimulus source has driven
+    uint64_t source_next;       // Samples it has driven
+    uint64_t output_hash;       // Of y_out so far, see BasicStreamMonitor
+    std::vector<double> checker;
+    std::vector<double> registers;
+    std::vector<double> signals;
+
+    Checkpoint() : design(Design::B1), taps(0), edges(0), source_cycle(0), source_next(0), output_hash(0) {}
+
+    bool valid() const { return taps > 0; }
+
+    // Simulated time of rising edge e of the clock run_stream() drives
+    static sc_time edge_time(uint64_t e) { return sc_time(5, SC_NS) + sc_time(10, SC_NS) * double(e); }
+
+    // Written to a temporary file next to path, synced and renamed over it, and the
+    // directory synced after the rename, so a crash or power loss while saving leaves
+    // either the previous checkpoint or the complete new one in place
+    bool write(const char* path, std::string& error) const {
+        std::string temporary = std::string(path) + ".tmp";
+        FILE* f = std::fopen(temporary.c_str(), "wb");
+        if (!f) {
+            error = "cannot create " + temporary;
+            return false;
+        }
+        Header h = header();
+        bool ok = std::fwrite(&h, sizeof(h), 1, f) == 1 && write_values(f, checker) && write_values(f, registers) &&
+                  write_values(f, signals);
+        if (ok && (std::fflush(f) != 0 || fsync(fileno(f)) != 0))
+            ok = false;
+        if (std::fclose(f) != 0)
+            ok = false;
+        if (ok && std::rename(temporary.c_str(), path) != 0)
+            ok = false;
+        if (ok && !sync_directory(path))
+            ok = false;
+        if (!ok) {
+            std::remove(temporary.c_str());
+            error = std::string("cannot write ") + path;
+        }
+        return ok;
+    }
+
+    bool read(const char* path, std::string& error) {
+        FILE* f = std::fopen(path, "rb");
+        if (!f) {
+            error = std::string("cannot open ") + path;
+            return false;
+        }
+        Header h;
+        bool ok = std::fread(&h, sizeof(h), 1, f) == 1 && std::memcmp(h.magic, magic(), sizeof(h.magic)) == 0;
+        if (ok) {
+            design = Design(h.design);
+            taps = h.taps;
+            edges = h.edges;
+            source_cycle = h.source_cycle;
+            source_next = h.source_next;
+            output_hash = h.output_hash;
+            ok = read_values(f, checker, h.checker) && read_values(f, registers, h.registers) &&
+                 read_values(f, signals, h.signals);
+        }
+        std::fclose(f);
+        if (!ok) {
+            taps = 0;
+            error = std::string(path) + " is not a checkpoint file or is truncated";
+        }
+        return ok;
+    }
+
+private:
+    // Host byte order, like the stimulus files
+    struct Header {
+        char magic[8];          // "SACKPT2\0"
+        uint32_t design;
+        uint32_t taps;
+        uint64_t edges, source_cycle, source_next, output_hash;
+        uint64_t checker, registers, signals;   // Values in each list
+    };
+
+    static const char* magic() { return "SACKPT2"; }
+
+    Header header() const {
+        Header h;
+        std::memcpy(h.magic, magic(), sizeof(h.magic));
+        h.design = uint32_t(design);
+        h.taps = taps;
+        h.edges = edges;
+        h.source_cycle = source_cycle;
+        h.source_next = source_next;
+        h.output_hash = output_hash;
+        h.checker = checker.size();
+        h.registers = registers.size();
+        h.signals = signals.size();
+        return h;
+    }
+
+    static bool write_values(FILE* f, const std::vector<double>& v) {
+        return v.empty() || std::fwrite(v.data(), sizeof(double), v.size(), f) == v.size();
+    }
+
+    static bool read_values(FILE* f, std::vector<double>& v, uint64_t n) {
+        v.resize(n);
+        return n == 0 || std::fread(v.data(), sizeof(double), n, f) == n;
+    }
+
+    // fsync the directory holding path, which makes a rename into it durable
+    static bool sync_directory(const char* path) {
+        std::string file(path);
+        size_t slash = file.rfind('/');
+        std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : file.substr(0, slash);
+        int fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+        if (fd < 0)
+            return false;
+        bool ok = fsync(fd) == 0;
+        close(fd);
+        return ok;
+    }
+};
+
+// Checkpoints of one run_stream() call: every `every` rising edges a snapshot is
+// handed to saved(), and with resume set the run starts from that snapshot instead
+// of from reset. The array must be the one the snapshot was taken of.
+struct CheckpointPlan {
+    uint64_t every;                                 // 0 for no snapshots
+    std::function<void(const Checkpoint&)> saved;
+    const Checkpoint* resume;
+
+    CheckpointPlan() : every(0), resume(0) {}
+};
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef CHILD_PROCESS_H
+#define CHILD_PROCESS_H
+
+#include <iostream>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Run fn(result) in a forked child and copy result back through a pipe.
+// SystemC elaborates once per process, so tools that simulate several arrays
+// one after the other give each its own child. Result must be trivially copyable,
+// and fn returns false if the child failed.
+template <class Result, class Fn>
+inline bool run_in_child(Fn fn, Result& result) {
+    int fd[2];
+    if (pipe(fd) != 0)
+        return false;
+    std::cout.flush();
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fd[0]);
+        close(fd[1]);
+        return false;
+    }
+    if (pid == 0) {
+        close(fd[0]);
+        Result r = Result();
+        bool ok = fn(r);
+        std::cout.flush();
+        if (ok && write(fd[1], &r, sizeof(r)) != ssize_t(sizeof(r)))
+            ok = false;
+        close(fd[1]);
+        _exit(ok ? 0 : 1);
+    }
+    close(fd[1]);
+    ssize_t got = read(fd[0], &result, sizeof(result));
+    close(fd[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return got == ssize_t(sizeof(result)) && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+// Run fn(task) for tasks 0..count-1, each in its own forked child, with at most
+// `workers` children at a time. Children hand results back through memory the
+// caller shared before forking (mmap with MAP_SHARED), fn returns false if its
+// task failed. True if every task ran and succeeded.
+template <class Fn>
+inline bool run_in_children(size_t count, int workers, Fn fn) {
+    std::cout.flush();
+    size_t next = 0, running = 0;
+    bool ok = true;
+    while (next < count || running > 0) {
+        if (next < count && running < size_t(workers < 1 ? 1 : workers)) {
+            pid_t pid = fork();
+            if (pid < 0) {
+                ok = false;
+                next = count;
+                continue;
+            }
+            if (pid == 0) {
+                bool task_ok = fn(next);
+                std::cout.flush();
+                _exit(task_ok ? 0 : 1);
+            }
+            next++;
+            running++;
+            continue;
+        }
+        int status = 0;
+        if (waitpid(-1, &status, 0) < 0)
+            return false;
+        running--;
+        ok = ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+    return ok;
+}
+
+#endif
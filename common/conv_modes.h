@@ -0,0 +1,56 @@
+#ifndef CONV_MODES_H
+#define CONV_MODES_H
+
+#include <cstdint>
+#include <vector>
+
+// Strided and dilated 1D convolution, the reference for set_stride() (B1, F) and
+// set_dilation() (W1, W2). With dilation d the N weights sit d samples apart, so a
+// window spans (N-1) * d + 1 samples,
+//   y_i = w1 * x[i - (N-1) * d] + w2 * x[i - (N-2) * d] + ... + wN * x[i],
+// and with stride s only every s-th full window is wanted, y_{span-1}, y_{span-1+s}, ...
+struct ConvMode {
+    int stride;
+    int dilation;
+};
+
+// Samples one window spans
+inline int dilated_span(int n, int dilation) {
+    return (n - 1) * dilation + 1;
+}
+
+// The same filter as a plain kernel: dilation - 1 zeros between the weights
+inline std::vector<int> dilate_kernel(const std::vector<int>& kernel, int dilation) {
+    int n = int(kernel.size());
+    std::vector<int> padded(dilated_span(n, dilation), 0);
+    for (int k = 0; k < n; k++)
+        padded[size_t(k) * dilation] = kernel[k];
+    return padded;
+}
+
+// True if full window i (i >= span - 1) is one the stride keeps
+inline bool kept_window(uint64_t i, int span, int stride) {
+    return (i - uint64_t(span - 1)) % uint64_t(stride) == 0;
+}
+
+// The wanted windows of x, in order
+inline std::vector<int> convolve_mode(const std::vector<int>& kernel, const std::vector<int>& x, const ConvMode& mode) {
+    int n = int(kernel.size()), span = dilated_span(n, mode.dilation);
+    std::vector<int> y;
+    for (size_t i = size_t(span - 1); i < x.size(); i += size_t(mode.stride)) {
+        long long sum = 0;
+        for (int k = 0; k < n; k++)
+            sum += (long long)kernel[k] * x[i - size_t(n - 1 - k) * mode.dilation];
+        y.push_back(int(sum));
+    }
+    return y;
+}
+
+// Edges c in [0, edges) with (c - first) % stride == 0, the ones a StrideGate set
+// to (stride, first) lets multiply
+inline uint64_t kept_edges(uint64_t edges, int stride, int first) {
+    uint64_t c0 = uint64_t((first % stride + stride) % stride);
+    return c0 < edges ? (edges - 1 - c0) / stride + 1 : 0;
+}
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef CYCLE_H
+#define CYCLE_H
+
+// Top-level inputs sampled at one rising clock edge
+struct CycleIn {
+    bool rst;
+    int x;      // x_in
+    int y;      // y_in (B1, W1, W2)
+    int w;      // w_in (R1, R2)
+    bool tag;   // tag_in (R1, R2)
+};
+
+// Top-level outputs after that edge, i.e. what monitor() reads on the next edge
+struct CycleOut {
+    int y;      // y_out
+    int x;      // x_out (F, R1, R2, W1, W2)
+    int w;      // w_out (R1, R2)
+    bool tag;   // tag_out (R1, R2)
+};
+
+inline bool operator==(const CycleOut& a, const CycleOut& b) {
+    return a.y == b.y && a.x == b.x && a.w == b.w && a.tag == b.tag;
+}
+
+inline bool operator!=(const CycleOut& a, const CycleOut& b) {
+    return !(a == b);
+}
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef DESIGN_H
+#define DESIGN_H
+
+#include <cstring>
+#include <vector>
+
+// Dataflow styles, one per result directory
+enum class Design { B1, B2, F, R1, R2, W1, W2 };
+
+// Directory name of a design ("B1", "W2", ...)
+inline const char* design_name(Design d) {
+    switch (d) {
+    case Design::B1: return "B1";
+    case Design::B2: return "B2";
+    case Design::F:  return "F";
+    case Design::R1: return "R1";
+    case Design::R2: return "R2";
+    case Design::W1: return "W1";
+    case Design::W2: return "W2";
+    }
+    return "?";
+}
+
+// Parse a directory name back to its design, false if unknown
+inline bool parse_design(const char* name, Design& d) {
+    const Design all[] = { Design::B1, Design::B2, Design::F, Design::R1, Design::R2, Design::W1, Design::W2 };
+    for (Design candidate : all) {
+        if (std::strcmp(name, design_name(candidate)) == 0) {
+            d = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Kernel w1..wN = 1..N, the weights hardcoded by the 3-tap builds
+inline std::vector<int> default_weights(int n) {
+    std::vector<int> w(n);
+    for (int k = 0; k < n; k++)
+        w[k] = k + 1;
+    return w;
+}
+
+// Inputs per adder in F's adder tree. With at most this many PEs the tree is the
+// single registered adder of the 3-tap build.
+const int default_adder_fan_in = 4;
+
+// Pipeline levels of an adder tree summing n inputs with fan_in inputs per adder
+// (fan_in < 2 = one flat adder), each level adds one register and one cycle
+inline int adder_tree_levels(int n, int fan_in) {
+    int levels = 1;
+    if (fan_in >= 2) {
+        for (int width = (n + fan_in - 1) / fan_in; width > 1; width = (width + fan_in - 1) / fan_in)
+            levels++;
+    }
+    return levels;
+}
+
+#endif
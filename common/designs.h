@@ -0,0 +1,13 @@
+#ifndef DESIGNS_H
+#define DESIGNS_H
+
+// All seven dataflow styles, for tools that elaborate them side by side
+#include "../B1/result/design.cpp"
+#include "../B2/result/design.cpp"
+#include "../F/result/design.cpp"
+#include "../R1/result/design.cpp"
+#include "../R2/result/design.cpp"
+#include "../W1/result/design.cpp"
+#include "../W2/result/design.cpp"
+
+#endif
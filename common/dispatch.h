@@ -0,0 +1,47 @@
+#ifndef DISPATCH_H
+#define DISPATCH_H
+
+#include <vector>
+#include "design.h"
+
+// Tap counts the command-line tools elaborate. Each one is a separate
+// SystolicArray<D, N> instantiation, so the list is kept short.
+inline const std::vector<int>& supported_taps() {
+    static const std::vector<int> taps = { 1, 3, 5, 9, 16, 25, 32, 64, 128, 256 };
+    return taps;
+}
+
+// Call fn.template run<D, N>() for a design and tap count chosen at run time.
+// Returns false if the tap count is not in supported_taps().
+template <Design D, class Fn>
+inline bool dispatch_taps(int taps, Fn& fn) {
+    switch (taps) {
+    case 1:  fn.template run<D, 1>(); return true;
+    case 3:  fn.template run<D, 3>(); return true;
+    case 5:  fn.template run<D, 5>(); return true;
+    case 9:  fn.template run<D, 9>(); return true;
+    case 16: fn.template run<D, 16>(); return true;
+    case 25: fn.template run<D, 25>(); return true;
+    case 32: fn.template run<D, 32>(); return true;
+    case 64: fn.template run<D, 64>(); return true;
+    case 128: fn.template run<D, 128>(); return true;
+    case 256: fn.template run<D, 256>(); return true;
+    }
+    return false;
+}
+
+template <class Fn>
+inline bool dispatch(Design d, int taps, Fn& fn) {
+    switch (d) {
+    case Design::B1: return dispatch_taps<Design::B1>(taps, fn);
+    case Design::B2: return dispatch_taps<Design::B2>(taps, fn);
+    case Design::F:  return dispatch_taps<Design::F>(taps, fn);
+    case Design::R1: return dispatch_taps<Design::R1>(taps, fn);
+    case Design::R2: return dispatch_taps<Design::R2>(taps, fn);
+    case Design::W1: return dispatch_taps<Design::W1>(taps, fn);
+    case Design::W2: return dispatch_taps<Design::W2>(taps, fn);
+    }
+    return false;
+}
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef ENERGY_H
+#define ENERGY_H
+
+#include <systemc.h>
+#include <cstdint>
+#include "pe_counters.h"
+
+// What the PEs of one array did, in the operations EnergyModel prices. Comes from the
+// PE activity counters, so it needs -DPE_COUNTERS; without it counted is false and
+// every count is zero. Register writes and hops are the per-cycle register_writes and
+// forwarding_hops of the PE type times its clocked cycles.
+struct EnergyCounts {
+    bool counted;
+    uint64_t cycles;            // Clocked PE cycles, each one a multiply unless gated
+    uint64_t useful_macs;       // Multiplies with both operands nonzero
+    uint64_t gated_macs;        // Multiplies the zero-skip path (-DZERO_GATING) or a stride gate bypassed
+    uint64_t register_writes;
+    uint64_t hops;              // Values handed on to a neighbour or the output logic
+};
+
+template <class PE>
+inline EnergyCounts energy_counts(const sc_vector<PE>& pe) {
+    EnergyCounts c = EnergyCounts();
+#ifdef PE_COUNTERS
+    c.counted = true;
+    for (size_t i = 0; i < pe.size(); i++) {
+        const PeActivity& a = pe[i].counters.activity();
+        c.cycles += a.cycles;
+        c.useful_macs += a.useful_macs;
+        c.gated_macs += a.gated_macs;
+        c.register_writes += a.cycles * PE::register_writes;
+        c.hops += a.cycles * PE::forwarding_hops;
+    }
+#else
+    (void)pe;
+#endif
+    return c;
+}
+
+// Energy per operation in pJ, by default rough 45 nm figures for 32-bit integers: a
+// multiply and an add for the MAC, a 32-bit register, a short wire to the next PE.
+// Adder trees, output logic and clock distribution are not priced.
+struct EnergyModel {
+    double mac_pj;
+    double register_pj;
+    double hop_pj;
+
+    EnergyModel() : mac_pj(3.2), register_pj(0.2), hop_pj(0.1) {}
+
+    // A multiplier without gating works every clocked cycle, with zero gating only
+    // when both operands are nonzero
+    double mac_energy(const EnergyCounts& c, bool gating) const {
+        return mac_pj * double(gating ? c.useful_macs : c.cycles);
+    }
+
+    double register_energy(const EnergyCounts& c) const { return register_pj * double(c.register_writes); }
+
+    double hop_energy(const EnergyCounts& c) const { return hop_pj * double(c.hops); }
+
+    double total(const EnergyCounts& c, bool gating) const {
+        return mac_energy(c, gating) + register_energy(c) + hop_energy(c);
+    }
+};
+
+#endif
@@ -0,0 +1,443 @@
+#ifndef FAST_MODEL_H
+#define FAST_MODEL_H
+
+#include <cstddef>
+#include <vector>
+#include "cycle.h"
+#include "design.h"
+
+// Cycle-accurate model of SystolicArray<D, N> that runs without the SystemC kernel.
+// Each PE register is one array indexed by PE (index 0 is PE1), and step() updates
+// every PE for one clock edge. Reset is sampled at the clock edge.
+template <Design D>
+class FastModel;
+
+// Registers shared by every design
+struct FastModelBase {
+    int n;                          // Number of PEs
+    std::vector<int> weight;        // Fixed weight per PE (B1, F, W1, W2)
+    std::vector<int> y_out;         // PE y_out signals
+
+    explicit FastModelBase(int n) : n(n), weight(n, 0), y_out(n, 0) {}
+};
+
+template <>
+class FastModel<Design::B1> : public FastModelBase {
+public:
+    std::vector<int> mult_result_reg, y_reg, sum, x;
+
+    explicit FastModel(int n, const std::vector<int>& w = std::vector<int>())
+        : FastModelBase(n), mult_result_reg(n, 0), y_reg(n, 0), sum(n, 0), x(n, 0) {
+        set_weights(w.empty() ? default_weights(n) : w);
+    }
+
+    // Kernel w1..wN, w1 goes to the leftmost PE
+    void set_weights(const std::vector<int>& w) {
+        for (int i = 0; i < n; i++)
+            weight[i] = w[i];
+    }
+
+    void reset() {
+        for (int i = 0; i < n; i++) {
+            mult_result_reg[i] = 0;
+            y_reg[i] = 0;
+            y_out[i] = 0;
+        }
+    }
+
+    CycleOut step(const CycleIn& in) {
+        if (in.rst) {
+            reset();
+        } else {
+            // Right to left so y_out[i - 1] still holds last cycle's value
+            for (int i = n - 1; i >= 0; i--) {
+                x[i] = in.x;
+                mult_result_reg[i] = x[i] * weight[i];
+                y_reg[i] = i ? y_out[i - 1] : in.y;
+                sum[i] = mult_result_reg[i] + y_reg[i];
+                y_out[i] = sum[i];
+            }
+        }
+        CycleOut out = { y_out[n - 1], 0, 0, false };
+        return out;
+    }
+};
+
+template <>
+class FastModel<Design::B2> : public FastModelBase {
+public:
+    std::vector<int> w_reg, tag_reg, x, y;
+    std::vector<int> w_out, tag_out;    // Weight ring, w_out[i] feeds PE(i+2)
+    int y_mux;                          // YMux output
+
+    explicit FastModel(int n, const std::vector<int>& w = std::vector<int>())
+        : FastModelBase(n), w_reg(n, 0), tag_reg(n, 0), x(n, 0), y(n, 0), w_out(n, 0), tag_out(n, 0), y_mux(0) {
+        set_weights(w.empty() ? default_weights(n) : w);
+    }
+
+    // Seed the weight ring with kernel w1..wN, w1 enters PE1 together with the tag.
+    // Kernels reloaded through w_load are not modelled, CycleIn has no w_load.
+    void set_weights(const std::vector<int>& w) {
+        for (int i = 0; i < n; i++) {
+            w_out[(i + n - 1) % n] = w[(n - i) % n];
+            tag_out[(i + n - 1) % n] = (i == 0);
+        }
+    }
+
+    // Reset leaves the weight ring untouched, as in PE_B2
+    void reset() {
+        for (int i = 0; i < n; i++) {
+            w_reg[i] = 0;
+            tag_reg[i] = 0;
+            y[i] = 0;
+            y_out[i] = 0;
+        }
+        y_mux = 0;
+    }
+
+    CycleOut step(const CycleIn& in) {
+        if (in.rst) {
+            reset();
+        } else {
+            int w_last = w_out[n - 1];
+            int tag_last = tag_out[n - 1];
+            for (int i = n - 1; i >= 0; i--) {
+                int w_in = i ? w_out[i - 1] : w_last;
+                int tag_in = i ? tag_out[i - 1] : tag_last;
+                if (tag_in) {
+                    y_out[i] = y[i];
+                    y[i] = 0;
+                } else {
+                    y_out[i] = 0;
+                }
+                x[i] = in.x;
+                w_reg[i] = w_in;
+                tag_reg[i] = tag_in;
+                y[i] = x[i] * w_reg[i] + y[i];
+                w_out[i] = w_reg[i];
+                tag_out[i] = tag_reg[i];
+            }
+            y_mux = 0;
+            for (int i = 0; i < n; i++) {
+                if (y_out[i] != 0) {
+                    y_mux = y_out[i];
+                    break;
+                }
+            }
+        }
+        CycleOut out = { y_mux, 0, 0, false };
+        return out;
+    }
+};
+
+template <>
+class FastModel<Design::F> : public FastModelBase {
+public:
+    std::vector<int> x_reg, x_out, z_out;
+    int fan_in;                         // Inputs per adder of the adder tree
+    std::vector<std::vector<int> > level;   // Adder tree registers, level.back()[0] drives y_out
+
+    explicit FastModel(int n, const std::vector<int>& w = std::vector<int>(), int fan_in = default_adder_fan_in)
+        : FastModelBase(n), x_reg(n, 0), x_out(n, 0), z_out(n, 0), fan_in(fan_in < 2 ? n : fan_in) {
+        int width = n;
+        do {
+            width = (width + this->fan_in - 1) / this->fan_in;
+            level.push_back(std::vector<int>(width, 0));
+        } while (width > 1);
+        set_weights(w.empty() ? default_weights(n) : w);
+    }
+
+    // Kernel w1..wN, w1 goes to PE1
+    void set_weights(const std::vector<int>& w) {
+        for (int i = 0; i < n; i++)
+            weight[i] = w[i];
+    }
+
+    void reset() {
+        for (int i = 0; i < n; i++) {
+            x_reg[i] = 0;
+            x_out[i] = 0;
+            z_out[i] = 0;
+        }
+        for (size_t l = 0; l < level.size(); l++)
+            level[l].assign(level[l].size(), 0);
+    }
+
+    CycleOut step(const CycleIn& in) {
+        if (in.rst) {
+            reset();
+        } else {
+            // Each adder tree level samples what the level before held last cycle,
+            // the first one last cycle's products
+            for (size_t l = level.size(); l-- > 0;) {
+                const std::vector<int>& prev = l ? level[l - 1] : z_out;
+                for (size_t j = 0; j < level[l].size(); j++) {
+                    int sum = 0;
+                    for (size_t k = j * fan_in; k < prev.size() && k < (j + 1) * fan_in; k++)
+                        sum += prev[k];
+                    level[l][j] = sum;
+                }
+            }
+
+            // x flows PEN -> PE1, so walk left to right
+            for (int i = 0; i < n; i++) {
+                x_reg[i] = (i == n - 1) ? in.x : x_out[i + 1];
+                z_out[i] = x_reg[i] * weight[i];
+                x_out[i] = x_reg[i];
+            }
+        }
+        CycleOut out = { level.back()[0], x_out[0], 0, false };
+        return out;
+    }
+};
+
+template <>
+class FastModel<Design::R1> : public FastModelBase {
+public:
+    std::vector<int> w_reg, tag_reg, x, y, x_reg, mult_result_reg;
+    std::vector<int> x_out, w_out, tag_out, y_valid;
+    std::vector<int> reg, reg_valid;    // OutputLogic registers
+    int y_final;                        // OutputLogic output, y_out is always taken
+
+    explicit FastModel(int n, const std::vector<int>& = std::vector<int>())
+        : FastModelBase(n), w_reg(n, 0), tag_reg(n, 0), x(n, 0), y(n, 0), x_reg(n, 0), mult_result_reg(n, 0),
+          x_out(n, 0), w_out(n, 0), tag_out(n, 0), y_valid(n, 0), reg(n, 0),
+          reg_valid(n, 0), y_final(0) {}
+
+    // Weights stream in through w_in
+    void set_weights(const std::vector<int>&) {}
+
+    void reset() {
+        for (int i = 0; i < n; i++) {
+            x_reg[i] = 0;
+            mult_result_reg[i] = 0;
+            w_reg[i] = 0;
+            tag_reg[i] = 0;
+            y[i] = 0;
+            y_out[i] = 0;
+            y_valid[i] = 0;
+            reg[i] = 0;
+            reg_valid[i] = 0;
+        }
+        y_final = 0;
+    }
+
+    CycleOut step(const CycleIn& in) {
+        if (in.rst) {
+            reset();
+        } else {
+            // Output logic samples last cycle's PE outputs, PE1 first
+            reg[0] = y_out[0];
+            reg_valid[0] = y_valid[0];
+            for (int i = 1; i < n; i++) {
+                reg[i] = y_valid[i] ? y_out[i] : reg[i - 1];
+                reg_valid[i] = y_valid[i] || reg_valid[i - 1];
+            }
+            y_final = reg[n - 1];
+
+            // x flows PE1 -> PEN
+            for (int i = n - 1; i >= 0; i--) {
+                x[i] = i ? x_out[i - 1] : in.x;
+                x_out[i] = x[i];
+            }
+
+            // w and tag flow PEN -> PE1
+            for (int i = 0; i < n; i++) {
+                int w_in = (i == n - 1) ? in.w : w_out[i + 1];
+                int tag_in = (i == n - 1) ? in.tag : tag_out[i + 1];
+                y_valid[i] = tag_in;
+                if (tag_in) {
+                    y_out[i] = y[i];
+                    y[i] = 0;
+                } else {
+                    y_out[i] = 0;
+                }
+                w_reg[i] = w_in;
+                tag_reg[i] = tag_in;
+                y[i] = x[i] * w_reg[i] + y[i];
+                w_out[i] = w_reg[i];
+                tag_out[i] = tag_reg[i];
+            }
+        }
+        CycleOut out = { y_final, x_out[n - 1], w_out[0], tag_out[0] != 0 };
+        return out;
+    }
+};
+
+template <>
+class FastModel<Design::R2> : public FastModelBase {
+public:
+    std::vector<int> w_reg1, w_reg2, tag_reg1, tag_reg2, x, y, x_reg;
+    std::vector<int> x_out, w_out, tag_out, y_valid;
+    std::vector<int> reg, reg_valid;    // OutputLogic registers
+    int y_final;                        // OutputLogic output, y_out is always taken
+
+    explicit FastModel(int n, const std::vector<int>& = std::vector<int>())
+        : FastModelBase(n), w_reg1(n, 0), w_reg2(n, 0), tag_reg1(n, 0), tag_reg2(n, 0), x(n, 0), y(n, 0),
+          x_reg(n, 0), x_out(n, 0), w_out(n, 0), tag_out(n, 0), y_valid(n, 0), reg(n, 0),
+          reg_valid(n, 0), y_final(0) {}
+
+    // Weights stream in through w_in
+    void set_weights(const std::vector<int>&) {}
+
+    void reset() {
+        for (int i = 0; i < n; i++) {
+            x_reg[i] = 0;
+            w_reg1[i] = 0;
+            w_reg2[i] = 0;
+            tag_reg1[i] = 0;
+            tag_reg2[i] = 0;
+            y[i] = 0;
+            y_out[i] = 0;
+            y_valid[i] = 0;
+            reg[i] = 0;
+            reg_valid[i] = 0;
+        }
+        y_final = 0;
+    }
+
+    CycleOut step(const CycleIn& in) {
+        if (in.rst) {
+            reset();
+        } else {
+            // Output logic shifts last cycle's PE outputs, last register first
+            for (int i = n - 1; i > 0; i--) {
+                reg[i] = y_valid[i] ? y_out[i] : reg[i - 1];
+                reg_valid[i] = y_valid[i] || reg_valid[i - 1];
+            }
+            reg[0] = y_out[0];
+            reg_valid[0] = y_valid[0];
+            y_final = reg[n - 1];
+
+            // x, w and tag all flow PE1 -> PEN
+            for (int i = n - 1; i >= 0; i--) {
+                int tag_in = i ? tag_out[i - 1] : in.tag;
+                y_valid[i] = tag_in;
+                if (tag_in) {
+                    y_out[i] = y[i];
+                    y[i] = 0;
+                } else {
+                    y_out[i] = 0;
+                }
+                x[i] = i ? x_out[i - 1] : in.x;
+                w_reg2[i] = w_reg1[i];
+                w_reg1[i] = i ? w_out[i - 1] : in.w;
+                tag_reg2[i] = tag_reg1[i];
+                tag_reg1[i] = tag_in;
+                y[i] = x[i] * w_reg1[i] + y[i];
+                w_out[i] = w_reg2[i];
+                tag_out[i] = tag_reg2[i];
+                x_out[i] = x[i];
+            }
+        }
+        CycleOut out = { y_final, x_out[n - 1], w_out[n - 1], tag_out[n - 1] != 0 };
+        return out;
+    }
+};
+
+template <>
+class FastModel<Design::W1> : public FastModelBase {
+public:
+    std::vector<int> x_reg, mult_result_reg, y_reg, sum;
+    std::vector<int> x_out;
+
+    explicit FastModel(int n, const std::vector<int>& w = std::vector<int>())
+        : FastModelBase(n), x_reg(n, 0), mult_result_reg(n, 0), y_reg(n, 0), sum(n, 0), x_out(n, 0) {
+        set_weights(w.empty() ? default_weights(n) : w);
+    }
+
+    // Kernel w1..wN, w1 goes to the leftmost PE
+    void set_weights(const std::vector<int>& w) {
+        for (int i = 0; i < n; i++)
+            weight[i] = w[i];
+    }
+
+    void reset() {
+        for (int i = 0; i < n; i++) {
+            x_reg[i] = 0;
+            mult_result_reg[i] = 0;
+            y_reg[i] = 0;
+            x_out[i] = 0;
+            y_out[i] = 0;
+        }
+    }
+
+    CycleOut step(const CycleIn& in) {
+        if (in.rst) {
+            reset();
+        } else {
+            // x flows PEN -> PE1
+            for (int i = 0; i < n; i++) {
+                x_reg[i] = (i == n - 1) ? in.x : x_out[i + 1];
+                x_out[i] = x_reg[i];
+            }
+
+            // Partial sums flow PE1 -> PEN
+            for (int i = n - 1; i >= 0; i--) {
+                mult_result_reg[i] = x_reg[i] * weight[i];
+                y_reg[i] = i ? y_out[i - 1] : in.y;
+                sum[i] = mult_result_reg[i] + y_reg[i];
+                y_out[i] = sum[i];
+            }
+        }
+        CycleOut out = { y_out[n - 1], x_out[0], 0, false };
+        return out;
+    }
+};
+
+template <>
+class FastModel<Design::W2> : public FastModelBase {
+public:
+    std::vector<int> x_reg1, x_reg2, mult_result_reg, y_reg, sum;
+    std::vector<int> x_out;
+
+    explicit FastModel(int n, const std::vector<int>& w = std::vector<int>())
+        : FastModelBase(n), x_reg1(n, 0), x_reg2(n, 0), mult_result_reg(n, 0), y_reg(n, 0), sum(n, 0), x_out(n, 0) {
+        set_weights(w.empty() ? default_weights(n) : w);
+    }
+
+    // Kernel w1..wN, w1 goes to the rightmost PE
+    void set_weights(const std::vector<int>& w) {
+        for (int i = 0; i < n; i++)
+            weight[i] = w[n - 1 - i];
+    }
+
+    void reset() {
+        for (int i = 0; i < n; i++) {
+            x_reg1[i] = 0;
+            x_reg2[i] = 0;
+            mult_result_reg[i] = 0;
+            y_reg[i] = 0;
+            x_out[i] = 0;
+            y_out[i] = 0;
+        }
+    }
+
+    CycleOut step(const CycleIn& in) {
+        if (in.rst) {
+            reset();
+        } else {
+            // x and partial sums both flow PE1 -> PEN
+            for (int i = n - 1; i >= 0; i--) {
+                x_reg2[i] = x_reg1[i];
+                x_reg1[i] = i ? x_out[i - 1] : in.x;
+                mult_result_reg[i] = x_reg1[i] * weight[i];
+                y_reg[i] = i ? y_out[i - 1] : in.y;
+                sum[i] = mult_result_reg[i] + y_reg[i];
+                x_out[i] = x_reg2[i];
+                y_out[i] = sum[i];
+            }
+        }
+        CycleOut out = { y_out[n - 1], x_out[n - 1], 0, false };
+        return out;
+    }
+};
+
+// Run a pre-built input stream through a fast model
+template <class Model>
+inline void run_fast(Model& model, const CycleIn* in, CycleOut* out, size_t cycles) {
+    for (size_t c = 0; c < cycles; c++)
+        out[c] = model.step(in[c]);
+}
+
+#endif
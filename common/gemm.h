@@ -0,0 +1,146 @@
+#ifndef GEMM_H
+#define GEMM_H
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+// Dense row-major int matrix
+struct Matrix {
+    int rows, cols;
+    std::vector<int> v;
+
+    Matrix(int rows = 0, int cols = 0) : rows(rows), cols(cols), v(size_t(rows) * cols, 0) {}
+
+    int& at(int r, int c) { return v[size_t(r) * cols + c]; }
+    int at(int r, int c) const { return v[size_t(r) * cols + c]; }
+
+    bool operator==(const Matrix& o) const { return rows == o.rows && cols == o.cols && v == o.v; }
+};
+
+// C = A * B, the reference for the matrix engine
+inline Matrix gemm_reference(const Matrix& a, const Matrix& b) {
+    Matrix c(a.rows, b.cols);
+    for (int m = 0; m < a.rows; m++)
+        for (int k = 0; k < a.cols; k++) {
+            int x = a.at(m, k);
+            if (x == 0)
+                continue;
+            for (int n = 0; n < b.cols; n++)
+                c.at(m, n) += x * b.at(k, n);
+        }
+    return c;
+}
+
+// A convolution layer with stride 1 and no padding: an in_channels x height x width
+// input, out_channels kernels of in_channels x kernel x kernel, and an
+// out_channels x out_height() x out_width() output, all stored channel, row, column.
+//   out[o][y][x] = sum over c, ky, kx of w[o][c][ky][kx] * in[c][y + ky][x + kx]
+struct ConvLayer {
+    int in_channels, height, width;
+    int out_channels;
+    int kernel;
+
+    int out_height() const { return height - kernel + 1; }
+    int out_width() const { return width - kernel + 1; }
+
+    // The layer as C = A * B: M output pixels, K terms per output, N output channels
+    int gemm_m() const { return out_height() * out_width(); }
+    int gemm_k() const { return in_channels * kernel * kernel; }
+    int gemm_n() const { return out_channels; }
+    uint64_t macs() const { return uint64_t(gemm_m()) * gemm_k() * gemm_n(); }
+
+    bool valid() const {
+        return in_channels > 0 && out_channels > 0 && kernel > 0 && height >= kernel && width >= kernel;
+    }
+};
+
+// im2col: row y * out_width() + x of A holds the window of output pixel (y, x),
+// column (c * kernel + ky) * kernel + kx the input value under w[.][c][ky][kx]
+inline Matrix im2col(const ConvLayer& l, const std::vector<int>& input) {
+    Matrix a(l.gemm_m(), l.gemm_k());
+    for (int y = 0; y < l.out_height(); y++)
+        for (int x = 0; x < l.out_width(); x++)
+            for (int c = 0; c < l.in_channels; c++)
+                for (int ky = 0; ky < l.kernel; ky++)
+                    for (int kx = 0; kx < l.kernel; kx++)
+                        a.at(y * l.out_width() + x, (c * l.kernel + ky) * l.kernel + kx) =
+                            input[(size_t(c) * l.height + y + ky) * l.width + x + kx];
+    return a;
+}
+
+// The kernels as B, column o holding kernel o in the order of im2col's columns
+inline Matrix conv_weight_matrix(const ConvLayer& l, const std::vector<int>& weights) {
+    Matrix b(l.gemm_k(), l.gemm_n());
+    for (int o = 0; o < l.out_channels; o++)
+        for (int k = 0; k < l.gemm_k(); k++)
+            b.at(k, o) = weights[size_t(o) * l.gemm_k() + k];
+    return b;
+}
+
+// C back into the output layout, out[o][y][x] = C[y * out_width() + x][o]
+inline std::vector<int> col2im(const ConvLayer& l, const Matrix& c) {
+    std::vector<int> out(size_t(l.out_channels) * l.gemm_m());
+    for (int o = 0; o < l.out_channels; o++)
+        for (int m = 0; m < l.gemm_m(); m++)
+            out[size_t(o) * l.gemm_m() + m] = c.at(m, o);
+    return out;
+}
+
+// Direct convolution, independent of im2col, to check the whole path against
+inline std::vector<int> conv_reference(const ConvLayer& l, const std::vector<int>& input,
+                                       const std::vector<int>& weights) {
+    std::vector<int> out(size_t(l.out_channels) * l.gemm_m(), 0);
+    for (int o = 0; o < l.out_channels; o++)
+        for (int y = 0; y < l.out_height(); y++)
+            for (int x = 0; x < l.out_width(); x++) {
+                long long sum = 0;
+                for (int c = 0; c < l.in_channels; c++)
+                    for (int ky = 0; ky < l.kernel; ky++)
+                        for (int kx = 0; kx < l.kernel; kx++)
+                            sum += (long long)weights[((size_t(o) * l.in_channels + c) * l.kernel + ky) * l.kernel + kx] *
+                                   input[(size_t(c) * l.height + y + ky) * l.width + x + kx];
+                out[(size_t(o) * l.out_height() + y) * l.out_width() + x] = int(sum);
+            }
+    return out;
+}
+
+// Values uniform in [-range, range]
+inline std::vector<int> random_values(size_t count, unsigned seed, int range) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> value(-range, range);
+    std::vector<int> v(count);
+    for (size_t i = 0; i < count; i++)
+        v[i] = value(rng);
+    return v;
+}
+
+// How an M x K by K x N product runs on a weight-stationary ROWS x COLS array
+// (W1_Gemm): B is cut into ROWS x COLS tiles, zero-padded at the edges, and for each
+// tile every row of A streams through once, adding the tile's share of C into an
+// accumulator. Per tile that is `rows` cycles to shift the weights in, M cycles of
+// rows of A and `latency` cycles for the last one to leave the array before the next
+// tile's weights may shift in. Tiles go column by column, all K tiles of one N
+// tile in turn, so each block of C is finished before the next is started.
+struct GemmTiling {
+    int m, k, n;
+    int rows, cols;     // Array size
+    int latency;        // W1_Gemm::latency
+
+    int k_tiles() const { return (k + rows - 1) / rows; }
+    int n_tiles() const { return (n + cols - 1) / cols; }
+    int tiles() const { return k_tiles() * n_tiles(); }
+
+    uint64_t load_cycles() const { return uint64_t(tiles()) * rows; }
+    uint64_t stream_cycles() const { return uint64_t(tiles()) * m; }
+    uint64_t drain_cycles() const { return uint64_t(tiles()) * latency; }
+
+    // Reset, then every tile; the last row of C of the last tile is out after the last drain cycle
+    uint64_t cycles() const { return 1 + load_cycles() + stream_cycles() + drain_cycles(); }
+
+    uint64_t useful_macs() const { return uint64_t(m) * k * n; }
+    // PE-cycles of the streaming cycles, useful or multiplying padding
+    uint64_t streamed_macs() const { return stream_cycles() * rows * cols; }
+};
+
+#endif
@@ -0,0 +1,205 @@
+#ifndef GOLDEN_CHECKER_H
+#define GOLDEN_CHECKER_H
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <vector>
+#include "design.h"
+
+// Cycles from the input cycle that carries sample i to the cycle whose y_out holds
+// its result (0 = visible right after that rising edge). Each design's output for
+// sample i is y_i = w1 * x[i-N+1] + ... + wN * x[i], the 1D convolution with the
+// kernel reversed. R1 emits results in bursts of N, so its latency depends on i;
+// with an even N its w/tag come a cycle after x (weight_offset()), which shifts
+// the bursts by one sample. F's is the depth of its adder tree with the default fan-in.
+inline int output_latency(Design d, int n, uint64_t i) {
+    switch (d) {
+    case Design::B1: return 0;
+    case Design::B2: return 1;
+    case Design::F:  return adder_tree_levels(n, default_adder_fan_in);
+    case Design::R1: {
+        int phase = int((i + n - n / 2) % n);
+        return 3 + (n - 1) - phase;
+    }
+    case Design::R2: return n + 1;
+    case Design::W1: return 0;
+    case Design::W2: return n - 1;
+    }
+    return 0;
+}
+
+// Streaming reference for one array. Feed it every sample as it is driven and
+// every y_out as it is read; it computes the expected convolution incrementally
+// from the last N samples, matches it to the output cycle and keeps only counters
+// and the first few mismatches, so it costs no per-cycle console output.
+class GoldenChecker {
+public:
+    // Sample i is checked if skip_head <= i < samples - skip_tail (samples 0 = unknown length)
+    GoldenChecker(Design design, const std::vector<int>& kernel, uint64_t samples, uint64_t skip_head,
+                  uint64_t skip_tail)
+        : design(design), dot_product(false), kernel(kernel), history(kernel.size(), 0),
+          weight_history(kernel.size(), 0), pos(0), samples(samples), skip_head(skip_head), skip_tail(skip_tail),
+          next_sample(0), checked(0), mismatches(0), missed(0), report_limit(10), first_latency(0), fixed_latency(-1) {}
+
+    // Checker for SystolicArray<D, N> driven with the default kernel. R1 and R2 load their
+    // weights through w_in, so the first N-1 results and the last N, which wait on a tag
+    // after the stream ends, are not checked.
+    static GoldenChecker for_design(Design d, int n, uint64_t samples) {
+        bool streamed = d == Design::R1 || d == Design::R2;
+        return GoldenChecker(d, default_weights(n), samples, streamed ? n - 1 : 0, streamed ? n : 0);
+    }
+
+    // Checker for the root R2 design: result1 + result2 + ... + resultN after each edge
+    // is the dot product of the last N (x, w) pairs, visible right after the edge.
+    static GoldenChecker for_dot_product(int n, uint64_t samples) {
+        GoldenChecker c(Design::R2, std::vector<int>(n, 0), samples, 0, 0);
+        c.dot_product = true;
+        return c;
+    }
+
+    // Expect `k` from the window whose oldest sample is first_sample on, for arrays
+    // that load a new kernel while running. Switches are given in sample order.
+    void switch_kernel(uint64_t first_sample, const std::vector<int>& k) {
+        KernelSwitch next = { first_sample, k };
+        switches.push_back(next);
+    }
+
+    // Expect every result `cycles` after its newest sample instead of output_latency(),
+    // for arrays built with other than the default pipelining, e.g. F with another fan-in
+    void set_output_latency(int cycles) { fixed_latency = cycles; }
+
+    // Sample driven on input cycle `cycle` (w is only used by the dot-product checker)
+    void sample(uint64_t cycle, int x, int w = 0) {
+        size_t n = kernel.size();
+        pos = (pos + 1) % n;
+        history[pos] = x;
+        weight_history[pos] = w;
+
+        uint64_t i = next_sample++;
+        while (!switches.empty() && i >= switches.front().first_sample + n - 1) {
+            kernel = switches.front().kernel;
+            switches.pop_front();
+        }
+        if (i < skip_head || (samples && i + skip_tail >= samples))
+            return;
+
+        // history[pos] is x[i], history[pos - k] is x[i - k]
+        long long y = 0;
+        for (size_t k = 0; k < n; k++) {
+            size_t at = (pos + n - k) % n;
+            y += (long long)(dot_product ? weight_history[at] : kernel[n - 1 - k]) * history[at];
+        }
+        int latency = dot_product ? 0 : fixed_latency >= 0 ? fixed_latency : output_latency(design, int(n), i);
+        Expected e = { cycle + latency, i, latency, int(y) };
+        pending.push_back(e);
+    }
+
+    // y_out as it is after the rising edge of input cycle `cycle`. Results due on an
+    // earlier cycle that was never passed in count as missing.
+    void output(uint64_t cycle, int y) {
+        while (!pending.empty() && pending.front().cycle <= cycle) {
+            const Expected& e = pending.front();
+            if (e.cycle == cycle) {
+                if (checked++ == 0)
+                    first_latency = e.latency;
+                if (y != e.y)
+                    mismatch(e, y);
+            } else if (++missed <= report_limit) {
+                std::cout << "No y_out for cycle " << e.cycle << " (sample " << e.sample << "): expected " << e.y
+                          << std::endl;
+            }
+            pending.pop_front();
+        }
+    }
+
+    // Print the summary, true if every checked result matched and none are outstanding
+    bool finish() {
+        if (mismatches > report_limit)
+            std::cout << "... " << mismatches - report_limit << " more mismatches not shown" << std::endl;
+        std::cout << "Checked " << checked << " results: " << mismatches << " mismatches, " << missing_count()
+                  << " never produced" << std::endl;
+        bool ok = mismatches == 0 && missing_count() == 0;
+        std::cout << (ok ? "PASS" : "FAIL") << std::endl;
+        return ok;
+    }
+
+    uint64_t results_checked() const { return checked; }
+    uint64_t mismatch_count() const { return mismatches; }
+    // Results still outstanding plus those whose output cycle was skipped over
+    uint64_t missing_count() const { return pending.size() + missed; }
+    // Cycles from the first checked sample entering to its result on y_out
+    int first_output_latency() const { return first_latency; }
+    // Mismatches printed while running, the rest are only counted
+    void set_report_limit(uint64_t limit) { report_limit = limit; }
+    // Called with the output cycle of every mismatch, e.g. to dump a trace around it
+    void on_mismatch(std::function<void(uint64_t cycle)> hook) { mismatch_hook = hook; }
+
+    // Everything sample() and output() change, for common/checkpoint.h. A checker
+    // constructed like the original one continues it after loading this.
+    template <class Archive>
+    void checkpoint(Archive& a) {
+        a(kernel);
+        a(history);
+        a(weight_history);
+        a(pos);
+        a(next_sample);
+        a(checked);
+        a(mismatches);
+        a(missed);
+        a(first_latency);
+        pending.resize(a.size(pending.size()));
+        for (size_t i = 0; i < pending.size(); i++) {
+            a(pending[i].cycle);
+            a(pending[i].sample);
+            a(pending[i].latency);
+            a(pending[i].y);
+        }
+        switches.resize(a.size(switches.size()));
+        for (size_t i = 0; i < switches.size(); i++) {
+            a(switches[i].first_sample);
+            a(switches[i].kernel);
+        }
+    }
+
+private:
+    struct Expected {
+        uint64_t cycle;     // Output cycle the result is due on
+        uint64_t sample;    // Index of the newest sample in its window
+        int latency;        // Cycles after that sample was driven
+        int y;
+    };
+
+    struct KernelSwitch {
+        uint64_t first_sample;
+        std::vector<int> kernel;
+    };
+
+    void mismatch(const Expected& e, int y) {
+        if (++mismatches <= report_limit)
+            std::cout << "Mismatch at cycle " << e.cycle << " (sample " << e.sample << "): expected " << e.y
+                      << ", got " << y << std::endl;
+        if (mismatch_hook)
+            mismatch_hook(e.cycle);
+    }
+
+    Design design;
+    bool dot_product;                   // Root R2: weights come with the samples
+    std::vector<int> kernel;
+    std::vector<int> history;           // Last N samples, ring buffer
+    std::vector<int> weight_history;    // Their w values, for the dot-product checker
+    size_t pos;                         // Ring index of the newest sample
+    uint64_t samples, skip_head, skip_tail;
+    uint64_t next_sample;
+    std::deque<Expected> pending;
+    std::deque<KernelSwitch> switches;  // Kernels still to come, see switch_kernel()
+    uint64_t checked, mismatches;
+    uint64_t missed;                    // Results whose output cycle output() never saw
+    uint64_t report_limit;
+    int first_latency;
+    int fixed_latency;                  // set_output_latency(), -1 for output_latency()
+    std::function<void(uint64_t)> mismatch_hook;
+};
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef GOLDEN_CHECKER_2D_H
+#define GOLDEN_CHECKER_2D_H
+
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <vector>
+
+// Streaming reference for a K x K convolution of raster images (W2_Conv2D). Feed it
+// every pixel as it is driven and every y_out / y_valid as they are read. It keeps
+// the last K rows of pixels, computes each window from them directly
+//   y(r, c) = sum over k, j of w[k * K + j] * image(r - K + 1 + k, c - K + 1 + j)
+// and expects it `latency` cycles after its bottom-right pixel, with y_valid set,
+// and y_valid clear on every other cycle. Like GoldenChecker it keeps only counters
+// and the first few mismatches.
+class GoldenChecker2D {
+public:
+    // Images width pixels wide and height rows high, 0 for one unbounded image
+    GoldenChecker2D(const std::vector<int>& kernel, int k, int width, int height, int latency)
+        : kernel(kernel), k(k), width(width), height(height), latency(latency), rows(size_t(k) * width, 0),
+          next_pixel(0), checked(0), mismatches(0), stray(0), report_limit(10) {}
+
+    // Pixel driven on input cycle `cycle`
+    void sample(uint64_t cycle, int pixel) {
+        uint64_t i = next_pixel++;
+        rows[i % rows.size()] = pixel;
+        uint64_t r = i / width, c = i % width;
+        if (height > 0)
+            r %= height;
+        if (r < uint64_t(k - 1) || c < uint64_t(k - 1))
+            return;
+
+        long long y = 0;
+        for (int a = 0; a < k; a++)
+            for (int b = 0; b < k; b++) {
+                uint64_t at = i - uint64_t(k - 1 - a) * width - uint64_t(k - 1 - b);
+                y += (long long)kernel[a * k + b] * rows[at % rows.size()];
+            }
+        Expected e = { cycle + latency, i, int(y) };
+        pending.push_back(e);
+    }
+
+    // y_out and y_valid as they are after the rising edge of input cycle `cycle`
+    void output(uint64_t cycle, int y, bool valid) {
+        while (!pending.empty() && pending.front().cycle < cycle)
+            pending.pop_front();
+        if (!pending.empty() && pending.front().cycle == cycle) {
+            const Expected& e = pending.front();
+            checked++;
+            if (!valid || y != e.y)
+                mismatch(e, y, valid);
+            pending.pop_front();
+        } else if (valid) {
+            if (++stray <= report_limit)
+                std::cout << "y_valid set at cycle " << cycle << " with no window due" << std::endl;
+        }
+    }
+
+    // Print the summary, true if every result matched and none are outstanding
+    bool finish() {
+        if (mismatches > report_limit)
+            std::cout << "... " << mismatches - report_limit << " more mismatches not shown" << std::endl;
+        std::cout << "Checked " << checked << " windows: " << mismatches << " mismatches, " << stray
+                  << " stray y_valid, " << pending.size() << " never produced" << std::endl;
+        bool ok = mismatches == 0 && stray == 0 && pending.empty();
+        std::cout << (ok ? "PASS" : "FAIL") << std::endl;
+        return ok;
+    }
+
+    uint64_t results_checked() const { return checked; }
+    // Wrong results, results without y_valid and y_valid without a result
+    uint64_t mismatch_count() const { return mismatches + stray; }
+    uint64_t missing_count() const { return pending.size(); }
+    void set_report_limit(uint64_t limit) { report_limit = limit; }
+
+private:
+    struct Expected {
+        uint64_t cycle;     // Output cycle the result is due on
+        uint64_t pixel;     // Stream index of the window's bottom-right pixel
+        int y;
+    };
+
+    void mismatch(const Expected& e, int y, bool valid) {
+        if (++mismatches <= report_limit)
+            std::cout << "Mismatch at cycle " << e.cycle << " (row " << e.pixel / width << ", column "
+                      << e.pixel % width << "): expected " << e.y << ", got " << y
+                      << (valid ? "" : " without y_valid") << std::endl;
+    }
+
+    std::vector<int> kernel;
+    int k, width, height, latency;
+    std::vector<int> rows;              // Last K rows of pixels, ring buffer by stream index
+    uint64_t next_pixel;
+    std::deque<Expected> pending;
+    uint64_t checked, mismatches, stray, report_limit;
+};
+
+#endif
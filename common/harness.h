@@ -0,0 +1,160 @@
+#ifndef HARNESS_H
+#define HARNESS_H
+
+#include <systemc.h>
+#include <vector>
+#include "designs.h"
+#include "fast_model.h"
+
+// Clock, reset and stimulus signals shared by every array under test, typed for an
+// array built with the data types T (common/pe_types.h)
+template <class T>
+struct BasicInputSignals {
+    sc_signal<bool> clk, rst;
+    sc_signal<typename T::data_t> x_in;
+    sc_signal<typename T::acc_t> y_in;
+    sc_signal<typename T::weight_t> w_in;
+    sc_signal<bool> tag_in;
+    sc_signal<bool> y_ready;    // R1, R2; held high, the harness takes every result
+    sc_signal<bool> w_load;     // B2, loads w_in into the shadow kernel
+
+    BasicInputSignals() {
+        y_ready.write(true);
+    }
+
+    // Drive one rising edge from sc_main with the given inputs, then the falling edge
+    void cycle(const CycleIn& in, const sc_time& period = sc_time(10, SC_NS)) {
+        rst.write(in.rst);
+        x_in.write(in.x);
+        y_in.write(in.y);
+        w_in.write(in.w);
+        tag_in.write(in.tag);
+        clk.write(true);
+        sc_start(period / 2);
+        clk.write(false);
+        sc_start(period / 2);
+    }
+};
+
+// Top-level output signals of one array
+template <class T>
+struct BasicOutputSignals {
+    sc_signal<typename T::data_t> x_out;
+    sc_signal<typename T::acc_t> y_out;
+    sc_signal<typename T::weight_t> w_out;
+    sc_signal<bool> tag_out;
+    sc_signal<bool> y_valid, in_ready;     // R1, R2
+    sc_signal<bool> w_load_ready;          // B2
+
+    CycleOut read() const {
+        CycleOut out = { as_int(y_out.read()), as_int(x_out.read()), as_int(w_out.read()), tag_out.read() };
+        return out;
+    }
+};
+
+typedef BasicInputSignals<IntTypes> InputSignals;
+typedef BasicOutputSignals<IntTypes> OutputSignals;
+
+// Port binding for each design. clk may be an sc_clock, in and out anything with
+// the members of BasicInputSignals / BasicOutputSignals the design has ports for,
+// signals or ports of an enclosing module (MultiFilter, common/multi_filter.h)
+template <int N, class T, class Clk, class In, class Out>
+inline void bind(SystolicArray<Design::B1, N, T>& a, Clk& clk, In& in, Out& out) {
+    a.clk(clk);
+    a.rst(in.rst);
+    a.x_in(in.x_in);
+    a.y_in(in.y_in);
+    a.y_out(out.y_out);
+}
+
+template <int N, class T, class Clk, class In, class Out>
+inline void bind(SystolicArray<Design::B2, N, T>& a, Clk& clk, In& in, Out& out) {
+    a.clk(clk);
+    a.rst(in.rst);
+    a.x_in(in.x_in);
+    a.w_load(in.w_load);
+    a.w_in(in.w_in);
+    a.w_load_ready(out.w_load_ready);
+    a.y_out(out.y_out);
+}
+
+template <int N, class T, class Clk, class In, class Out>
+inline void bind(SystolicArray<Design::F, N, T>& a, Clk& clk, In& in, Out& out) {
+    a.clk(clk);
+    a.rst(in.rst);
+    a.x_in(in.x_in);
+    a.x_out(out.x_out);
+    a.y_out(out.y_out);
+}
+
+template <int N, class T, class Clk, class In, class Out>
+inline void bind(SystolicArray<Design::R1, N, T>& a, Clk& clk, In& in, Out& out) {
+    a.clk(clk);
+    a.rst(in.rst);
+    a.x_in(in.x_in);
+    a.w_in(in.w_in);
+    a.tag_in(in.tag_in);
+    a.x_out(out.x_out);
+    a.w_out(out.w_out);
+    a.tag_out(out.tag_out);
+    a.y_out(out.y_out);
+    a.y_valid(out.y_valid);
+    a.y_ready(in.y_ready);
+    a.in_ready(out.in_ready);
+}
+
+template <int N, class T, class Clk, class In, class Out>
+inline void bind(SystolicArray<Design::R2, N, T>& a, Clk& clk, In& in, Out& out) {
+    a.clk(clk);
+    a.rst(in.rst);
+    a.x_in(in.x_in);
+    a.w_in(in.w_in);
+    a.tag_in(in.tag_in);
+    a.x_out(out.x_out);
+    a.w_out(out.w_out);
+    a.tag_out(out.tag_out);
+    a.y_out(out.y_out);
+    a.y_valid(out.y_valid);
+    a.y_ready(in.y_ready);
+    a.in_ready(out.in_ready);
+}
+
+template <int N, class T, class Clk, class In, class Out>
+inline void bind(SystolicArray<Design::W1, N, T>& a, Clk& clk, In& in, Out& out) {
+    a.clk(clk);
+    a.rst(in.rst);
+    a.x_in(in.x_in);
+    a.y_in(in.y_in);
+    a.x_out(out.x_out);
+    a.y_out(out.y_out);
+}
+
+template <int N, class T, class Clk, class In, class Out>
+inline void bind(SystolicArray<Design::W2, N, T>& a, Clk& clk, In& in, Out& out) {
+    a.clk(clk);
+    a.rst(in.rst);
+    a.x_in(in.x_in);
+    a.y_in(in.y_in);
+    a.x_out(out.x_out);
+    a.y_out(out.y_out);
+}
+
+// Bind to the harness clock signal
+template <class Array, class T>
+inline void bind(Array& a, BasicInputSignals<T>& in, BasicOutputSignals<T>& out) {
+    bind(a, in.clk, in, out);
+}
+
+// Fixed-weight arrays take the kernel before the run, R1 and R2 take it from w_in/tag_in
+template <class Array>
+inline void load_kernel(Array& array, const std::vector<int>& kernel) {
+    array.set_weights(kernel);
+}
+
+template <int N, class T>
+inline void load_kernel(SystolicArray<Design::R1, N, T>&, const std::vector<int>&) {}
+
+template <int N, class T>
+inline void load_kernel(SystolicArray<Design::R2, N, T>&, const std::vector<int>&) {}
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef IDLE_SKIP_H
+#define IDLE_SKIP_H
+
+#include <systemc.h>
+#include <cstdint>
+#include <functional>
+#include "design.h"
+
+// Rising edges an idle array may only be skipped in whole multiples of. The B2 weight
+// ring keeps turning while the array idles, so B2 skips whole turns of the ring.
+inline int idle_period(Design d, int n) {
+    return d == Design::B2 ? n : 1;
+}
+
+// Clock for sparse streams. Toggles clk like sc_clock("clk", 10, SC_NS, 0.5, 5, SC_NS,
+// true), but after each falling edge, once the sources have driven the next inputs,
+// asks idle_edges() how many of the coming rising edges are known to change nothing:
+// the array is quiescent() and the inputs stay zero. All but the last of those edges
+// are swallowed, in multiples of the idle period, by advancing simulated time in one
+// wait, and skip() tells the source and monitor which edges they did not see. The
+// last idle edge still fires, so every process sees a normal edge before the next
+// falling one. Results stay cycle-accurate; skipped() counts the swallowed edges.
+// The first rising edge comes at `start`, later for a run resumed from a checkpoint.
+SC_MODULE(SkippingClock) {
+    sc_signal<bool> clk;
+
+    std::function<uint64_t()> idle_edges;   // Idle rising edges from the next one on, 0 if none
+    std::function<void(uint64_t)> skip;     // Called with the edges about to be swallowed
+
+    sc_time period;
+    sc_time start;
+    uint64_t granularity;
+    uint64_t skipped;
+
+    SC_HAS_PROCESS(SkippingClock);
+    SkippingClock(sc_module_name name, uint64_t granularity = 1, const sc_time& period = sc_time(10, SC_NS),
+                  const sc_time& start = sc_time(5, SC_NS))
+        : sc_module(name), clk("clk"), period(period), start(start), granularity(granularity < 1 ? 1 : granularity),
+          skipped(0) {
+        SC_THREAD(run);
+    }
+
+    void run() {
+        wait(start);
+        for (;;) {
+            clk.write(true);
+            wait(period / 2);
+            clk.write(false);
+
+            // One delta for the falling-edge processes to drive, one for their writes to land
+            wait(SC_ZERO_TIME);
+            wait(SC_ZERO_TIME);
+            uint64_t idle = idle_edges ? idle_edges() : 0;
+            uint64_t swallow = idle > 1 ? (idle - 1) / granularity * granularity : 0;
+            if (swallow) {
+                skip(swallow);
+                skipped += swallow;
+            }
+            wait(period / 2 + period * double(swallow));
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef MULTI_FILTER_H
+#define MULTI_FILTER_H
+
+#include <systemc.h>
+#include <vector>
+#include "designs.h"
+#include "harness.h"
+
+// Output-channel parallelism: M arrays of one design side by side, each with its own
+// kernel, all taking the same x stream. One x_in is broadcast to every array, so a
+// stream convolved with M filters takes the cycles of one instead of M runs, and
+// y_out[f] carries filter f's result on the cycle a single array would put it out.
+// rst, y_in and tag_in are shared as well: R1 and R2 take the kernel from w_in, one
+// stream per filter on w_in[f], but the tags of the streams fall on the same slots
+// whatever the weights, so one tag_in serves all of them. B2 loads each filter's
+// shadow kernel from its own w_in[f] while the shared w_load is high. y_ready is
+// held high (every result is taken), and y_valid[f] is only driven by R1 and R2.
+template <Design D, int N, class T = IntTypes>
+struct MultiFilter : public sc_module {
+    typedef typename T::data_t data_t;
+    typedef typename T::weight_t weight_t;
+    typedef typename T::acc_t acc_t;
+    typedef SystolicArray<D, N, T> Array;
+
+    sc_in<bool> clk;
+    sc_in<bool> rst;
+
+    sc_in<data_t> x_in;                     // Broadcast to every filter
+    sc_in<acc_t> y_in;                      // B1, W1, W2
+    sc_in<bool> tag_in;                     // R1, R2
+    sc_in<bool> w_load;                     // B2
+    sc_vector<sc_in<weight_t> > w_in;       // Filter f's weights, R1, R2 and B2
+    sc_vector<sc_out<acc_t> > y_out;        // Filter f's result
+    sc_vector<sc_out<bool> > y_valid;       // R1, R2
+
+    sc_vector<Array> filter;
+
+    // What bind() takes from the harness signals, here the ports of this module
+    struct FilterInputs {
+        sc_in<bool>& rst;
+        sc_in<data_t>& x_in;
+        sc_in<acc_t>& y_in;
+        sc_in<weight_t>& w_in;
+        sc_in<bool>& tag_in;
+        sc_signal<bool>& y_ready;
+        sc_in<bool>& w_load;
+    };
+
+    struct FilterOutputs {
+        sc_signal<data_t>& x_out;
+        sc_out<acc_t>& y_out;
+        sc_signal<weight_t>& w_out;
+        sc_signal<bool>& tag_out;
+        sc_out<bool>& y_valid;
+        sc_signal<bool>& in_ready;
+        sc_signal<bool>& w_load_ready;
+    };
+
+    sc_signal<bool> y_ready;
+    sc_vector<sc_signal<data_t> > x_unused;
+    sc_vector<sc_signal<weight_t> > w_unused;
+    sc_vector<sc_signal<bool> > tag_unused, in_ready_unused, w_load_ready_unused;
+
+    MultiFilter(sc_module_name name, int filters)
+        : sc_module(name), w_in("w_in", filters), y_out("y_out", filters), y_valid("y_valid", filters),
+          filter("filter", filters), x_unused("x_unused", filters), w_unused("w_unused", filters),
+          tag_unused("tag_unused", filters), in_ready_unused("in_ready_unused", filters),
+          w_load_ready_unused("w_load_ready_unused", filters) {
+        y_ready.write(true);
+        for (int f = 0; f < filters; f++) {
+            FilterInputs in = { rst, x_in, y_in, w_in[f], tag_in, y_ready, w_load };
+            FilterOutputs out = { x_unused[f], y_out[f], w_unused[f], tag_unused[f],
+                                  y_valid[f], in_ready_unused[f], w_load_ready_unused[f] };
+            bind(filter[f], clk, in, out);
+        }
+    }
+
+    int filters() const { return int(filter.size()); }
+
+    // Kernel of filter f, w1 first; no-op for R1 and R2, whose kernels come on w_in[f]
+    void set_weights(int f, const std::vector<int>& w) { load_kernel(filter[f], w); }
+};
+
+// PE inputs one array's x_in drives: B1 and B2 broadcast x to every PE, the other
+// designs take it into PE1 only and pass it along
+inline int x_in_loads(Design d, int n) {
+    return d == Design::B1 || d == Design::B2 ? n : 1;
+}
+
+// Levels of a buffer tree of fan-out 4 that drives `loads` inputs from one source,
+// 0 if the source drives them directly. Each level is a gate delay on the x path,
+// or a cycle of input latency if the tree is registered to hold the clock rate.
+inline int fanout_levels(long long loads) {
+    int levels = 0;
+    for (long long reach = 4; reach < loads; reach *= 4)
+        levels++;
+    return levels;
+}
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef PE_COUNTERS_H
+#define PE_COUNTERS_H
+
+#include <systemc.h>
+#include <cstdint>
+#include <iostream>
+
+// Opt-in per-PE activity counters. Build with -DPE_COUNTERS to enable them; without
+// it every hook is an empty inline function and the PEs compile to what they were.
+//
+// Every clocked (non-reset) cycle of a PE falls into exactly one of:
+//   useful MAC      both multiplier operands were nonzero
+//   forwarded-only  no useful MAC, but the PE passed a nonzero x, w or partial sum on
+//   idle            neither
+// Tag flushes (a tag emptying the accumulator onto y_out) are counted on top, and
+// with -DZERO_GATING so are the multiplies pe_multiply() bypassed for a zero operand,
+// and the multiplies the stride gate of B1 and F skips (common/systolic_array.h).
+struct PeActivity {
+    uint64_t cycles;
+    uint64_t useful_macs;
+    uint64_t forwarded_only;
+    uint64_t idle;
+    uint64_t tag_flushes;
+    uint64_t gated_macs;
+};
+
+class PeCounters {
+public:
+#ifdef PE_COUNTERS
+    PeCounters() : a() {}
+
+    // One clocked cycle multiplying x by w, forwarding set if nonzero data moved on
+    template <class X, class W>
+    void cycle(const X& x, const W& w, bool forwarding) {
+        a.cycles++;
+        if (x != 0 && w != 0)
+            a.useful_macs++;
+        else if (forwarding)
+            a.forwarded_only++;
+        else
+            a.idle++;
+#ifdef ZERO_GATING
+        if (x == 0 || w == 0)
+            a.gated_macs++;
+#endif
+    }
+
+    void tag_flush() { a.tag_flushes++; }
+
+    // One clocked cycle whose multiply a stride gate skipped, idle and gated
+    void skipped() {
+        a.cycles++;
+        a.idle++;
+        a.gated_macs++;
+    }
+
+    const PeActivity& activity() const { return a; }
+
+private:
+    PeActivity a;
+#else
+    template <class X, class W>
+    void cycle(const X&, const W&, bool) {}
+    void tag_flush() {}
+    void skipped() {}
+#endif
+};
+
+// Print the per-PE utilization table of an array's sc_vector<PE>, each PE having
+// a PeCounters member named counters. Called from end_of_simulation(), i.e. at sc_stop().
+template <class PE>
+inline void report_pe_counters(const char* array, const sc_vector<PE>& pe) {
+#ifdef PE_COUNTERS
+    PeActivity total = PeActivity();
+    cout << "PE counters for " << array << endl;
+    cout << "PE\tCycles\tUseful\tFwdOnly\tIdle\tFlushes\tGated\tUtilization" << endl;
+    for (size_t i = 0; i < pe.size(); i++) {
+        const PeActivity& a = pe[i].counters.activity();
+        cout << pe[i].basename() << "\t" << a.cycles << "\t" << a.useful_macs << "\t" << a.forwarded_only << "\t"
+             << a.idle << "\t" << a.tag_flushes << "\t" << a.gated_macs << "\t"
+             << (a.cycles ? double(a.useful_macs) / a.cycles : 0) << endl;
+        total.cycles += a.cycles;
+        total.useful_macs += a.useful_macs;
+        total.forwarded_only += a.forwarded_only;
+        total.idle += a.idle;
+        total.tag_flushes += a.tag_flushes;
+        total.gated_macs += a.gated_macs;
+    }
+    cout << "Total\t" << total.cycles << "\t" << total.useful_macs << "\t" << total.forwarded_only << "\t"
+         << total.idle << "\t" << total.tag_flushes << "\t" << total.gated_macs << "\t"
+         << (total.cycles ? double(total.useful_macs) / total.cycles : 0) << endl;
+#else
+    (void)array;
+    (void)pe;
+#endif
+}
+
+#endif
@@ -0,0 +1,121 @@
+#ifndef PE_TYPES_H
+#define PE_TYPES_H
+
+#include <systemc.h>
+#include <cstdint>
+#include <iostream>
+#include <type_traits>
+
+// Data types of one array: x samples, weights, and the partial sums / accumulators
+// (y_in, y_out and the PE registers holding x * w and running sums). Every PE and
+// SystolicArray<D, N, T> takes one of these; the default is all int, as before.
+// acc_t must hold data_t * weight_t.
+template <class Data, class Weight, class Acc>
+struct PeTypes {
+    typedef Data data_t;
+    typedef Weight weight_t;
+    typedef Acc acc_t;
+};
+
+typedef PeTypes<int, int, int> IntTypes;
+typedef PeTypes<int16_t, int16_t, int32_t> Int16Types;
+typedef PeTypes<int8_t, int8_t, int32_t> Int8Types;
+typedef PeTypes<int8_t, int8_t, int16_t> Int8Acc16Types;    // Narrow accumulator, overflows on long kernels
+typedef PeTypes<sc_int<8>, sc_int<8>, sc_int<32> > ScInt8Types;
+#ifdef SC_INCLUDE_FX
+// Q8.8 samples and weights, Q16.16 accumulator; needs SC_INCLUDE_FX before systemc.h
+typedef PeTypes<sc_fixed<16, 8>, sc_fixed<16, 8>, sc_fixed<32, 16> > FixedTypes;
+#endif
+
+// Integer value of a port value, for checkers and traces that work on int.
+// Fixed-point values are truncated.
+template <class V>
+inline int as_int(const V& v) {
+    return static_cast<int>(v);
+}
+
+// x * w in the accumulator type, the multiplier of every PE. With -DZERO_GATING a
+// zero operand bypasses it, as a zero-skip path that gates the multiplier would;
+// the product is 0 either way, and PeCounters counts the bypassed multiplies.
+template <class Acc, class X, class W>
+inline Acc pe_multiply(const X& x, const W& w) {
+#ifdef ZERO_GATING
+    if (x == 0 || w == 0)
+        return Acc(0);
+#endif
+    return Acc(x * w);
+}
+
+// a + b in a built-in integer accumulator. A signed overflow is undefined in C++, so
+// the sum is formed with __builtin_add_overflow, which wraps like the hardware adder;
+// `overflow` says whether it wrapped.
+template <class Acc>
+inline Acc acc_add(const Acc& a, const Acc& b, bool& overflow, std::true_type) {
+    Acc sum;
+    overflow = __builtin_add_overflow(a, b, &sum);
+    return sum;
+}
+
+// a + b in sc_int, sc_fixed and the like, which define what an overflow does. Only
+// with -DACC_OVERFLOW is the sum also formed in double; one that differs from it
+// wrapped, or for sc_fixed saturated or lost bits.
+template <class Acc>
+inline Acc acc_add(const Acc& a, const Acc& b, bool& overflow, std::false_type) {
+    Acc sum = a + b;
+#ifdef ACC_OVERFLOW
+    overflow = static_cast<double>(sum) != static_cast<double>(a) + static_cast<double>(b);
+#else
+    overflow = false;
+#endif
+    return sum;
+}
+
+// Accumulations done by one PE (or adder) and how many of them acc_t could not
+// hold. Opt-in like PeCounters: build with -DACC_OVERFLOW to count them; without it
+// add() is the bare sum and both counts stay 0.
+class AccStats {
+public:
+    AccStats() : ops(0), overflow_count(0) {}
+
+    // a + b in the accumulator type
+    template <class Acc>
+    Acc add(const Acc& a, const Acc& b) {
+        bool overflow;
+        Acc sum = acc_add(a, b, overflow, std::is_integral<Acc>());
+#ifdef ACC_OVERFLOW
+        ops++;
+        overflow_count += overflow;
+#endif
+        return sum;
+    }
+
+    void merge(const AccStats& other) {
+        ops += other.ops;
+        overflow_count += other.overflow_count;
+    }
+
+    uint64_t accumulations() const { return ops; }
+    uint64_t overflows() const { return overflow_count; }
+
+private:
+    uint64_t ops;
+    uint64_t overflow_count;
+};
+
+// Sum of the acc_stats members of an array's PEs
+template <class PE>
+inline AccStats total_acc_stats(const sc_vector<PE>& pe) {
+    AccStats total;
+    for (size_t i = 0; i < pe.size(); i++)
+        total.merge(pe[i].acc_stats);
+    return total;
+}
+
+// One line at sc_stop() if any accumulator of the array overflowed, nothing otherwise
+inline void report_acc_overflows(const char* array, const AccStats& stats) {
+    if (stats.overflows())
+        std::cout << array << ": " << stats.overflows() << " of " << stats.accumulations()
+                  << " accumulations overflowed the accumulator type" << std::endl;
+}
+
+#endif
@@ -0,0 +1,270 @@
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+#include "cycle.h"
+#include "design.h"
+#include "fast_model.h"
+
+// Automatic input choreography for one convolution job: the x/w/tag values and the
+// stall cycles to drive, cycle by cycle, so that every full window of the input,
+// y_i = w1 * x[i-N+1] + ... + wN * x[i] for i = N-1 .. L-1, comes out of the array,
+// and the cycle each result is on y_out. R1 and R2 take the kernel from the stream:
+// every sample slot carries one weight on w_in, the weights repeat every N slots and
+// tag_in marks the first of them, which flushes the window a PE has summed. The
+// other designs hold the kernel in their PEs (B2 in its weight ring, with the tag
+// circling along) and only take x.
+//
+// The scheduler derives the slot layout from the dataflow rather than from a table:
+// it builds every candidate layout (cycles per sample, weight order and alignment,
+// the cycle of the slot w/tag go on, weight-only slots ahead of x1), runs each on a
+// random probe through the cycle-accurate FastModel, and keeps the one that delivers
+// every window with the fewest stall cycles. R1 counter-flows w against x and ends up
+// with a sample every other cycle, with an even N its w/tag on the cycle after x;
+// R2's 2-deep w_reg lets x catch up with the weights, so it takes one every cycle;
+// B2's ring fixes when each PE's tag comes round, which sets when each result appears.
+struct ScheduleShape {
+    int spacing;            // Input cycles per sample slot, the other cycles stall
+    int lead;               // Weight-only slots ahead of x1 (R1, R2)
+    int first_weight;       // Kernel index (0 = w1) on the slot of x1 (R1, R2)
+    int weight_step;        // +1: the slots carry w1, w2, ..., wN in turn, -1: wN, ..., w1
+    int weight_delay;       // Cycle of the slot w/tag are driven on, 0 = with x (R1, R2)
+    uint64_t skip_valid;    // Results flagged by y_valid before the first full window (R1, R2)
+    int latency;            // Cycles from a window's newest sample to its result (other designs)
+    uint64_t drain;         // Cycles from the last sample to the last result
+
+    // Cycles around the samples that carry none: lead slots and drain
+    uint64_t overhead() const { return uint64_t(lead) * spacing + drain; }
+};
+
+// Kernel index (0 = w1) on w_in at slot j, the slot of x[j] for j >= 0
+inline int slot_weight(const ScheduleShape& shape, int n, long long j) {
+    return int(((shape.first_weight + shape.weight_step * j) % n + n) % n);
+}
+
+// True for the designs whose kernel comes in on w_in/tag_in with the samples
+inline bool streams_weights(Design d) {
+    return d == Design::R1 || d == Design::R2;
+}
+
+// Full windows of x under `kernel`, in the golden model's convention
+inline std::vector<int> convolve_full(const std::vector<int>& kernel, const std::vector<int>& x) {
+    size_t n = kernel.size();
+    std::vector<int> y;
+    for (size_t i = n - 1; i < x.size(); i++) {
+        long long sum = 0;
+        for (size_t k = 0; k < n; k++)
+            sum += (long long)kernel[k] * x[i - n + 1 + k];
+        y.push_back(int(sum));
+    }
+    return y;
+}
+
+// y_valid of the output logic after the last step; designs without one show a
+// result on every cycle
+template <class Model>
+inline bool output_valid(const Model&) { return true; }
+inline bool output_valid(const FastModel<Design::R1>& m) { return m.reg_valid[m.n - 1] != 0; }
+inline bool output_valid(const FastModel<Design::R2>& m) { return m.reg_valid[m.n - 1] != 0; }
+
+// One convolution job laid out cycle by cycle. Cycle 0 resets the array; y_out after
+// the rising edge of cycle result_cycles[m] holds expected[m], the result of window
+// i = N-1+m.
+struct Schedule {
+    Design design;
+    std::vector<int> kernel;
+    std::vector<int> x;
+    ScheduleShape shape;
+    std::vector<CycleIn> cycles;
+    std::vector<uint64_t> result_cycles;
+    std::vector<int> expected;
+
+    int taps() const { return int(kernel.size()); }
+
+    // Input cycle of slot j (j < 0 for lead slots), of sample x[j] for 0 <= j < L
+    uint64_t slot_cycle(long long j) const { return 1 + uint64_t(j + shape.lead) * shape.spacing; }
+
+    // Cycles after reset on which no sample is driven
+    uint64_t stalls() const { return cycles.size() - 1 - x.size(); }
+
+    // Results per cycle over the whole job, reset included, and once the stream is running
+    double throughput() const { return cycles.empty() ? 0 : double(expected.size()) / cycles.size(); }
+    double steady_throughput() const { return 1.0 / shape.spacing; }
+
+    // "Send x3, w1, tag" or "Stall, w2", like the comments of the hand-written testbench schedules
+    std::string describe(uint64_t c) const {
+        if (cycles[c].rst)
+            return "Reset";
+        int phase = int((c - 1) % shape.spacing);
+        long long j = (long long)((c - 1) / shape.spacing) - shape.lead;
+        std::string s = phase == 0 && j >= 0 && j < (long long)x.size() ? "Send x" + std::to_string(j + 1) : "Stall";
+        if (streams_weights(design) && phase == shape.weight_delay)
+            s += ", w" + std::to_string(slot_weight(shape, taps(), j) + 1);
+        if (cycles[c].tag)
+            s += ", tag";
+        return s;
+    }
+};
+
+// Inputs of x under `shape`, `length` cycles long: reset, then a slot every `spacing`
+// cycles from `lead` slots before x1 on, x on the slot's first cycle and w/tag
+// weight_delay cycles later. R1/R2 slots keep carrying weights after the last sample,
+// with x zero, so the last windows are flushed by their tags.
+inline std::vector<CycleIn> schedule_cycles(Design d, const std::vector<int>& kernel, const std::vector<int>& x,
+                                            const ScheduleShape& shape, uint64_t length) {
+    int n = int(kernel.size());
+    CycleIn idle = { false, 0, 0, 0, false };
+    std::vector<CycleIn> in(length, idle);
+    in[0].rst = true;
+    for (uint64_t c = 1; c < length; c += shape.spacing) {
+        long long j = (long long)((c - 1) / shape.spacing) - shape.lead;
+        if (j >= 0 && j < (long long)x.size())
+            in[c].x = x[j];
+        uint64_t cw = c + shape.weight_delay;
+        if (streams_weights(d) && cw < length) {
+            int k = slot_weight(shape, n, j);
+            in[cw].w = kernel[k];
+            in[cw].tag = k == (shape.weight_step > 0 ? 0 : n - 1);
+        }
+    }
+    return in;
+}
+
+// y_out after every cycle and the cycles whose y_valid was set
+template <Design D>
+inline void run_schedule(const std::vector<int>& kernel, const std::vector<CycleIn>& in, std::vector<int>& y,
+                         std::vector<uint64_t>& valid) {
+    FastModel<D> model(int(kernel.size()), kernel);
+    y.resize(in.size());
+    valid.clear();
+    for (size_t c = 0; c < in.size(); c++) {
+        y[c] = model.step(in[c]).y;
+        if (!in[c].rst && output_valid(model))
+            valid.push_back(c);
+    }
+}
+
+// Fills in skip_valid, latency and drain if `shape` delivers every window of x
+template <Design D>
+inline bool fit_shape(const std::vector<int>& kernel, const std::vector<int>& x, ScheduleShape& shape) {
+    int n = int(kernel.size());
+    std::vector<int> expected = convolve_full(kernel, x);
+    uint64_t last = 1 + uint64_t(x.size() - 1 + shape.lead) * shape.spacing;
+    uint64_t limit = 4 * uint64_t(n + 2) * shape.spacing + 8;   // Longest drain looked for
+    std::vector<CycleIn> in = schedule_cycles(D, kernel, x, shape, last + limit + 1);
+    std::vector<int> y;
+    std::vector<uint64_t> valid;
+    run_schedule<D>(kernel, in, y, valid);
+
+    if (streams_weights(D)) {
+        for (size_t p = 0; p + expected.size() <= valid.size(); p++) {
+            size_t m = 0;
+            while (m < expected.size() && y[valid[p + m]] == expected[m])
+                m++;
+            if (m == expected.size()) {
+                shape.skip_valid = p;
+                shape.latency = 0;
+                shape.drain = valid[p + m - 1] - last;
+                return true;
+            }
+        }
+        return false;
+    }
+    for (uint64_t latency = 0; latency < limit; latency++) {
+        size_t m = 0;
+        while (m < expected.size() && y[1 + (n - 1 + m) * shape.spacing + latency] == expected[m])
+            m++;
+        if (m == expected.size()) {
+            shape.skip_valid = 0;
+            shape.latency = int(latency);
+            shape.drain = latency;
+            return true;
+        }
+    }
+    return false;
+}
+
+// The layout with the fewest stall cycles for a job of `samples` samples: the
+// smallest spacing any layout works with, then the least lead and drain, then w/tag
+// as early in the slot as works. Weight-only
+// lead slots are only tried if no layout works without them. Each candidate is run
+// on a random probe instead of the job itself; the dataflow does not depend on the
+// data, only the drain depends on where the last sample falls in the weight period,
+// so a probe of 2N to 3N samples with the job's length modulo N settles the layout.
+template <Design D>
+inline bool find_shape(const std::vector<int>& kernel, uint64_t samples, ScheduleShape& best, unsigned seed = 1) {
+    int n = int(kernel.size());
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> value(-100, 100);
+    std::vector<int> probe(samples < uint64_t(3 * n) ? samples : 2 * n + samples % n);
+    for (size_t i = 0; i < probe.size(); i++)
+        probe[i] = value(rng);
+
+    bool weights = streams_weights(D);
+    const int max_spacing = 4;
+    for (int spacing = 1; spacing <= max_spacing; spacing++) {
+        bool found = false;
+        for (int lead = 0; lead < (weights ? n : 1) && !found; lead++) {
+            for (int delay = 0; delay < (weights ? spacing : 1); delay++) {
+                for (int step = 1; step >= (weights ? -1 : 1); step -= 2) {
+                    for (int first = 0; first < (weights ? n : 1); first++) {
+                        ScheduleShape s = { spacing, lead, first, step, delay, 0, 0, 0 };
+                        if (fit_shape<D>(kernel, probe, s) && (!found || s.overhead() < best.overhead())) {
+                            best = s;
+                            found = true;
+                        }
+                    }
+                }
+            }
+        }
+        if (found)
+            return true;
+    }
+    return false;
+}
+
+// Schedule of x through design D with `kernel`, false if x is shorter than the
+// kernel or no layout works. The result cycles are checked once more on x itself.
+template <Design D>
+inline bool make_schedule(const std::vector<int>& kernel, const std::vector<int>& x, Schedule& s) {
+    int n = int(kernel.size());
+    if (n < 1 || x.size() < size_t(n) || !find_shape<D>(kernel, x.size(), s.shape))
+        return false;
+    s.design = D;
+    s.kernel = kernel;
+    s.x = x;
+    s.expected = convolve_full(kernel, x);
+    uint64_t last = s.slot_cycle((long long)x.size() - 1);
+    s.cycles = schedule_cycles(D, kernel, x, s.shape, last + s.shape.drain + 1);
+
+    std::vector<int> y;
+    std::vector<uint64_t> valid;
+    run_schedule<D>(kernel, s.cycles, y, valid);
+    s.result_cycles.clear();
+    for (size_t m = 0; m < s.expected.size(); m++) {
+        uint64_t c = streams_weights(D) ? (s.shape.skip_valid + m < valid.size() ? valid[s.shape.skip_valid + m] : 0)
+                                        : s.slot_cycle((long long)(n - 1 + m)) + s.shape.latency;
+        if (c == 0 || c >= y.size() || y[c] != s.expected[m])
+            return false;
+        s.result_cycles.push_back(c);
+    }
+    return true;
+}
+
+inline bool make_schedule(Design d, const std::vector<int>& kernel, const std::vector<int>& x, Schedule& s) {
+    switch (d) {
+    case Design::B1: return make_schedule<Design::B1>(kernel, x, s);
+    case Design::B2: return make_schedule<Design::B2>(kernel, x, s);
+    case Design::F:  return make_schedule<Design::F>(kernel, x, s);
+    case Design::R1: return make_schedule<Design::R1>(kernel, x, s);
+    case Design::R2: return make_schedule<Design::R2>(kernel, x, s);
+    case Design::W1: return make_schedule<Design::W1>(kernel, x, s);
+    case Design::W2: return make_schedule<Design::W2>(kernel, x, s);
+    }
+    return false;
+}
+
+#endif
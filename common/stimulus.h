@@ -0,0 +1,25 @@
+#ifndef STIMULUS_H
+#define STIMULUS_H
+
+#include <cstddef>
+#include <random>
+#include <vector>
+#include "cycle.h"
+
+// Random inputs with small values so products never overflow, plus the odd reset
+inline std::vector<CycleIn> random_stream(size_t cycles, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> value(-8, 8);
+    std::uniform_int_distribution<int> percent(0, 999);
+    std::vector<CycleIn> in(cycles);
+    for (size_t c = 0; c < cycles; c++) {
+        in[c].rst = c < 2 || percent(rng) == 0;
+        in[c].x = value(rng);
+        in[c].y = value(rng);
+        in[c].w = value(rng);
+        in[c].tag = percent(rng) < 250;
+    }
+    return in;
+}
+
+#endif
@@ -0,0 +1,297 @@
+#ifndef STIMULUS_FILE_H
+#define STIMULUS_FILE_H
+
+#include <systemc.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <random>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#include "cycle.h"
+#include "design.h"
+#include "pe_types.h"
+
+// Binary stimulus file: one header, then one record per sample, host byte order.
+// A sample is what the testbench drives on one input cycle.
+struct StimulusHeader {
+    char magic[8];          // "SASTIM1\0"
+    uint32_t record_size;   // sizeof(StimulusRecord)
+    uint32_t taps;          // Kernel length the w/tag stream was written for, 0 if none
+    uint64_t samples;
+};
+
+struct StimulusRecord {
+    int32_t x;
+    int32_t w;
+    uint8_t tag;
+    uint8_t reserved[3];
+};
+
+static const char STIMULUS_MAGIC[8] = { 'S', 'A', 'S', 'T', 'I', 'M', '1', 0 };
+
+// Read-only memory map of a stimulus file. The kernel pages records in as the
+// simulation walks through them, so file size is not limited by RAM.
+class StimulusFile {
+public:
+    StimulusFile() : base(0), length(0), records(0), count(0), kernel_taps(0) {}
+    ~StimulusFile() { close(); }
+
+    // Map the file, false with error() set if it is missing or malformed
+    bool open(const char* path) {
+        close();
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0)
+            return fail(std::string("cannot open ") + path);
+        struct stat st;
+        if (fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(StimulusHeader)) {
+            ::close(fd);
+            return fail(std::string(path) + " is too short for a stimulus header");
+        }
+        length = st.st_size;
+        base = mmap(0, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (base == MAP_FAILED) {
+            base = 0;
+            return fail(std::string("cannot map ") + path);
+        }
+
+        const StimulusHeader* h = static_cast<const StimulusHeader*>(base);
+        if (std::memcmp(h->magic, STIMULUS_MAGIC, sizeof(STIMULUS_MAGIC)) != 0 ||
+            h->record_size != sizeof(StimulusRecord))
+            return fail(std::string(path) + " is not a stimulus file");
+        if (h->samples > (length - sizeof(StimulusHeader)) / sizeof(StimulusRecord))
+            return fail(std::string(path) + " is truncated");
+
+        records = reinterpret_cast<const StimulusRecord*>(h + 1);
+        count = h->samples;
+        kernel_taps = h->taps;
+        madvise(base, length, MADV_SEQUENTIAL);
+        return true;
+    }
+
+    void close() {
+        if (base)
+            munmap(base, length);
+        base = 0;
+        length = 0;
+        records = 0;
+        count = 0;
+        kernel_taps = 0;
+    }
+
+    uint64_t size() const { return count; }
+    uint32_t taps() const { return kernel_taps; }
+    const StimulusRecord* data() const { return records; }
+    const StimulusRecord& operator[](uint64_t i) const { return records[i]; }
+    const std::string& error() const { return message; }
+
+private:
+    StimulusFile(const StimulusFile&);
+    StimulusFile& operator=(const StimulusFile&);
+
+    bool fail(const std::string& what) {
+        close();
+        message = what;
+        return false;
+    }
+
+    void* base;
+    size_t length;
+    const StimulusRecord* records;
+    uint64_t count;
+    uint32_t kernel_taps;
+    std::string message;
+};
+
+// Random samples first..first+count-1 of a stream: x uniform in [-range, range], and
+// w/tag cycling through the kernel 1..taps with tag set on w1, the order R1/R2 load
+// weights in
+class RandomSamples {
+public:
+    RandomSamples(unsigned seed, int taps, int range)
+        : rng(seed), value(-range, range), kernel(default_weights(taps)), next(0) {}
+
+    void fill(StimulusRecord* r, size_t count) {
+        for (size_t i = 0; i < count; i++, next++) {
+            int k = int(next % kernel.size());
+            r[i].x = value(rng);
+            r[i].w = kernel[k];
+            r[i].tag = k == 0;
+            r[i].reserved[0] = r[i].reserved[1] = r[i].reserved[2] = 0;
+        }
+    }
+
+private:
+    std::mt19937 rng;
+    std::uniform_int_distribution<int> value;
+    std::vector<int> kernel;
+    uint64_t next;
+};
+
+// In-memory random stream, for runs short enough not to need a file
+inline std::vector<StimulusRecord> random_samples(size_t count, unsigned seed, int taps, int range = 8) {
+    std::vector<StimulusRecord> samples(count);
+    RandomSamples(seed, taps, range).fill(samples.data(), count);
+    return samples;
+}
+
+// Write a random stimulus file with the samples of RandomSamples.
+// Writes in blocks so 10^8-sample files need no more than a few MB of memory.
+inline bool write_random_stimulus(const char* path, uint64_t samples, unsigned seed, int taps, int range,
+                                  std::string& error) {
+    FILE* f = std::fopen(path, "wb");
+    if (!f) {
+        error = std::string("cannot create ") + path;
+        return false;
+    }
+    StimulusHeader h;
+    std::memcpy(h.magic, STIMULUS_MAGIC, sizeof(STIMULUS_MAGIC));
+    h.record_size = sizeof(StimulusRecord);
+    h.taps = taps;
+    h.samples = samples;
+    bool ok = std::fwrite(&h, sizeof(h), 1, f) == 1;
+
+    RandomSamples random(seed, taps, range);
+    std::vector<StimulusRecord> block(1 << 16);
+    for (uint64_t done = 0; ok && done < samples;) {
+        size_t n = size_t(std::min<uint64_t>(block.size(), samples - done));
+        random.fill(block.data(), n);
+        ok = std::fwrite(block.data(), sizeof(StimulusRecord), n, f) == n;
+        done += n;
+    }
+    if (std::fclose(f) != 0)
+        ok = false;
+    if (!ok)
+        error = std::string("cannot write ") + path;
+    return ok;
+}
+
+// Input cycles per sample: W1 needs a bubble between x samples, and in R1 x and w
+// flow in opposite directions so each sample has to meet every weight
+inline int cycles_per_sample(Design d) {
+    return d == Design::W1 || d == Design::R1 ? 2 : 1;
+}
+
+// Input cycles from a sample's x to its w/tag. PE i of R1 sees x from i cycles ago and
+// w from N-1-i, so they meet on a sample slot only if N-1-2i is a multiple of the
+// spacing: with an even N w/tag go on the bubble cycle after x.
+inline int weight_offset(Design d, int n) {
+    return d == Design::R1 && n % 2 == 0 ? 1 : 0;
+}
+
+// SC_METHOD source that streams samples into an array, one sample every
+// `spacing` cycles with zero inputs in between. Drives reset for the first
+// reset_cycles cycles, then the samples, then zeros for as long as it is clocked.
+// A sample's w/tag go w_offset cycles after its x (< spacing, see weight_offset()).
+// The ports have the data types T of the array it drives.
+template <class T>
+SC_MODULE(BasicStimulusSource) {
+    sc_in<bool> clk;
+    sc_out<bool> rst;
+    sc_out<typename T::data_t> x_in;
+    sc_out<typename T::acc_t> y_in;
+    sc_out<typename T::weight_t> w_in;
+    sc_out<bool> tag_in;
+
+    const StimulusRecord* records;
+    uint64_t count;
+    int spacing;
+    uint64_t reset_cycles;
+    uint64_t offset;    // Bubbles between reset and the first sample
+    int w_offset;       // Cycles from a sample's x to its w/tag
+    uint64_t cycle;     // Input cycles driven so far
+    uint64_t next;      // Next sample to send
+
+    SC_HAS_PROCESS(BasicStimulusSource);
+    BasicStimulusSource(sc_module_name name, const StimulusRecord* records, uint64_t count, int spacing,
+                   uint64_t reset_cycles = 1, uint64_t offset = 0, int w_offset = 0)
+        : sc_module(name), records(records), count(count), spacing(spacing), reset_cycles(reset_cycles),
+          offset(offset), w_offset(w_offset), cycle(0), next(0) {
+        // Inputs change on the falling edge, the array samples them on the rising edge
+        SC_METHOD(drive);
+        sensitive << clk.neg();
+    }
+
+    // True once every sample has been driven
+    bool finished() const { return next == count; }
+
+    // Input cycle index (0 = first rising edge) that carries sample i
+    uint64_t sample_cycle(uint64_t i) const { return reset_cycles + offset + i * spacing; }
+
+    // True if input cycle `c` carries a sample rather than reset or a bubble
+    bool carries_sample(uint64_t c) const {
+        return c >= reset_cycles + offset && (c - reset_cycles - offset) % spacing == 0 && c < total_cycles();
+    }
+
+    // True if input cycle `c` carries the w/tag of a sample
+    bool carries_weight(uint64_t c) const {
+        return c >= uint64_t(w_offset) && carries_sample(c - w_offset);
+    }
+
+    // Input cycles needed to drive the reset and every sample
+    uint64_t total_cycles() const { return reset_cycles + offset + count * spacing; }
+
+    // True if input cycle `c` drives reset low and every input zero
+    bool idle_cycle(uint64_t c) const {
+        if (c < reset_cycles)
+            return false;
+        if (carries_sample(c) && records[(c - reset_cycles - offset) / spacing].x != 0)
+            return false;
+        if (carries_weight(c)) {
+            const StimulusRecord& r = records[(c - w_offset - reset_cycles - offset) / spacing];
+            return r.w == 0 && r.tag == 0;
+        }
+        return true;
+    }
+
+    // Idle input cycles in a row from cycle `c` on, counting at most `limit`
+    uint64_t idle_cycles_from(uint64_t c, uint64_t limit) const {
+        uint64_t k = 0;
+        while (k < limit && idle_cycle(c + k))
+            k++;
+        return k;
+    }
+
+    // Pass over the next k input cycles without driving them, for SkippingClock
+    void skip(uint64_t k) {
+        for (; k > 0; k--, cycle++)
+            if (carries_sample(cycle))
+                next++;
+    }
+
+    // Carry on from a checkpoint taken after `driven_cycles` input cycles and
+    // `driven_samples` samples: the last of those cycles is driven again when the
+    // simulation starts, so the next rising edge samples the same inputs
+    void resume(uint64_t driven_cycles, uint64_t driven_samples) {
+        cycle = driven_cycles - 1;
+        next = driven_samples - (carries_sample(cycle) ? 1 : 0);
+    }
+
+    void drive() {
+        CycleIn in = { cycle < reset_cycles, 0, 0, 0, false };
+        if (carries_sample(cycle))
+            in.x = records[next++].x;
+        if (carries_weight(cycle)) {
+            const StimulusRecord& r = records[(cycle - w_offset - reset_cycles - offset) / spacing];
+            in.w = r.w;
+            in.tag = r.tag != 0;
+        }
+        rst.write(in.rst);
+        x_in.write(in.x);
+        y_in.write(in.y);
+        w_in.write(in.w);
+        tag_in.write(in.tag);
+        cycle++;
+    }
+};
+
+typedef BasicStimulusSource<IntTypes> StimulusSource;
+
+#endif
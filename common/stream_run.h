@@ -0,0 +1,221 @@
+#ifndef STREAM_RUN_H
+#define STREAM_RUN_H
+
+#include <systemc.h>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include "checkpoint.h"
+#include "energy.h"
+#include "golden_checker.h"
+#include "harness.h"
+#include "idle_skip.h"
+#include "stimulus_file.h"
+#include "trace.h"
+
+// Checks y_out against the golden model at every rising edge and stops once the
+// pipeline has drained. With verbose set it also prints a Time/x_in/y_out line for
+// every edge. Edges a SkippingClock swallows are passed to skip().
+template <class T>
+SC_MODULE(BasicStreamMonitor) {
+    sc_in<bool> clk;
+    sc_in<typename T::data_t> x_in;
+    sc_in<typename T::weight_t> w_in;
+    sc_in<typename T::acc_t> y_out;
+
+    const BasicStimulusSource<T>& source;
+    GoldenChecker& checker;
+    uint64_t stop_after;  // Rising edges to run for
+    bool verbose;
+    uint64_t edges;
+    uint64_t hash;        // FNV-1a of y_out after every edge, equal for cycle-identical runs
+
+    SC_HAS_PROCESS(BasicStreamMonitor);
+    BasicStreamMonitor(sc_module_name name, const BasicStimulusSource<T>& source, GoldenChecker& checker, uint64_t stop_after,
+                  bool verbose)
+        : sc_module(name), source(source), checker(checker), stop_after(stop_after), verbose(verbose), edges(0),
+          hash(14695981039346656037ull) {
+        SC_METHOD(monitor);
+        sensitive << clk.pos();
+        dont_initialize();
+    }
+
+    void start_of_simulation() {
+        if (verbose)
+            cout << "Time\tx_in\ty_out" << endl;
+    }
+
+    // y_out now is the result of the previous edge, x_in is sampled by this one
+    void monitor() {
+        if (verbose)
+            cout << sc_time_stamp() << "\t" << x_in.read() << "\t" << y_out.read() << endl;
+        if (edges > 0)
+            output(edges - 1, as_int(y_out.read()));
+        if (source.carries_sample(edges))
+            checker.sample(edges, as_int(x_in.read()), as_int(w_in.read()));
+        if (++edges == stop_after)
+            sc_stop();
+    }
+
+    // k rising edges that did not happen: the inputs and y_out held their values
+    void skip(uint64_t k) {
+        int y = as_int(y_out.read());
+        for (; k > 0; k--, edges++) {
+            if (edges > 0)
+                output(edges - 1, y);
+            if (source.carries_sample(edges))
+                checker.sample(edges, as_int(x_in.read()), as_int(w_in.read()));
+        }
+    }
+
+    void output(uint64_t cycle, int y) {
+        checker.output(cycle, y);
+        hash = (hash ^ uint32_t(y)) * 1099511628211ull;
+    }
+};
+
+typedef BasicStreamMonitor<IntTypes> StreamMonitor;
+
+// What one streamed run measured
+struct StreamStats {
+    uint64_t samples;
+    uint64_t cycles;            // Rising edges simulated, including reset and drain
+    double seconds;             // Wall time inside sc_start()
+    AccStats accumulators;      // Accumulations of the array and how many overflowed acc_t
+    uint64_t skipped;           // Idle rising edges skipped, see common/idle_skip.h
+    uint64_t output_hash;       // Of y_out after every edge, skipped ones included
+    EnergyCounts energy;        // PE operations for common/energy.h, only with -DPE_COUNTERS
+};
+
+// Elaborate SystolicArray<D, N, T> with a StimulusSource and a checking monitor,
+// and stream the samples through it. Only callable once per process. The top-level
+// signals are traced as configured; in ring mode each checker mismatch dumps a window.
+// With skip_idle a SkippingClock drives the array and skips the rising edges on which
+// it is quiescent and its inputs are zero; traces leave those edges out. `checkpoints`
+// takes snapshots along the way or resumes from one (common/checkpoint.h); a resumed
+// run takes the same samples and a checker constructed like the original one.
+template <Design D, int N, class T = IntTypes>
+inline StreamStats run_stream(const StimulusRecord* samples, uint64_t count, GoldenChecker& checker,
+                              bool verbose = false, const TraceConfig& trace = TraceConfig(),
+                              bool skip_idle = false, const CheckpointPlan& checkpoints = CheckpointPlan()) {
+    const Checkpoint* resume = checkpoints.resume;
+    sc_time first_edge = Checkpoint::edge_time(resume ? resume->edges : 0);
+    std::unique_ptr<sc_clock> free_running;
+    std::unique_ptr<SkippingClock> skipping;
+    if (skip_idle)
+        skipping.reset(new SkippingClock("skipping_clock", idle_period(D, N), sc_time(10, SC_NS), first_edge));
+    else
+        free_running.reset(new sc_clock("clk", sc_time(10, SC_NS), 0.5, first_edge, true));
+    sc_signal_in_if<bool>& clk = skip_idle ? static_cast<sc_signal_in_if<bool>&>(skipping->clk) : *free_running;
+    BasicInputSignals<T> in;
+    BasicOutputSignals<T> out;
+    SystolicArray<D, N, T> array("array");
+    BasicStimulusSource<T> source("source", samples, count, cycles_per_sample(D), 1, 0, weight_offset(D, N));
+    // Run past the last sample long enough for any design to drain
+    BasicStreamMonitor<T> monitor("monitor", source, checker, source.total_cycles() + 2 * N + 8, verbose);
+
+    bind(array, clk, in, out);
+    source.clk(clk);
+    source.rst(in.rst);
+    source.x_in(in.x_in);
+    source.y_in(in.y_in);
+    source.w_in(in.w_in);
+    source.tag_in(in.tag_in);
+    monitor.clk(clk);
+    monitor.x_in(in.x_in);
+    monitor.w_in(in.w_in);
+    monitor.y_out(out.y_out);
+
+    SignalTracer tracer("tracer", trace);
+    tracer.clk(clk);
+    tracer.add("rst", in.rst);
+    tracer.add("x_in", in.x_in);
+    tracer.add("y_in", in.y_in);
+    tracer.add("w_in", in.w_in);
+    tracer.add("tag_in", in.tag_in);
+    tracer.add("x_out", out.x_out);
+    tracer.add("y_out", out.y_out);
+    tracer.add("w_out", out.w_out);
+    tracer.add("tag_out", out.tag_out);
+    checker.on_mismatch([&tracer](uint64_t cycle) { tracer.trigger(cycle); });
+
+    if (skip_idle) {
+        // Edge `monitor.edges` comes next and takes the inputs of input cycle source.cycle - 1
+        skipping->idle_edges = [&]() -> uint64_t {
+            if (!array.quiescent() || !source.idle_cycle(source.cycle - 1))
+                return 0;
+            return 1 + source.idle_cycles_from(source.cycle, monitor.stop_after - monitor.edges - 1);
+        };
+        skipping->skip = [&](uint64_t k) {
+            source.skip(k);
+            monitor.skip(k);
+        };
+    }
+
+    // Snapshots are taken and loaded from here between two sc_start() calls, half a
+    // clock low phase before a rising edge, when the falling edge has settled
+    CheckpointSignals<T> signals;
+    if (checkpoints.every || resume) {
+        std::vector<sc_object*> top = sc_get_top_level_objects();
+        for (size_t i = 0; i < top.size(); i++)
+            signals.add(*top[i]);
+    }
+    auto snapshot = [&]() {
+        Checkpoint cp;
+        cp.design = D;
+        cp.taps = N;
+        cp.edges = monitor.edges;
+        cp.source_cycle = source.cycle;
+        cp.source_next = source.next;
+        cp.output_hash = monitor.hash;
+        CheckpointArchive checker_state(cp.checker, false), registers(cp.registers, false),
+            signal_values(cp.signals, false);
+        checker.checkpoint(checker_state);
+        array.checkpoint(registers);
+        signals.archive(signal_values);
+        return cp;
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    if (resume) {
+        // The source drives the inputs of the resumed edge again, then everything
+        // settles and the saved state is loaded over it
+        source.resume(resume->source_cycle, resume->source_next);
+        monitor.edges = resume->edges;
+        monitor.hash = resume->output_hash;
+        sc_start(first_edge / 2);
+        std::vector<double> checker_values = resume->checker, register_values = resume->registers,
+                            signal_values = resume->signals;
+        CheckpointArchive checker_state(checker_values, true), registers(register_values, true),
+            signal_state(signal_values, true);
+        checker.checkpoint(checker_state);
+        array.checkpoint(registers);
+        signals.archive(signal_state);
+        if (resume->design != D || resume->taps != N || !checker_state.complete() || !registers.complete() ||
+            !signal_state.complete()) {
+            cout << "Checkpoint of " << design_name(resume->design) << "x" << resume->taps << " does not fit "
+                 << design_name(D) << "x" << N << endl;
+            sc_stop();
+        }
+    }
+    while (checkpoints.every && sc_get_status() != SC_STOPPED) {
+        uint64_t edge = (monitor.edges / checkpoints.every + 1) * checkpoints.every;
+        sc_start(Checkpoint::edge_time(edge) - sc_time(2.5, SC_NS) - sc_time_stamp());
+        if (sc_get_status() != SC_STOPPED)
+            checkpoints.saved(snapshot());
+    }
+    if (sc_get_status() != SC_STOPPED)
+        sc_start();
+    StreamStats stats;
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    stats.samples = count;
+    stats.cycles = monitor.edges;
+    stats.accumulators = array.accumulator_stats();
+    stats.skipped = skipping ? skipping->skipped : 0;
+    stats.output_hash = monitor.hash;
+    stats.energy = energy_counts(array.pe);
+    checker.on_mismatch(nullptr);
+    return stats;
+}
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef SYSTOLIC_ARRAY_H
+#define SYSTOLIC_ARRAY_H
+
+#include <systemc.h>
+#include <string>
+#include <vector>
+#include "design.h"
+#include "pe_counters.h"
+#include "pe_types.h"
+
+// Top-level systolic array with N processing elements and the data types T
+// (common/pe_types.h). Each design specialises this template in its own design.cpp.
+template <Design D, int N, class T = IntTypes>
+struct SystolicArray;
+
+// sc_vector creator that keeps the PE1, PE2, ... names of the 3-tap builds
+template <class T>
+struct NumberedCreator {
+    const char* prefix;
+
+    T* operator()(const char*, size_t i) const {
+        return new T((std::string(prefix) + std::to_string(i + 1)).c_str());
+    }
+};
+
+template <class T>
+inline NumberedCreator<T> numbered(const char* prefix) {
+    NumberedCreator<T> creator = { prefix };
+    return creator;
+}
+
+// Output gate of a strided convolution in a PE. Of the edges after reset, numbered
+// from 0, the PE's product only feeds a kept result on edges c with
+// (c - first) % stride == 0; on the others it skips the multiply. The phase counter
+// is a PE register, reset with the others; with stride 1 every edge is kept and the
+// counter never moves.
+struct StrideGate {
+    int stride;
+    int start;      // Phase after reset, (-first) mod stride
+    int phase;      // (c - first) mod stride for the coming edge c
+
+    StrideGate() : stride(1), start(0), phase(0) {}
+
+    void set(int s, int first) {
+        stride = s < 1 ? 1 : s;
+        start = ((-first) % stride + stride) % stride;
+        phase = start;
+    }
+
+    void reset() { phase = start; }
+
+    // True if this edge's product is kept; moves on to the next edge
+    bool next() {
+        bool keep = phase == 0;
+        phase = phase + 1 == stride ? 0 : phase + 1;
+        return keep;
+    }
+
+    // The counter stands still, so idle edges may be skipped (common/idle_skip.h)
+    bool still() const { return stride == 1; }
+};
+
+// True if every PE of the array is quiescent()
+template <class PE>
+inline bool all_quiescent(const sc_vector<PE>& pe) {
+    for (size_t i = 0; i < pe.size(); i++)
+        if (!pe[i].quiescent())
+            return false;
+    return true;
+}
+
+// Registers of every PE in order, see common/checkpoint.h
+template <class Archive, class PE>
+inline void checkpoint_all(Archive& a, sc_vector<PE>& pe) {
+    for (size_t i = 0; i < pe.size(); i++)
+        pe[i].checkpoint(a);
+}
+
+#endif
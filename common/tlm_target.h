@@ -0,0 +1,134 @@
+#ifndef TLM_TARGET_H
+#define TLM_TARGET_H
+
+#include <systemc.h>
+#include <tlm.h>
+#include <tlm_utils/simple_target_socket.h>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "fast_model.h"
+#include "golden_checker.h"
+#include "stimulus_file.h"
+
+// One whole convolution, handed to an ArrayTarget by a TLM_WRITE_COMMAND whose data
+// pointer is the job and whose data length is sizeof(ConvJob). The buffers stay with
+// the initiator; the target fills y before b_transport returns.
+struct ConvJob {
+    const int* x;           // Input samples
+    uint64_t samples;
+    const int* w;           // Kernel w1..wN, taps must match the array
+    int taps;
+    int* y;                 // samples results, y[i] = w1 * x[i-N+1] + ... + wN * x[i] with zeros before x[0]
+};
+
+// Zero samples an array needs ahead of and behind a job. R1 and R2 load the kernel
+// through w_in alongside the samples, so N-1 samples go by before the first full
+// window, and the last N results wait for tags that come with later samples.
+inline uint64_t job_lead_samples(Design d, int n) {
+    return d == Design::R1 || d == Design::R2 ? n - 1 : 0;
+}
+
+inline uint64_t job_tail_samples(Design d, int n) {
+    return d == Design::R1 || d == Design::R2 ? n : 0;
+}
+
+// Clock cycles an array takes for a job, from its reset cycle to the edge that puts
+// the last result on y_out: the input schedule of StimulusSource plus the output
+// latency of the last sample
+inline uint64_t job_cycles(Design d, int n, uint64_t samples) {
+    if (samples == 0)
+        return 0;
+    uint64_t last = job_lead_samples(d, n) + samples - 1;
+    return 1 + last * cycles_per_sample(d) + output_latency(d, n, last) + 1;
+}
+
+// TLM-2.0 target that runs whole convolution jobs on a SystolicArray<D, N> without
+// driving its pins. b_transport steps the cycle-accurate FastModel<D> through the
+// schedule a pin-level testbench would drive, reads each result on the cycle the
+// golden model says it is due, and annotates the job's duration in clock cycles to
+// the delay instead of waiting, so a loosely-timed initiator with a quantum keeper
+// can run ahead of simulated time. Jobs that overlap in time queue behind each other.
+template <Design D>
+SC_MODULE(ArrayTarget) {
+    tlm_utils::simple_target_socket<ArrayTarget> socket;
+
+    int n;                  // Taps of the modelled array
+    sc_time clock_period;
+    sc_time busy_until;     // End of the last job taken
+    uint64_t jobs;
+    uint64_t cycles;        // Clock cycles of all jobs taken
+
+    SC_HAS_PROCESS(ArrayTarget);
+    ArrayTarget(sc_module_name name, int n, const sc_time& clock_period = sc_time(10, SC_NS))
+        : sc_module(name), socket("socket"), n(n), clock_period(clock_period), busy_until(SC_ZERO_TIME), jobs(0),
+          cycles(0) {
+        socket.register_b_transport(this, &ArrayTarget::b_transport);
+    }
+
+    void b_transport(tlm::tlm_generic_payload& trans, sc_time& delay) {
+        if (trans.get_command() != tlm::TLM_WRITE_COMMAND) {
+            trans.set_response_status(tlm::TLM_COMMAND_ERROR_RESPONSE);
+            return;
+        }
+        if (trans.get_byte_enable_ptr()) {
+            trans.set_response_status(tlm::TLM_BYTE_ENABLE_ERROR_RESPONSE);
+            return;
+        }
+        if (trans.get_data_length() != sizeof(ConvJob) || !trans.get_data_ptr()) {
+            trans.set_response_status(tlm::TLM_BURST_ERROR_RESPONSE);
+            return;
+        }
+        const ConvJob& job = *reinterpret_cast<const ConvJob*>(trans.get_data_ptr());
+        if (job.taps != n || (job.samples && (!job.x || !job.y || !job.w))) {
+            trans.set_response_status(tlm::TLM_GENERIC_ERROR_RESPONSE);
+            return;
+        }
+
+        uint64_t job_length = run(job);
+        sc_time start = std::max(sc_time_stamp() + delay, busy_until);
+        busy_until = start + clock_period * double(job_length);
+        delay = busy_until - sc_time_stamp();
+        jobs++;
+        cycles += job_length;
+        trans.set_dmi_allowed(false);
+        trans.set_response_status(tlm::TLM_OK_RESPONSE);
+    }
+
+    // Fill job.y from the fast model, returns the clock cycles the job took
+    uint64_t run(const ConvJob& job) {
+        std::vector<int> kernel(job.w, job.w + n);
+        FastModel<D> model(n, kernel);
+        uint64_t lead = job_lead_samples(D, n);
+        uint64_t total = lead + job.samples + job_tail_samples(D, n);
+        uint64_t length = job_cycles(D, n, job.samples);
+        int spacing = cycles_per_sample(D);
+        uint64_t w_offset = weight_offset(D, n);
+
+        uint64_t next = 0;  // Next result to read
+        for (uint64_t c = 0; c < length; c++) {
+            CycleIn in = { c < 1, 0, 0, 0, false };
+            uint64_t s = (c - 1) / spacing;
+            if (c >= 1 && (c - 1) % spacing == 0 && s < total)
+                in.x = s >= lead && s < lead + job.samples ? job.x[s - lead] : 0;
+            // w/tag of sample sw, w_offset cycles after its x as StimulusSource drives them
+            uint64_t sw = (c - 1 - w_offset) / spacing;
+            if (c >= 1 + w_offset && (c - 1 - w_offset) % spacing == 0 && sw < total) {
+                in.w = kernel[sw % n];
+                in.tag = sw % n == 0;
+            }
+            CycleOut out = model.step(in);
+            while (next < job.samples && due(next, lead, spacing) == c)
+                job.y[next++] = out.y;
+        }
+        return length;
+    }
+
+    // Cycle whose edge puts the result of job sample i on y_out
+    uint64_t due(uint64_t i, uint64_t lead, int spacing) const {
+        uint64_t s = lead + i;
+        return 1 + s * spacing + output_latency(D, n, s);
+    }
+};
+
+#endif
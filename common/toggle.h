@@ -0,0 +1,123 @@
+#ifndef TOGGLE_H
+#define TOGGLE_H
+
+#include <systemc.h>
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "pe_types.h"
+#include "toggle_count.h"
+
+// Live switching-activity collector. Like SignalTracer it reads its signals once per
+// clock edge, when they hold the values settled since the previous edge, and feeds
+// the changes to a ToggleCounter, so glitches within a delta cycle are not counted.
+//
+// Signals come from add(), or from add_outputs(root): every signal below root that
+// an sc_out or sc_inout port drives, credited to the module of the deepest such port,
+// i.e. the PE or output logic that drives it rather than the array that wires it up.
+// The clock itself is not counted.
+SC_MODULE(ToggleCollector) {
+    sc_in<bool> clk;
+
+    ToggleCounter counter;
+    uint64_t cycles;            // Rising edges seen
+
+    SC_HAS_PROCESS(ToggleCollector);
+    ToggleCollector(sc_module_name name) : sc_module(name), cycles(0), started(false) {
+        SC_METHOD(sample);
+        sensitive << clk;
+        dont_initialize();
+    }
+
+    // Any signal as_int() converts, bool as 1 bit and the rest by its size
+    template <class V>
+    void add(const std::string& name, const std::string& module, const sc_signal_in_if<V>& sig) {
+        counter.add(name, module, std::is_same<V, bool>::value ? 1 : int(8 * sizeof(V)));
+        sources.push_back([&sig]() { return uint32_t(as_int(sig.read())); });
+    }
+
+    // Ports are only bound once elaboration is over, so the outputs are found then
+    void add_outputs(const sc_object& root) { roots.push_back(&root); }
+
+    void start_of_simulation() {
+        std::map<const void*, Driver> drivers;
+        std::vector<const void*> order;
+        for (size_t r = 0; r < roots.size(); r++)
+            find_outputs(*roots[r], drivers, order);
+        for (size_t i = 0; i < order.size(); i++) {
+            const Driver& d = drivers[order[i]];
+            counter.add(d.name, d.module, d.width);
+            sources.push_back(d.read);
+        }
+    }
+
+    // The interval since the last edge has no later edge to close it
+    void end_of_simulation() {
+        if (started)
+            record();
+    }
+
+private:
+    // The port found for one signal so far
+    struct Driver {
+        std::string name, module;
+        int width;
+        size_t depth;
+        std::function<uint32_t()> read;
+    };
+
+    void sample() {
+        if (started)
+            record();
+        started = true;
+        if (clk.read())
+            cycles++;
+    }
+
+    void record() {
+        for (size_t i = 0; i < sources.size(); i++)
+            counter.value(i, sources[i]());
+    }
+
+    void find_outputs(const sc_object& object, std::map<const void*, Driver>& drivers, std::vector<const void*>& order) {
+        if (!(output<bool>(object, drivers, order) || output<int>(object, drivers, order) ||
+              output<int16_t>(object, drivers, order) || output<int8_t>(object, drivers, order))) {
+            const std::vector<sc_object*>& children = object.get_child_objects();
+            for (size_t i = 0; i < children.size(); i++)
+                find_outputs(*children[i], drivers, order);
+        }
+    }
+
+    // Records object if it is an output port of V, keeping the deepest port per signal
+    template <class V>
+    bool output(const sc_object& object, std::map<const void*, Driver>& drivers, std::vector<const void*>& order) {
+        const sc_inout<V>* port = dynamic_cast<const sc_inout<V>*>(&object);
+        if (!port)
+            return false;
+        const sc_signal_inout_if<V>* sig = port->get_interface();
+        if (!sig)
+            return true;
+        std::string module = object.get_parent_object() ? object.get_parent_object()->name() : "top";
+        size_t depth = std::count(module.begin(), module.end(), '.');
+        std::map<const void*, Driver>::iterator it = drivers.find(sig);
+        if (it == drivers.end()) {
+            order.push_back(sig);
+        } else if (it->second.depth >= depth) {
+            return true;
+        }
+        Driver d = { object.name(), module, std::is_same<V, bool>::value ? 1 : int(8 * sizeof(V)), depth,
+                     [sig]() { return uint32_t(as_int(sig->read())); } };
+        drivers[sig] = d;
+        return true;
+    }
+
+    std::vector<const sc_object*> roots;
+    std::vector<std::function<uint32_t()> > sources;
+    bool started;
+};
+
+#endif
@@ -0,0 +1,154 @@
+#ifndef TOGGLE_COUNT_H
+#define TOGGLE_COUNT_H
+
+#include <bitset>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "trace_format.h"
+
+// Switching activity of a set of signals, the input of a dynamic-power estimate
+// (P = toggles x C V^2 / 2 x f). No SystemC in here, so traces can be analysed
+// offline; ToggleCollector in toggle.h feeds it live.
+//
+// For every signal it counts transitions (value changes) and weighs them two ways:
+// by bit width, as if every change switched the whole bus, and by Hamming distance,
+// the bits that actually switched. The first value of a signal only sets its start.
+struct ToggleSignal {
+    std::string name;
+    std::string module;     // Module the signal is credited to
+    int width;
+    uint64_t transitions;
+    uint64_t bit_toggles;
+    uint32_t last;
+    bool seen;
+};
+
+// Sums over the signals of one module, or of all of them
+struct ToggleTotals {
+    std::string module;
+    uint64_t signals;
+    uint64_t bits;
+    uint64_t transitions;
+    uint64_t weighted;      // Transitions times bit width
+    uint64_t bit_toggles;   // Hamming distance of every transition
+
+    // Average share of the bits that switch per cycle, the activity factor
+    double activity(uint64_t cycles) const { return bits && cycles ? double(bit_toggles) / bits / cycles : 0; }
+};
+
+// Part of a hierarchical name before its last '.', "top" for a name without one
+inline std::string module_of(const std::string& name) {
+    size_t dot = name.rfind('.');
+    return dot == std::string::npos ? std::string("top") : name.substr(0, dot);
+}
+
+class ToggleCounter {
+public:
+    // Index for value(); width is 1 to 32
+    size_t add(const std::string& name, const std::string& module, int width) {
+        ToggleSignal s = { name, module, width < 1 ? 1 : width > 32 ? 32 : width, 0, 0, 0, false };
+        signals.push_back(s);
+        return signals.size() - 1;
+    }
+
+    // Current value of signal i, a transition if it differs from the previous one
+    void value(size_t i, uint32_t v) {
+        ToggleSignal& s = signals[i];
+        if (s.width < 32)
+            v &= (uint32_t(1) << s.width) - 1;
+        if (s.seen && v != s.last) {
+            s.transitions++;
+            s.bit_toggles += std::bitset<32>(v ^ s.last).count();
+        }
+        s.last = v;
+        s.seen = true;
+    }
+
+    // One entry per module, in the order their first signals were added
+    std::vector<ToggleTotals> modules() const {
+        std::vector<ToggleTotals> m;
+        for (size_t i = 0; i < signals.size(); i++) {
+            size_t k = 0;
+            while (k < m.size() && m[k].module != signals[i].module)
+                k++;
+            if (k == m.size())
+                m.push_back(empty(signals[i].module));
+            accumulate(m[k], signals[i]);
+        }
+        return m;
+    }
+
+    ToggleTotals totals() const {
+        ToggleTotals t = empty("total");
+        for (size_t i = 0; i < signals.size(); i++)
+            accumulate(t, signals[i]);
+        return t;
+    }
+
+    // Per-module switching-activity table over `cycles` clock cycles, then the total
+    void report(std::ostream& os, uint64_t cycles) const {
+        os << "module\tsignals\tbits\ttransitions\twidth_weighted\tbit_toggles\ttoggles_per_cycle\tactivity" << std::endl;
+        std::vector<ToggleTotals> m = modules();
+        m.push_back(totals());
+        for (size_t k = 0; k < m.size(); k++)
+            os << m[k].module << "\t" << m[k].signals << "\t" << m[k].bits << "\t" << m[k].transitions << "\t"
+               << m[k].weighted << "\t" << m[k].bit_toggles << "\t"
+               << (cycles ? double(m[k].bit_toggles) / cycles : 0) << "\t" << m[k].activity(cycles) << std::endl;
+    }
+
+    std::vector<ToggleSignal> signals;
+
+private:
+    static ToggleTotals empty(const std::string& module) {
+        ToggleTotals t = { module, 0, 0, 0, 0, 0 };
+        return t;
+    }
+
+    static void accumulate(ToggleTotals& t, const ToggleSignal& s) {
+        t.signals++;
+        t.bits += s.width;
+        t.transitions += s.transitions;
+        t.weighted += s.transitions * s.width;
+        t.bit_toggles += s.bit_toggles;
+    }
+};
+
+// Count the switching activity of a whole trace, read with VcdTraceReader or
+// BinaryTraceReader, each signal credited to module_of() its name. 1-bit signals
+// named clk (or ending in .clk) are not counted; the rising edges of the first one
+// are the cycles returned.
+template <class Reader>
+inline uint64_t count_trace(Reader& reader, ToggleCounter& counter) {
+    std::vector<size_t> index(reader.signals.size(), size_t(-1));
+    size_t clock = size_t(-1);
+    for (size_t i = 0; i < reader.signals.size(); i++) {
+        const std::string& name = reader.signals[i].name;
+        if (reader.signals[i].width == 1 &&
+            (name == "clk" || (name.size() > 4 && name.compare(name.size() - 4, 4, ".clk") == 0))) {
+            if (clock == size_t(-1))
+                clock = i;
+            continue;
+        }
+        index[i] = counter.add(name, module_of(name), reader.signals[i].width);
+    }
+
+    uint64_t time, rising = 0;
+    int level = -1;
+    std::vector<TraceValue> values;
+    while (reader.next(time, values)) {
+        for (size_t k = 0; k < values.size(); k++) {
+            uint32_t i = values[k].index;
+            if (index[i] != size_t(-1)) {
+                counter.value(index[i], uint32_t(values[k].value));
+            } else if (i == clock) {
+                rising += level == 0 && values[k].value;
+                level = values[k].value ? 1 : 0;
+            }
+        }
+    }
+    return rising;
+}
+
+#endif
@@ -0,0 +1,278 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <systemc.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "pe_types.h"
+#include "trace_format.h"
+
+// Which signals to trace, when, and where to. Filled from the command line:
+//   --trace FILE             trace to FILE, VCD if it ends in .vcd, else the binary format
+//   --no-trace               no trace file
+//   --trace-signals a,b,...  only these signals (clk, rst, x_in, y_out, ...)
+//   --trace-window FROM:TO   only rising edges FROM <= cycle < TO, either end may be left out
+//   --trace-ring N           only the N cycles before and after each checker mismatch
+//   --trace-dumps N          at most N mismatch windows in ring mode (default 10)
+struct TraceConfig {
+    std::string path;                   // Empty: tracing off
+    std::vector<std::string> signals;   // Empty: every signal
+    uint64_t start_cycle, end_cycle;
+    uint64_t ring_cycles;               // 0: no ring buffer, trace the whole window
+    uint64_t max_dumps;
+
+    explicit TraceConfig(const char* default_path = "")
+        : path(default_path), start_cycle(0), end_cycle(UINT64_MAX), ring_cycles(0), max_dumps(10) {}
+
+    bool enabled() const { return !path.empty(); }
+
+    bool binary() const { return path.size() < 4 || path.compare(path.size() - 4, 4, ".vcd") != 0; }
+
+    bool selected(const std::string& name) const {
+        if (signals.empty())
+            return true;
+        for (size_t i = 0; i < signals.size(); i++)
+            if (signals[i] == name)
+                return true;
+        return false;
+    }
+
+    // Take the trace options out of argv, leaving the rest for the caller. False on a
+    // malformed option, after printing why.
+    bool parse(int& argc, char* argv[]) {
+        int kept = 1;
+        for (int i = 1; i < argc; i++) {
+            const char* opt = argv[i];
+            if (std::strcmp(opt, "--no-trace") == 0) {
+                path.clear();
+                continue;
+            }
+            if (std::strncmp(opt, "--trace", 7) != 0) {
+                argv[kept++] = argv[i];
+                continue;
+            }
+            if (i + 1 == argc)
+                return bad(opt, "needs a value");
+            const char* value = argv[++i];
+            if (std::strcmp(opt, "--trace") == 0) {
+                path = value;
+            } else if (std::strcmp(opt, "--trace-signals") == 0) {
+                std::stringstream ss(value);
+                std::string name;
+                signals.clear();
+                while (std::getline(ss, name, ','))
+                    if (!name.empty())
+                        signals.push_back(name);
+            } else if (std::strcmp(opt, "--trace-window") == 0) {
+                const char* colon = std::strchr(value, ':');
+                if (!colon)
+                    return bad(opt, "expects FROM:TO");
+                start_cycle = std::strtoull(value, 0, 10);
+                end_cycle = colon[1] ? std::strtoull(colon + 1, 0, 10) : UINT64_MAX;
+            } else if (std::strcmp(opt, "--trace-ring") == 0) {
+                ring_cycles = std::strtoull(value, 0, 10);
+            } else if (std::strcmp(opt, "--trace-dumps") == 0) {
+                max_dumps = std::strtoull(value, 0, 10);
+            } else {
+                return bad(opt, "is not a trace option");
+            }
+        }
+        argc = kept;
+        argv[argc] = 0;
+        return true;
+    }
+
+private:
+    static bool bad(const char* opt, const char* why) {
+        cout << opt << " " << why << endl;
+        return false;
+    }
+};
+
+// Cycle-based tracer for top-level signals. Every signal of a clocked array changes
+// only on a clock edge, so instead of a value-change callback per signal it reads the
+// selected signals once per edge and hands the writer only those that changed.
+// Values read at an edge are the ones settled since the previous edge, so each
+// sample is stamped with the previous edge's time and the trace matches a VCD.
+//
+// Cycle c is rising edge c, counted like the testbenches' edges, together with the
+// falling edge before it, where the inputs for c are driven. In ring mode the last
+// ring_cycles cycles are held in memory and written out only when trigger() is
+// called, typically from a GoldenChecker mismatch hook.
+SC_MODULE(SignalTracer) {
+    sc_in<bool> clk;
+
+    SC_HAS_PROCESS(SignalTracer);
+    SignalTracer(sc_module_name name, const TraceConfig& config)
+        : sc_module(name), config(config), clock_level(false), cycle(0), last_time(0), last_cycle(0),
+          started(false), written_last(false), dump_until(0), dumps(0), ring_next(0), ring_count(0) {
+        if (!config.enabled())
+            return;
+        // The clock itself is traced from the edge direction, reading it would give the new level
+        add_signal("clk", 1, std::function<int()>());
+        SC_METHOD(sample);
+        sensitive << clk;
+    }
+
+    ~SignalTracer() {
+        if (writer)
+            writer->close();
+    }
+
+    // Any signal whose value as_int() converts; bool is traced as 1 bit, the rest as 32
+    template <class V>
+    void add(const char* name, const sc_signal_in_if<V>& sig) {
+        add_signal(name, std::is_same<V, bool>::value ? 1 : 32, [&sig]() { return as_int(sig.read()); });
+    }
+
+    // Dump the ring_cycles cycles before `at` and keep tracing until ring_cycles after it
+    void trigger(uint64_t at) {
+        if (!writer || !config.ring_cycles)
+            return;
+        // A mismatch inside the current dump window only moves its end
+        if (dumps > 0 && at <= dump_until) {
+            dump_until = std::max(dump_until, at + config.ring_cycles);
+            return;
+        }
+        if (dumps == config.max_dumps)
+            return;
+        dumps++;
+        uint64_t dump_from = at > config.ring_cycles ? at - config.ring_cycles : 0;
+        dump_until = at + config.ring_cycles;
+        written_last = false;
+        for (size_t k = 0; k < ring_count; k++) {
+            const Sample& s = ring[(ring_next + ring.size() - ring_count + k) % ring.size()];
+            if (s.cycle >= dump_from)
+                write(s.time, s.values);
+        }
+        ring_count = 0;
+    }
+
+    void start_of_simulation() {
+        if (!config.enabled())
+            return;
+        for (size_t i = 0; i < config.signals.size(); i++) {
+            bool known = false;
+            for (size_t k = 0; k < signals.size(); k++)
+                known |= signals[k].name == config.signals[i];
+            if (!known)
+                cout << name() << ": no signal " << config.signals[i] << " to trace" << endl;
+        }
+        if (config.binary())
+            writer.reset(new BinaryTraceWriter());
+        else
+            writer.reset(new VcdTraceWriter());
+        if (!writer->open(config.path.c_str(), signals)) {
+            cout << name() << ": cannot write " << config.path << endl;
+            writer.reset();
+            return;
+        }
+        current.resize(signals.size());
+        written.resize(signals.size());
+        if (config.ring_cycles)
+            ring.resize(2 * config.ring_cycles + 4);  // Two edges a cycle, plus the edge being processed
+    }
+
+    // The interval since the last edge has no later edge to close it
+    void end_of_simulation() {
+        if (started)
+            record();
+        if (writer)
+            writer->close();
+    }
+
+private:
+    struct Sample {
+        uint64_t time;
+        uint64_t cycle;
+        std::vector<int> values;
+    };
+
+    // An empty read is the clock
+    void add_signal(const char* name, int width, const std::function<int()>& read) {
+        if (!config.enabled() || !config.selected(name))
+            return;
+        TraceSignal s = { name, width };
+        signals.push_back(s);
+        sources.push_back(read);
+    }
+
+    // Clock edge: close the interval that started at the previous edge
+    void sample() {
+        if (!writer)
+            return;
+        if (started)
+            record();
+        bool rising = clk.read();
+        clock_level = rising;
+        last_time = sc_time_stamp().value();
+        if (started && !rising)
+            cycle++;
+        last_cycle = cycle;
+        started = true;
+    }
+
+    void record() {
+        for (size_t k = 0; k < sources.size(); k++) {
+            current[k] = sources[k] ? sources[k]() : int(clock_level);
+        }
+        if (last_cycle < config.start_cycle || last_cycle >= config.end_cycle) {
+            written_last = false;
+            return;
+        }
+        if (!config.ring_cycles) {
+            write(last_time, current);
+        } else if (dumps > 0 && last_cycle <= dump_until) {
+            write(last_time, current);
+        } else {
+            written_last = false;
+            Sample& s = ring[ring_next];
+            s.time = last_time;
+            s.cycle = last_cycle;
+            s.values = current;
+            ring_next = (ring_next + 1) % ring.size();
+            if (ring_count < ring.size())
+                ring_count++;
+        }
+    }
+
+    // Pass the writer every value on the first sample after a gap, else only changes
+    void write(uint64_t time, const std::vector<int>& values) {
+        changed.clear();
+        for (size_t k = 0; k < values.size(); k++) {
+            if (!written_last || values[k] != written[k]) {
+                TraceValue v = { uint32_t(k), values[k] };
+                changed.push_back(v);
+                written[k] = values[k];
+            }
+        }
+        if (!written_last || !changed.empty())
+            writer->sample(time, changed.data(), changed.size());
+        written_last = true;
+    }
+
+    TraceConfig config;
+    std::vector<TraceSignal> signals;
+    std::vector<std::function<int()> > sources;
+    std::unique_ptr<TraceWriter> writer;
+    std::vector<int> current, written;
+    std::vector<TraceValue> changed;
+    bool clock_level;
+    uint64_t cycle;                     // Cycle of the edge being processed
+    uint64_t last_time, last_cycle;     // Start of the open interval
+    bool started;
+    bool written_last;                  // The previous interval went to the writer
+    uint64_t dump_until, dumps;          // Ring mode: end of the open dump window, windows so far
+    std::vector<Sample> ring;
+    size_t ring_next, ring_count;
+};
+
+#endif
@@ -0,0 +1,380 @@
+#ifndef TRACE_FORMAT_H
+#define TRACE_FORMAT_H
+
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+// Trace files written by SignalTracer (common/trace.h). No SystemC in here, so
+// the trace2vcd converter can build without it.
+//
+// Binary format, host byte order for the fixed fields:
+//   "SATRACE1"
+//   uint32 signal count, then per signal: uint8 width (1 or 32), uint16 name
+//   length, name bytes
+//   records until end of file, each:
+//     varint  time since the previous record, in ps
+//     varint  number of values that follow
+//     per value: varint signal index, zigzag varint value
+// The first record of every traced window lists every signal, the rest only the
+// signals that changed, so an unchanged bus costs nothing.
+
+static const char TRACE_MAGIC[8] = { 'S', 'A', 'T', 'R', 'A', 'C', 'E', '1' };
+
+struct TraceSignal {
+    std::string name;
+    int width;          // 1 for bool, 32 for int
+};
+
+// One value of one signal at a sample time
+struct TraceValue {
+    uint32_t index;
+    int32_t value;
+};
+
+// Destination for samples, implemented by the binary and VCD writers
+class TraceWriter {
+public:
+    virtual ~TraceWriter() {}
+    virtual bool open(const char* path, const std::vector<TraceSignal>& signals) = 0;
+    // Values at time_ps; a full sample lists every signal
+    virtual void sample(uint64_t time_ps, const TraceValue* values, size_t count) = 0;
+    virtual void close() = 0;
+};
+
+class BinaryTraceWriter : public TraceWriter {
+public:
+    BinaryTraceWriter() : f(0), last_time(0) {}
+    ~BinaryTraceWriter() { close(); }
+
+    bool open(const char* path, const std::vector<TraceSignal>& signals) {
+        f = std::fopen(path, "wb");
+        if (!f)
+            return false;
+        std::fwrite(TRACE_MAGIC, 1, sizeof(TRACE_MAGIC), f);
+        uint32_t n = signals.size();
+        std::fwrite(&n, sizeof(n), 1, f);
+        for (size_t i = 0; i < signals.size(); i++) {
+            uint8_t width = signals[i].width;
+            uint16_t length = signals[i].name.size();
+            std::fwrite(&width, sizeof(width), 1, f);
+            std::fwrite(&length, sizeof(length), 1, f);
+            std::fwrite(signals[i].name.data(), 1, length, f);
+        }
+        return true;
+    }
+
+    void sample(uint64_t time_ps, const TraceValue* values, size_t count) {
+        put_varint(time_ps - last_time);
+        put_varint(count);
+        for (size_t i = 0; i < count; i++) {
+            put_varint(values[i].index);
+            put_varint(zigzag(values[i].value));
+        }
+        last_time = time_ps;
+    }
+
+    void close() {
+        if (f)
+            std::fclose(f);
+        f = 0;
+    }
+
+private:
+    static uint64_t zigzag(int32_t v) { return (uint32_t(v) << 1) ^ uint32_t(v >> 31); }
+
+    void put_varint(uint64_t v) {
+        while (v >= 0x80) {
+            std::fputc(int(v & 0x7f) | 0x80, f);
+            v >>= 7;
+        }
+        std::fputc(int(v), f);
+    }
+
+    FILE* f;
+    uint64_t last_time;
+};
+
+// Plain VCD, one scope, timescale 1 ps
+class VcdTraceWriter : public TraceWriter {
+public:
+    VcdTraceWriter() : f(0), widths() {}
+    ~VcdTraceWriter() { close(); }
+
+    bool open(const char* path, const std::vector<TraceSignal>& signals) {
+        f = std::fopen(path, "w");
+        if (!f)
+            return false;
+        std::fprintf(f, "$timescale 1 ps $end\n$scope module SystemC $end\n");
+        for (size_t i = 0; i < signals.size(); i++) {
+            widths.push_back(signals[i].width);
+            std::fprintf(f, "$var wire %d %s %s $end\n", signals[i].width, code(i).c_str(), signals[i].name.c_str());
+        }
+        std::fprintf(f, "$upscope $end\n$enddefinitions $end\n");
+        return true;
+    }
+
+    void sample(uint64_t time_ps, const TraceValue* values, size_t count) {
+        std::fprintf(f, "#%llu\n", (unsigned long long)time_ps);
+        for (size_t i = 0; i < count; i++) {
+            const TraceValue& v = values[i];
+            if (widths[v.index] == 1) {
+                std::fprintf(f, "%d%s\n", v.value ? 1 : 0, code(v.index).c_str());
+            } else {
+                char bits[33];
+                for (int b = 0; b < 32; b++)
+                    bits[b] = (uint32_t(v.value) >> (31 - b)) & 1 ? '1' : '0';
+                bits[32] = 0;
+                std::fprintf(f, "b%s %s\n", bits, code(v.index).c_str());
+            }
+        }
+    }
+
+    void close() {
+        if (f)
+            std::fclose(f);
+        f = 0;
+    }
+
+private:
+    // Short printable identifier for signal i
+    static std::string code(size_t i) {
+        std::string s;
+        do {
+            s += char('!' + i % 94);
+            i /= 94;
+        } while (i);
+        return s;
+    }
+
+    FILE* f;
+    std::vector<int> widths;
+};
+
+// Reads a binary trace back one record at a time
+class BinaryTraceReader {
+public:
+    BinaryTraceReader() : f(0), time(0) {}
+    ~BinaryTraceReader() {
+        if (f)
+            std::fclose(f);
+    }
+
+    bool open(const char* path) {
+        f = std::fopen(path, "rb");
+        if (!f)
+            return false;
+        char magic[8];
+        uint32_t n;
+        if (std::fread(magic, 1, sizeof(magic), f) != sizeof(magic) ||
+            std::memcmp(magic, TRACE_MAGIC, sizeof(magic)) != 0 || std::fread(&n, sizeof(n), 1, f) != 1)
+            return false;
+        for (uint32_t i = 0; i < n; i++) {
+            uint8_t width;
+            uint16_t length;
+            if (std::fread(&width, sizeof(width), 1, f) != 1 || std::fread(&length, sizeof(length), 1, f) != 1)
+                return false;
+            TraceSignal s;
+            s.name.resize(length);
+            s.width = width;
+            if (length && std::fread(&s.name[0], 1, length, f) != length)
+                return false;
+            signals.push_back(s);
+        }
+        return true;
+    }
+
+    // Next record, false at end of file or on a malformed record
+    bool next(uint64_t& time_ps, std::vector<TraceValue>& values) {
+        uint64_t delta, count;
+        if (!get_varint(delta) || !get_varint(count) || count > signals.size())
+            return false;
+        time += delta;
+        time_ps = time;
+        values.resize(count);
+        for (uint64_t i = 0; i < count; i++) {
+            uint64_t index, value;
+            if (!get_varint(index) || !get_varint(value) || index >= signals.size())
+                return false;
+            values[i].index = uint32_t(index);
+            values[i].value = int32_t(uint32_t(value >> 1) ^ -uint32_t(value & 1));
+        }
+        return true;
+    }
+
+    std::vector<TraceSignal> signals;
+
+private:
+    bool get_varint(uint64_t& v) {
+        v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            int c = std::fgetc(f);
+            if (c == EOF)
+                return false;
+            v |= uint64_t(c & 0x7f) << shift;
+            if (!(c & 0x80))
+                return true;
+        }
+        return false;
+    }
+
+    FILE* f;
+    uint64_t time;
+};
+
+// Reads a VCD one timestamp at a time, with the interface of BinaryTraceReader, so
+// tools can take VCDs from SignalTracer or any other simulator. Signal names are the
+// scope path and the reference joined by '.'; vectors keep their low 32 bits, x and z
+// bits read as 0, and real variables are skipped.
+class VcdTraceReader {
+public:
+    VcdTraceReader() : f(0), time(0), scale(1) {}
+    ~VcdTraceReader() {
+        if (f)
+            std::fclose(f);
+    }
+
+    bool open(const char* path) {
+        f = std::fopen(path, "r");
+        if (!f)
+            return false;
+        std::vector<std::string> scope;
+        std::string word;
+        while (next_word(word)) {
+            if (word == "$enddefinitions")
+                return skip_to_end();
+            if (word == "$timescale") {
+                std::string text;
+                while (next_word(word) && word != "$end")
+                    text += word;
+                scale = timescale_ps(text);
+            } else if (word == "$scope") {
+                std::vector<std::string> args = section();
+                scope.push_back(args.size() > 1 ? args[1] : "");
+            } else if (word == "$upscope") {
+                if (!scope.empty())
+                    scope.pop_back();
+                skip_to_end();
+            } else if (word == "$var") {
+                std::vector<std::string> args = section();
+                if (args.size() < 4)
+                    return false;
+                if (args[0] == "real")
+                    continue;
+                TraceSignal s;
+                for (size_t i = 0; i < scope.size(); i++)
+                    s.name += scope[i] + ".";
+                s.name += args[3];
+                s.width = std::atoi(args[1].c_str()) > 32 ? 32 : std::atoi(args[1].c_str());
+                ids[args[2]].push_back(uint32_t(signals.size()));
+                signals.push_back(s);
+            } else if (word[0] == '$') {
+                skip_to_end();
+            }
+        }
+        return false;
+    }
+
+    // Values that changed at the next timestamp, false at end of file
+    bool next(uint64_t& time_ps, std::vector<TraceValue>& values) {
+        values.clear();
+        std::string word;
+        while (next_word(word)) {
+            char c = word[0];
+            if (c == '#') {
+                uint64_t t = uint64_t(std::strtoull(word.c_str() + 1, 0, 10) * scale + 0.5);
+                if (!values.empty()) {
+                    time_ps = time;
+                    time = t;
+                    return true;
+                }
+                time = t;
+            } else if (c == '$') {
+                if (word == "$comment")
+                    skip_to_end();
+            } else if (c == 'b' || c == 'B') {
+                std::string id;
+                if (!next_word(id))
+                    break;
+                add(id, parse_bits(word.c_str() + 1), values);
+            } else if (c == 'r' || c == 'R') {
+                next_word(word);
+            } else {
+                add(word.substr(1), c == '1' ? 1 : 0, values);
+            }
+        }
+        time_ps = time;
+        return !values.empty();
+    }
+
+    std::vector<TraceSignal> signals;
+
+private:
+    void add(const std::string& id, uint32_t value, std::vector<TraceValue>& values) {
+        std::map<std::string, std::vector<uint32_t> >::const_iterator it = ids.find(id);
+        if (it == ids.end())
+            return;
+        for (size_t i = 0; i < it->second.size(); i++) {
+            TraceValue v = { it->second[i], int32_t(value) };
+            values.push_back(v);
+        }
+    }
+
+    static uint32_t parse_bits(const char* bits) {
+        uint32_t v = 0;
+        for (; *bits; bits++)
+            v = (v << 1) | (*bits == '1' ? 1 : 0);
+        return v;
+    }
+
+    // "1ps", "10 ns", ... in ps
+    static double timescale_ps(const std::string& text) {
+        char* unit = 0;
+        double n = std::strtod(text.c_str(), &unit);
+        static const char* units[] = { "fs", "ps", "ns", "us", "ms", "s" };
+        double ps = 1e-3;
+        for (size_t i = 0; i < sizeof(units) / sizeof(units[0]); i++, ps *= 1000)
+            if (unit && std::strcmp(unit, units[i]) == 0)
+                return (n > 0 ? n : 1) * ps;
+        return 1;
+    }
+
+    // The words of a section up to its $end
+    std::vector<std::string> section() {
+        std::vector<std::string> words;
+        std::string word;
+        while (next_word(word) && word != "$end")
+            words.push_back(word);
+        return words;
+    }
+
+    bool skip_to_end() {
+        std::string word;
+        while (next_word(word))
+            if (word == "$end")
+                return true;
+        return false;
+    }
+
+    bool next_word(std::string& word) {
+        word.clear();
+        int c;
+        while ((c = std::fgetc(f)) != EOF && std::isspace(c))
+            ;
+        for (; c != EOF && !std::isspace(c); c = std::fgetc(f))
+            word += char(c);
+        return !word.empty();
+    }
+
+    FILE* f;
+    uint64_t time;
+    double scale;           // ps per VCD time unit
+    std::map<std::string, std::vector<uint32_t> > ids;
+};
+
+#endif
@@ -0,0 +1,156 @@
+#include <systemc.h>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "../common/golden_checker.h"
+#include "../common/harness.h"
+#include "../common/stimulus.h"
+#include "../common/stimulus_file.h"
+
+// One SystemC array and its fast model, fed from the same input stream
+struct CheckedArray {
+    std::string label;
+    OutputSignals out;
+    std::vector<CycleOut> sc_trace_out;    // SystemC outputs per cycle
+    std::vector<CycleOut> fast_trace_out;  // Fast model outputs per cycle
+    double fast_seconds;
+
+    explicit CheckedArray(const std::string& label) : label(label), fast_seconds(0) {}
+    virtual ~CheckedArray() {}
+
+    // Run the whole stream through the fast model and time it
+    virtual void run_fast_model(const std::vector<CycleIn>& in) = 0;
+};
+
+template <Design D, int N>
+struct CheckedArrayOf : public CheckedArray {
+    SystolicArray<D, N> array;
+
+    CheckedArrayOf(InputSignals& in)
+        : CheckedArray(std::string(design_name(D)) + "x" + std::to_string(N)),
+          array((std::string(design_name(D)) + "_" + std::to_string(N)).c_str()) {
+        bind(array, in, out);
+    }
+
+    void run_fast_model(const std::vector<CycleIn>& in) {
+        FastModel<D> model(N);
+        fast_trace_out.resize(in.size());
+        auto start = std::chrono::steady_clock::now();
+        run_fast(model, in.data(), fast_trace_out.data(), in.size());
+        fast_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+};
+
+template <Design D>
+static void add_design(std::vector<CheckedArray*>& arrays, InputSignals& in) {
+    arrays.push_back(new CheckedArrayOf<D, 1>(in));
+    arrays.push_back(new CheckedArrayOf<D, 3>(in));
+    arrays.push_back(new CheckedArrayOf<D, 9>(in));
+    arrays.push_back(new CheckedArrayOf<D, 25>(in));
+}
+
+// Streams random samples through the B1 fast model into a golden checker, passing it
+// every output cycle but `dropped` (none if it is past the stream); true if it passes
+static bool golden_checker_passes(uint64_t samples, unsigned seed, uint64_t dropped) {
+    const int n = 3;
+    std::vector<StimulusRecord> records = random_samples(samples, seed, n);
+    std::vector<CycleIn> in(1 + samples + n);
+    in[0].rst = true;
+    for (uint64_t i = 0; i < samples; i++)
+        in[1 + i].x = records[i].x;
+    std::vector<CycleOut> out(in.size());
+    FastModel<Design::B1> model(n);
+    run_fast(model, in.data(), out.data(), in.size());
+
+    GoldenChecker checker = GoldenChecker::for_design(Design::B1, n, samples);
+    checker.set_report_limit(0);
+    for (uint64_t c = 0; c < in.size(); c++) {
+        if (c >= 1 && c <= samples)
+            checker.sample(c, in[c].x);
+        if (c != dropped)
+            checker.output(c, out[c].y);
+    }
+    return checker.mismatch_count() == 0 && checker.missing_count() == 0;
+}
+
+int sc_main(int argc, char* argv[]) {
+    size_t cycles = argc > 1 ? std::strtoul(argv[1], 0, 10) : 20000;
+    unsigned seed = argc > 2 ? std::strtoul(argv[2], 0, 10) : 1;
+
+    InputSignals inputs;
+    std::vector<CheckedArray*> arrays;
+    add_design<Design::B1>(arrays, inputs);
+    add_design<Design::B2>(arrays, inputs);
+    add_design<Design::F>(arrays, inputs);
+    add_design<Design::R1>(arrays, inputs);
+    add_design<Design::R2>(arrays, inputs);
+    add_design<Design::W1>(arrays, inputs);
+    add_design<Design::W2>(arrays, inputs);
+
+    std::vector<CycleIn> stream = random_stream(cycles, seed);
+
+    // SystemC run: all arrays share the clock and the stimulus
+    cout << "Cross-checking " << arrays.size() << " arrays over " << cycles << " cycles (seed " << seed << ")" << endl;
+    for (size_t i = 0; i < arrays.size(); i++)
+        arrays[i]->sc_trace_out.resize(cycles);
+    auto start = std::chrono::steady_clock::now();
+    for (size_t c = 0; c < cycles; c++) {
+        inputs.cycle(stream[c]);
+        for (size_t i = 0; i < arrays.size(); i++)
+            arrays[i]->sc_trace_out[c] = arrays[i]->out.read();
+    }
+    double sc_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Fast model run and cycle-by-cycle comparison
+    int failures = 0;
+    double fast_seconds = 0;
+    cout << "Array\tMismatches\tFirst\tFast Mcycles/s" << endl;
+    for (size_t i = 0; i < arrays.size(); i++) {
+        CheckedArray* a = arrays[i];
+        a->run_fast_model(stream);
+        fast_seconds += a->fast_seconds;
+
+        size_t mismatches = 0, first = 0;
+        for (size_t c = 0; c < cycles; c++) {
+            if (a->sc_trace_out[c] != a->fast_trace_out[c]) {
+                if (mismatches == 0)
+                    first = c;
+                mismatches++;
+            }
+        }
+        if (mismatches)
+            failures++;
+        cout << a->label << "\t" << mismatches << "\t\t";
+        if (mismatches)
+            cout << first;
+        else
+            cout << "-";
+        cout << "\t" << (a->fast_seconds > 0 ? cycles / a->fast_seconds / 1e6 : 0) << endl;
+
+        if (mismatches) {
+            const CycleOut& s = a->sc_trace_out[first];
+            const CycleOut& f = a->fast_trace_out[first];
+            cout << "  cycle " << first << ": SystemC y=" << s.y << " x=" << s.x << " w=" << s.w << " tag=" << s.tag
+                 << ", fast y=" << f.y << " x=" << f.x << " w=" << f.w << " tag=" << f.tag << endl;
+        }
+    }
+
+    cout << "SystemC: " << sc_seconds << " s, fast model: " << fast_seconds << " s, speedup "
+         << (fast_seconds > 0 ? sc_seconds / fast_seconds : 0) << "x" << endl;
+    cout << (failures ? "FAIL" : "PASS") << ": " << failures << " of " << arrays.size() << " arrays differ" << endl;
+
+    // The golden checker must fail a run in which one result never reaches it
+    bool complete = golden_checker_passes(1000, seed, uint64_t(-1));
+    bool dropped = golden_checker_passes(1000, seed, 500);
+    bool checker_ok = complete && !dropped;
+    if (!checker_ok)
+        failures++;
+    cout << (checker_ok ? "PASS" : "FAIL") << ": golden checker " << (complete ? "passes" : "fails")
+         << " the full stream and " << (dropped ? "passes" : "fails") << " it with output cycle 500 dropped" << endl;
+
+    for (size_t i = 0; i < arrays.size(); i++)
+        delete arrays[i];
+    return failures ? 1 : 0;
+}
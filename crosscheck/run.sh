@@ -0,0 +1,6 @@
+cd "$(dirname "$0")"
+# ./run.sh [cycles] [seed]   SystemC vs fast model at 1, 3, 9 and 25 taps
+export LIBRARY_PATH=:/playground_lib/systemc-2.3.3/lib-linux64
+export LD_LIBRARY_PATH=/playground_lib/systemc-2.3.3/lib-linux64
+export CPATH=:/playground_lib/systemc-2.3.3/include
+g++ -O2 $CXXFLAGS -o sim *.cpp -lsystemc && echo "Compile done. Starting run..." && ./sim "$@"
@@ -0,0 +1,198 @@
+#include <systemc.h>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "../common/child_process.h"
+#include "../common/dispatch.h"
+#include "../common/harness.h"
+#include "../common/schedule.h"
+
+// Measured in the child, trivially copyable so it can come back through a pipe
+struct ScheduleResult {
+    uint64_t checked;
+    uint64_t mismatches;
+    uint64_t first_mismatch;    // Result index, valid if mismatches > 0
+    int64_t got;                // y_out at that result's cycle
+};
+
+// Drives one schedule cycle by cycle through the SystemC array and checks y_out
+// at every result cycle
+struct ScheduleRun {
+    const Schedule& schedule;
+    ScheduleResult result;
+
+    template <Design D, int N>
+    void run() {
+        InputSignals in;
+        OutputSignals out;
+        SystolicArray<D, N> array("array");
+        bind(array, in, out);
+        load_kernel(array, schedule.kernel);
+
+        std::vector<int> y(schedule.cycles.size());
+        for (size_t c = 0; c < schedule.cycles.size(); c++) {
+            in.cycle(schedule.cycles[c]);
+            y[c] = out.read().y;
+        }
+        for (size_t m = 0; m < schedule.expected.size(); m++) {
+            int got = y[schedule.result_cycles[m]];
+            if (got != schedule.expected[m] && result.mismatches++ == 0) {
+                result.first_mismatch = m;
+                result.got = got;
+            }
+            result.checked++;
+        }
+    }
+};
+
+static bool run_once(const Schedule& s, ScheduleResult& result) {
+    ScheduleRun run = { s, ScheduleResult() };
+    bool ok = run_in_child([&](ScheduleResult& r) {
+        bool dispatched = dispatch(s.design, s.taps(), run);
+        r = run.result;
+        return dispatched;
+    }, result);
+    return ok;
+}
+
+// The schedule as lines for a hand-written testbench's schedule, then where each result appears
+static void print_schedule(const Schedule& s) {
+    cout << "// " << design_name(s.design) << ", " << s.taps() << " taps, " << s.x.size() << " samples" << endl;
+    for (size_t c = 0; c < s.cycles.size(); c++) {
+        const CycleIn& in = s.cycles[c];
+        cout << "schedule.push_back(cycle(" << (in.rst ? "true" : "false") << ", " << in.x << ", " << in.w << ", "
+             << (in.tag ? "true" : "false") << "));  // Cycle " << c << ": " << s.describe(c) << endl;
+    }
+    for (size_t m = 0; m < s.expected.size(); m++)
+        cout << "// y" << s.taps() + m << " = " << s.expected[m] << " on y_out after cycle " << s.result_cycles[m]
+             << endl;
+}
+
+static int usage() {
+    cout << "Usage: schedule [--designs R1,R2,B2] [--taps 3,9,...] [--samples L] [--x 1,2,...] [--kernel 1,2,...]"
+         << endl
+         << "                [--range R] [--seed S] [--print]" << endl
+         << "       --print writes each schedule as testbench lines, schedule.push_back(cycle(...));" << endl;
+    return 1;
+}
+
+// Comma-separated integers
+static std::vector<int> int_list(char* list) {
+    std::vector<int> values;
+    for (char* t = std::strtok(list, ","); t; t = std::strtok(0, ","))
+        values.push_back(std::atoi(t));
+    return values;
+}
+
+int sc_main(int argc, char* argv[]) {
+    std::vector<Design> designs = { Design::R1, Design::R2, Design::B2 };
+    std::vector<int> taps = { 3, 9, 16, 25 };
+    uint64_t samples = 64;
+    std::vector<int> x;             // Given samples, random ones if empty
+    std::vector<int> kernel;        // Given kernel, default_weights() of each tap count if empty
+    int range = 8;
+    unsigned seed = 1;
+    bool print = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--print") == 0) {
+            print = true;
+            continue;
+        }
+        if (i + 1 == argc)
+            return usage();
+        if (std::strcmp(argv[i], "--designs") == 0) {
+            designs.clear();
+            for (char* t = std::strtok(argv[++i], ","); t; t = std::strtok(0, ",")) {
+                Design d;
+                if (!parse_design(t, d)) {
+                    cout << "Unknown design " << t << endl;
+                    return 1;
+                }
+                designs.push_back(d);
+            }
+        } else if (std::strcmp(argv[i], "--taps") == 0) {
+            taps = int_list(argv[++i]);
+        } else if (std::strcmp(argv[i], "--samples") == 0) {
+            samples = std::strtoull(argv[++i], 0, 10);
+        } else if (std::strcmp(argv[i], "--x") == 0) {
+            x = int_list(argv[++i]);
+        } else if (std::strcmp(argv[i], "--kernel") == 0) {
+            kernel = int_list(argv[++i]);
+        } else if (std::strcmp(argv[i], "--range") == 0) {
+            range = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--seed") == 0) {
+            seed = std::strtoul(argv[++i], 0, 10);
+        } else {
+            return usage();
+        }
+    }
+    if (!kernel.empty())
+        taps = { int(kernel.size()) };
+    if (!x.empty())
+        samples = x.size();
+    if (samples == 0 || range < 0)
+        return usage();
+
+    // Every schedule is derived on the fast model, then run through the SystemC array,
+    // which must put every full window on y_out at the cycle the schedule says
+    cout << "design\ttaps\tsamples\tspacing\tlead\tweights\tweight_delay\tcycles\tstalls\tresults\tresults_per_cycle"
+            "\tsteady_per_cycle\tsearch_seconds\tpassed"
+         << endl;
+    bool all_passed = true;
+    for (size_t d = 0; d < designs.size(); d++) {
+        for (size_t t = 0; t < taps.size(); t++) {
+            std::vector<int> k = kernel.empty() ? default_weights(taps[t]) : kernel;
+            std::vector<int> job = x;
+            if (job.empty()) {
+                std::mt19937 rng(seed);
+                std::uniform_int_distribution<int> value(-range, range);
+                for (uint64_t i = 0; i < samples; i++)
+                    job.push_back(value(rng));
+            }
+
+            Schedule s;
+            auto start = std::chrono::steady_clock::now();
+            bool found = make_schedule(designs[d], k, job, s);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (!found) {
+                cout << design_name(designs[d]) << "\t" << taps[t] << "\t" << job.size()
+                     << "\t-\t-\t-\t-\t-\t-\t-\t-\t-\t" << seconds << "\tfalse" << endl;
+                cout << "No schedule delivers every window of " << design_name(designs[d]) << "x" << taps[t]
+                     << (job.size() < k.size() ? " (fewer samples than taps)" : "") << endl;
+                all_passed = false;
+                continue;
+            }
+            if (print)
+                print_schedule(s);
+
+            ScheduleResult r;
+            bool ran = run_once(s, r);
+            bool passed = ran && r.mismatches == 0 && r.checked == s.expected.size();
+            all_passed &= passed;
+            std::string weights = "-", delay = "-";
+            if (streams_weights(s.design)) {
+                weights = "w" + std::to_string(s.shape.first_weight + 1) + (s.shape.weight_step > 0 ? "+" : "-");
+                delay = std::to_string(s.shape.weight_delay);
+            }
+            cout << design_name(s.design) << "\t" << s.taps() << "\t" << s.x.size() << "\t" << s.shape.spacing << "\t"
+                 << s.shape.lead << "\t" << weights << "\t" << delay << "\t" << s.cycles.size() << "\t"
+                 << s.stalls() << "\t" << s.expected.size() << "\t" << s.throughput() << "\t"
+                 << s.steady_throughput() << "\t" << seconds << "\t" << (passed ? "true" : "false") << endl;
+            if (!ran)
+                cout << "Failed to run " << design_name(s.design) << "x" << s.taps() << " (unsupported tap count?)"
+                     << endl;
+            else if (r.mismatches)
+                cout << r.mismatches << " results differ, first y" << s.taps() + r.first_mismatch << " on cycle "
+                     << s.result_cycles[r.first_mismatch] << ": expected " << s.expected[r.first_mismatch] << ", got "
+                     << r.got << endl;
+        }
+    }
+    cout << (all_passed ? "PASS" : "FAIL") << endl;
+    return all_passed ? 0 : 1;
+}
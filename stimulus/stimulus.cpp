@@ -0,0 +1,140 @@
+#include <systemc.h>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include "../common/dispatch.h"
+#include "../common/stream_run.h"
+
+// Streams the file through the array picked by dispatch() and checks every result
+struct FileRun {
+    const StimulusFile& file;
+    bool verbose;
+    const TraceConfig& trace;
+    bool skip_idle;
+    const char* checkpoint_path;    // Snapshot file, rewritten every checkpoint_every cycles
+    uint64_t checkpoint_every;
+    const Checkpoint* resume;
+    bool passed;
+
+    template <Design D, int N>
+    void run() {
+        GoldenChecker checker = GoldenChecker::for_design(D, N, file.size());
+        CheckpointPlan checkpoints;
+        uint64_t saved = 0;
+        if (checkpoint_path) {
+            checkpoints.every = checkpoint_every;
+            checkpoints.saved = [&](const Checkpoint& cp) {
+                std::string error;
+                if (cp.write(checkpoint_path, error))
+                    saved++;
+                else
+                    cout << error << endl;
+            };
+        }
+        checkpoints.resume = resume;
+        if (resume)
+            cout << "Resuming at cycle " << resume->edges << endl;
+        StreamStats stats =
+            run_stream<D, N>(file.data(), file.size(), checker, verbose, trace, skip_idle, checkpoints);
+        cout << "Samples: " << file.size() << ", cycles: " << stats.cycles << ", seconds: " << stats.seconds << ", "
+             << (stats.seconds > 0 ? file.size() / stats.seconds / 1e6 : 0) << " Msamples/s" << endl;
+        if (skip_idle)
+            cout << "Skipped idle cycles: " << stats.skipped << endl;
+        if (checkpoint_path)
+            cout << "Checkpoints written to " << checkpoint_path << ": " << saved << endl;
+        passed = checker.finish();
+    }
+};
+
+static int usage() {
+    cout << "Usage: stimulus gen <file> <samples> [seed] [taps] [range]" << endl
+         << "       stimulus run <file> <design> [taps] [-v] [--skip-idle] [--trace file] [--trace-signals a,b,...]" << endl
+         << "                    [--trace-window from:to] [--trace-ring cycles] [--trace-dumps n]" << endl
+         << "                    [--checkpoint file] [--checkpoint-every cycles] [--resume file]" << endl
+         << "       run checks y_out against the golden model; -v prints the cycle table, and no trace" << endl
+         << "       is written unless --trace is given" << endl;
+    return 1;
+}
+
+int sc_main(int argc, char* argv[]) {
+    // No trace unless asked for, streams are long
+    TraceConfig trace;
+    if (!trace.parse(argc, argv) || argc < 4)
+        return usage();
+
+    if (std::strcmp(argv[1], "gen") == 0) {
+        uint64_t samples = std::strtoull(argv[3], 0, 10);
+        unsigned seed = argc > 4 ? std::strtoul(argv[4], 0, 10) : 1;
+        int taps = argc > 5 ? std::atoi(argv[5]) : 3;
+        int range = argc > 6 ? std::atoi(argv[6]) : 8;
+        std::string error;
+        if (taps < 1 || !write_random_stimulus(argv[2], samples, seed, taps, range, error)) {
+            cout << (taps < 1 ? std::string("taps must be at least 1") : error) << endl;
+            return 1;
+        }
+        cout << "Wrote " << samples << " samples to " << argv[2] << endl;
+        return 0;
+    }
+
+    if (std::strcmp(argv[1], "run") == 0) {
+        StimulusFile file;
+        if (!file.open(argv[2])) {
+            cout << file.error() << endl;
+            return 1;
+        }
+        Design design;
+        if (!parse_design(argv[3], design)) {
+            cout << "Unknown design " << argv[3] << endl;
+            return 1;
+        }
+        int taps = file.taps() ? int(file.taps()) : 3;
+        bool verbose = false, skip_idle = false;
+        const char* checkpoint_path = 0;
+        const char* resume_path = 0;
+        uint64_t checkpoint_every = 1000000;
+        for (int i = 4; i < argc; i++) {
+            if (std::strcmp(argv[i], "-v") == 0)
+                verbose = true;
+            else if (std::strcmp(argv[i], "--skip-idle") == 0)
+                skip_idle = true;
+            else if (std::strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc)
+                checkpoint_path = argv[++i];
+            else if (std::strcmp(argv[i], "--checkpoint-every") == 0 && i + 1 < argc)
+                checkpoint_every = std::strtoull(argv[++i], 0, 10);
+            else if (std::strcmp(argv[i], "--resume") == 0 && i + 1 < argc)
+                resume_path = argv[++i];
+            else
+                taps = std::atoi(argv[i]);
+        }
+        if (checkpoint_path && checkpoint_every == 0)
+            return usage();
+
+        // A checkpoint only resumes the array it was taken of
+        Checkpoint resume;
+        if (resume_path) {
+            std::string error;
+            if (!resume.read(resume_path, error)) {
+                cout << error << endl;
+                return 1;
+            }
+            if (resume.design != design || int(resume.taps) != taps) {
+                cout << resume_path << " is a checkpoint of " << design_name(resume.design) << "x" << resume.taps
+                     << endl;
+                return 1;
+            }
+        }
+
+        cout << "Streaming " << argv[2] << " into " << design_name(design) << "x" << taps << endl;
+        FileRun run = { file, verbose, trace, skip_idle, checkpoint_path, checkpoint_every,
+                        resume_path ? &resume : 0, false };
+        if (!dispatch(design, taps, run)) {
+            cout << "Unsupported tap count " << taps << endl;
+            return 1;
+        }
+        return run.passed ? 0 : 1;
+    }
+
+    return usage();
+}
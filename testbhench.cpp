@@ -1,10 +1,15 @@
 #include <systemc.h>
 
 #include <iostream>
+#include <vector>
+
+#include "design.cpp"  // This would contain the design code above
+#include "common/cycle.h"
+#include "common/golden_checker.h"
+#include "common/trace.h"
 
-#include "design.cpp"  // This would contain the design code above
 SC_MODULE(R2_Testbench) {
-    sc_out<bool> clk;
+    sc_in<bool> clk;
     sc_out<bool> rst;
     sc_out<int> x_in;
     sc_out<int> w_in;
@@ -13,89 +18,97 @@ SC_MODULE(R2_Testbench) {
     sc_in<int> result1;
     sc_in<int> result2;
     sc_in<int> result3;
-    
-    SC_CTOR(R2_Testbench) {
-        SC_THREAD(clock_gen);
-        SC_THREAD(stimulus);
-        SC_THREAD(monitor);
+    sc_out<int> sum_result;
+
+    std::vector<CycleIn> schedule;  // Inputs for each rising clock edge
+    size_t next_input;              // Next schedule entry to drive
+    size_t edges;                   // Rising edges seen by the monitor
+    GoldenChecker checker;
+    bool passed;                    // Set by the checker once the schedule has run
+
+    SC_CTOR(R2_Testbench)
+        : next_input(0), edges(0), checker(GoldenChecker::for_dot_product(3, 5)), passed(false) {
+        build_schedule();
+
+        // Inputs change on the falling edge, the array samples them on the rising edge
+        SC_METHOD(stimulus);
+        sensitive << clk.neg();
+
+        SC_METHOD(monitor);
+        sensitive << clk.pos();
+        dont_initialize();
+
+        // Sum of results, for the trace
+        SC_METHOD(sum_results);
+        sensitive << result1 << result2 << result3;
     }
-    
-    void clock_gen() {
-        clk.write(false);
-        while(1) {
-            wait(5, SC_NS);
-            clk.write(!clk.read());
+
+    void build_schedule() {
+        // Reset
+        schedule.push_back(cycle(true, 0, 0));
+
+        // Send data in correct order for convolution
+        // First sequence: [1,2,3,4,5]
+        // Second sequence: [3,2,1]
+        schedule.push_back(cycle(false, 3, 1));  // x1, w1
+        schedule.push_back(cycle(false, 2, 2));  // x2, w2
+        schedule.push_back(cycle(false, 1, 3));  // x3, w3
+        schedule.push_back(cycle(false, 0, 4));  // w4
+        schedule.push_back(cycle(false, 0, 5));  // w5
+
+        // Flush pipeline
+        for (int i = 0; i < 6; i++)
+            schedule.push_back(cycle(false, 0, 0));
+    }
+
+    static CycleIn cycle(bool reset, int x, int w) {
+        CycleIn in = { reset, x, 0, w, false };
+        return in;
+    }
+
+    void stimulus() {
+        if (next_input < schedule.size()) {
+            const CycleIn& in = schedule[next_input++];
+            rst.write(in.rst);
+            x_in.write(in.x);
+            w_in.write(in.w);
         }
     }
-    
-void stimulus() {
-    // Reset
-    rst.write(true);
-    x_in.write(0);
-    w_in.write(0);
-    wait(15, SC_NS);
-    rst.write(false);
-    
-    // Send data in correct order for convolution
-    // First sequence: [1,2,3,4,5]
-    // Second sequence: [3,2,1]
-    
-    w_in.write(1);  // w1
-    x_in.write(3);  // x1
-    wait(10, SC_NS);
-    
-    w_in.write(2);  // w2
-    x_in.write(2);  // x2
-    wait(10, SC_NS);
-    
-    w_in.write(3);  // w3
-    x_in.write(1);  // x3
-    wait(10, SC_NS);
-    
-    w_in.write(4);  // w4
-    x_in.write(0);
-    wait(10, SC_NS);
-    
-    w_in.write(5);  // w5
-    x_in.write(0);
-    wait(10, SC_NS);
-    
-    // Flush pipeline
-    w_in.write(0);
-    x_in.write(0);
-    wait(50, SC_NS);
-    
-    sc_stop();
-}
-    
+
+    void sum_results() {
+        sum_result.write(result1.read() + result2.read() + result3.read());
+    }
+
+    // Check result1 + result2 + result3 against the golden model, printing only mismatches
     void monitor() {
-        cout << "Time\tw_in\tx_in\tw_out\tx_out\tresult1\tresult2\tresult3" << endl;
-        while(true) {
-            wait(clk.posedge_event());
-            cout << sc_time_stamp() << "\t"
-                 << w_in.read() << "\t"
-                 << x_in.read() << "\t"
-                 << w_out.read() << "\t"
-                 << x_out.read() << "\t"
-                 << result1.read() << "\t"
-                 << result2.read() << "\t"
-                 << result3.read() << endl;
+        if (edges > 0)
+            checker.output(edges - 1, result1.read() + result2.read() + result3.read());
+        if (edges > 0 && edges <= 5)
+            checker.sample(edges, x_in.read(), w_in.read());
+
+        if (++edges == schedule.size()) {
+            passed = checker.finish();
+            sc_stop();
         }
     }
 };
 
 // Main function
 int sc_main(int argc, char* argv[]) {
+    // Clock with the first rising edge at 5 ns, 10 ns period
+    sc_clock clk_sig("clk", 10, SC_NS, 0.5, 5, SC_NS, true);
+
     // Signals for connecting modules
-    sc_signal<bool> clk_sig, rst_sig;
+    sc_signal<bool> rst_sig;
     sc_signal<int> x_in_sig, w_in_sig;
     sc_signal<int> x_out_sig, w_out_sig;
     sc_signal<int> result1_sig, result2_sig, result3_sig;
-    
+    sc_signal<int> sum_result_sig;
+
     // Instantiate modules
     R2_SystolicArray systolic_array("R2_SystolicArray");
     R2_Testbench tb("R2_Testbench");
-    
+
     // Connect signals
     systolic_array.clk(clk_sig);
     systolic_array.rst(rst_sig);
@@ -106,7 +119,7 @@ int sc_main(int argc, char* argv[]) {
     systolic_array.result1(result1_sig);
     systolic_array.result2(result2_sig);
     systolic_array.result3(result3_sig);
-    
+
     tb.clk(clk_sig);
     tb.rst(rst_sig);
     tb.x_in(x_in_sig);
@@ -116,39 +129,30 @@ int sc_main(int argc, char* argv[]) {
     tb.result1(result1_sig);
     tb.result2(result2_sig);
     tb.result3(result3_sig);
-    
-    // Create VCD trace file
-    sc_trace_file* tf = sc_create_vcd_trace_file("r2_systolic_array");
-    
-    // Add signals to trace
-    sc_trace(tf, clk_sig, "clk");
-    sc_trace(tf, rst_sig, "rst");
-    sc_trace(tf, x_in_sig, "x_in");
-    sc_trace(tf, w_in_sig, "w_in");
-    sc_trace(tf, x_out_sig, "x_out");
-    sc_trace(tf, w_out_sig, "w_out");
-    sc_trace(tf, result1_sig, "result1");
-    sc_trace(tf, result2_sig, "result2");
-    sc_trace(tf, result3_sig, "result3");
-    sc_signal<int> sum_result_sig;
-    sc_trace(tf, sum_result_sig, "sum_result");
+    tb.sum_result(sum_result_sig);
+
+    // Trace to r2_systolic_array.vcd unless the command line says otherwise, see common/trace.h
+    TraceConfig trace("r2_systolic_array.vcd");
+    if (!trace.parse(argc, argv))
+        return 1;
+    SignalTracer tracer("tracer", trace);
+    tracer.clk(clk_sig);
+    tracer.add("rst", rst_sig);
+    tracer.add("x_in", x_in_sig);
+    tracer.add("w_in", w_in_sig);
+    tracer.add("x_out", x_out_sig);
+    tracer.add("w_out", w_out_sig);
+    tracer.add("result1", result1_sig);
+    tracer.add("result2", result2_sig);
+    tracer.add("result3", result3_sig);
+    tracer.add("sum_result", sum_result_sig);
+    tb.checker.on_mismatch([&tracer](uint64_t cycle) { tracer.trigger(cycle); });
 
-    // Process to calculate the sum of results
-    SC_THREAD([&]() {
-        while (true) {
-            sum_result_sig.write(result1_sig.read() + result2_sig.read() + result3_sig.read());
-            wait(SC_ZERO_TIME);
-        }
-    });
-    
     // Start simulation
     cout << "Starting R2 systolic array simulation..." << endl;
     sc_start();
-    
-    // Close trace file
-    sc_close_vcd_trace_file(tf);
-    
+
     cout << "Simulation completed." << endl;
-    
-    return 0;
-}
\ No newline at end of file
+
+    return tb.passed ? 0 : 1;
+}
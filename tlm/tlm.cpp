@@ -0,0 +1,220 @@
+#include <systemc.h>
+#include <tlm.h>
+#include <tlm_utils/simple_initiator_socket.h>
+#include <tlm_utils/tlm_quantumkeeper.h>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "../common/child_process.h"
+#include "../common/dispatch.h"
+#include "../common/stream_run.h"
+#include "../common/tlm_target.h"
+
+// Loosely-timed initiator: sends `jobs` random convolutions to the target back to
+// back, keeps the annotated delays in a quantum keeper and only yields to the
+// kernel once per quantum. Checks every result against a direct convolution.
+SC_MODULE(JobInitiator) {
+    tlm_utils::simple_initiator_socket<JobInitiator> socket;
+
+    int taps;
+    uint64_t jobs, samples;
+    unsigned seed;
+    uint64_t errors;        // Wrong results plus failed transactions
+    uint64_t syncs;         // Times the quantum keeper gave control back to the kernel
+    sc_time finished;       // Local time after the last job
+
+    SC_HAS_PROCESS(JobInitiator);
+    JobInitiator(sc_module_name name, int taps, uint64_t jobs, uint64_t samples, unsigned seed)
+        : sc_module(name), socket("socket"), taps(taps), jobs(jobs), samples(samples), seed(seed), errors(0),
+          syncs(0) {
+        SC_THREAD(send);
+    }
+
+    void send() {
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<int> value(-8, 8);
+        std::vector<int> x(samples), w(taps), y(samples);
+        tlm_utils::tlm_quantumkeeper keeper;
+        keeper.reset();
+
+        for (uint64_t j = 0; j < jobs; j++) {
+            for (uint64_t i = 0; i < samples; i++)
+                x[i] = value(rng);
+            for (int k = 0; k < taps; k++)
+                w[k] = value(rng);
+
+            ConvJob job = { x.data(), samples, w.data(), taps, y.data() };
+            tlm::tlm_generic_payload trans;
+            trans.set_command(tlm::TLM_WRITE_COMMAND);
+            trans.set_address(0);
+            trans.set_data_ptr(reinterpret_cast<unsigned char*>(&job));
+            trans.set_data_length(sizeof(job));
+            trans.set_streaming_width(sizeof(job));
+            trans.set_byte_enable_ptr(0);
+            trans.set_dmi_allowed(false);
+            trans.set_response_status(tlm::TLM_INCOMPLETE_RESPONSE);
+
+            sc_time delay = keeper.get_local_time();
+            socket->b_transport(trans, delay);
+            keeper.set(delay);
+            if (trans.is_response_error()) {
+                errors++;
+                continue;
+            }
+            for (uint64_t i = 0; i < samples; i++) {
+                long long expected = 0;
+                for (int k = 0; k < taps; k++)
+                    if (i + k + 1 >= uint64_t(taps))
+                        expected += (long long)w[k] * x[i + k + 1 - taps];
+                if (y[i] != int(expected))
+                    errors++;
+            }
+            if (keeper.need_sync()) {
+                keeper.sync();
+                syncs++;
+            }
+        }
+        finished = keeper.get_current_time();
+    }
+};
+
+// Measured in the child, trivially copyable so it can come back through a pipe
+struct TlmResult {
+    uint64_t cycles;        // Clock cycles annotated by the target, or simulated at pin level
+    uint64_t errors;
+    uint64_t syncs;
+    double simulated_ns;    // Simulated time at the end
+    double seconds;         // Host wall time inside sc_start()
+};
+
+// All jobs through ArrayTarget<D>
+struct TlmRun {
+    uint64_t jobs, samples;
+    unsigned seed;
+    double quantum_ns;
+    TlmResult result;
+
+    template <Design D, int N>
+    void run() {
+        tlm_utils::tlm_quantumkeeper::set_global_quantum(sc_time(quantum_ns, SC_NS));
+        ArrayTarget<D> target("target", N);
+        JobInitiator initiator("initiator", N, jobs, samples, seed);
+        initiator.socket.bind(target.socket);
+
+        auto start = std::chrono::steady_clock::now();
+        sc_start();
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        result.cycles = target.cycles;
+        result.errors = initiator.errors + (target.jobs == jobs ? 0 : jobs - target.jobs);
+        result.syncs = initiator.syncs;
+        result.simulated_ns = initiator.finished.to_seconds() * 1e9;
+    }
+};
+
+// The same number of samples streamed through the pins of SystolicArray<D, N>, for speed
+struct PinRun {
+    uint64_t samples;
+    unsigned seed;
+    TlmResult result;
+
+    template <Design D, int N>
+    void run() {
+        std::vector<StimulusRecord> records = random_samples(samples, seed, N);
+        GoldenChecker checker = GoldenChecker::for_design(D, N, records.size());
+        checker.set_report_limit(0);
+        StreamStats stats = run_stream<D, N>(records.data(), records.size(), checker);
+
+        result.cycles = stats.cycles;
+        result.errors = checker.mismatch_count() + checker.missing_count();
+        result.syncs = 0;
+        result.simulated_ns = stats.cycles * 10.0;
+        result.seconds = stats.seconds;
+    }
+};
+
+static int usage() {
+    cout << "Usage: tlm [--designs B1,B2,...] [--taps 3,9,...] [--jobs J] [--samples per-job] [--quantum ns]"
+         << " [--seed S]" << endl;
+    return 1;
+}
+
+int sc_main(int argc, char* argv[]) {
+    std::vector<Design> designs = { Design::B1, Design::B2, Design::F, Design::R1, Design::R2, Design::W1,
+                                    Design::W2 };
+    std::vector<int> taps = { 3, 9, 16, 25 };
+    uint64_t jobs = 100;
+    uint64_t samples = 1000;
+    double quantum_ns = 100000;
+    unsigned seed = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 == argc)
+            return usage();
+        if (std::strcmp(argv[i], "--designs") == 0) {
+            designs.clear();
+            for (char* t = std::strtok(argv[++i], ","); t; t = std::strtok(0, ",")) {
+                Design d;
+                if (!parse_design(t, d)) {
+                    cout << "Unknown design " << t << endl;
+                    return 1;
+                }
+                designs.push_back(d);
+            }
+        } else if (std::strcmp(argv[i], "--taps") == 0) {
+            taps.clear();
+            for (char* t = std::strtok(argv[++i], ","); t; t = std::strtok(0, ","))
+                taps.push_back(std::atoi(t));
+        } else if (std::strcmp(argv[i], "--jobs") == 0) {
+            jobs = std::strtoull(argv[++i], 0, 10);
+        } else if (std::strcmp(argv[i], "--samples") == 0) {
+            samples = std::strtoull(argv[++i], 0, 10);
+        } else if (std::strcmp(argv[i], "--quantum") == 0) {
+            quantum_ns = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--seed") == 0) {
+            seed = std::strtoul(argv[++i], 0, 10);
+        } else {
+            return usage();
+        }
+    }
+
+    // Each job's annotated cycles must match job_cycles(), the pin-level run only sets the pace to beat
+    cout << "design\ttaps\tjobs\tcycles_per_job\tpin_cycles\tsimulated_us\tsyncs\ttlm_seconds\tpin_seconds"
+            "\tspeedup\tpassed" << endl;
+    bool all_passed = true;
+    for (size_t d = 0; d < designs.size(); d++) {
+        for (size_t t = 0; t < taps.size(); t++) {
+            TlmResult tlm = TlmResult(), pin = TlmResult();
+            bool ok = run_in_child([&](TlmResult& out) {
+                TlmRun run = { jobs, samples, seed, quantum_ns, TlmResult() };
+                bool dispatched = dispatch(designs[d], taps[t], run);
+                out = run.result;
+                return dispatched;
+            }, tlm);
+            ok = ok && run_in_child([&](TlmResult& out) {
+                PinRun run = { jobs * samples, seed, TlmResult() };
+                bool dispatched = dispatch(designs[d], taps[t], run);
+                out = run.result;
+                return dispatched;
+            }, pin);
+            if (!ok) {
+                cout << "Failed to run " << design_name(designs[d]) << "x" << taps[t]
+                     << " (unsupported tap count?)" << endl;
+                all_passed = false;
+                continue;
+            }
+            uint64_t per_job = jobs ? tlm.cycles / jobs : 0;
+            bool passed = tlm.errors == 0 && pin.errors == 0 && per_job == job_cycles(designs[d], taps[t], samples);
+            all_passed &= passed;
+            cout << design_name(designs[d]) << "\t" << taps[t] << "\t" << jobs << "\t" << per_job << "\t"
+                 << pin.cycles << "\t" << tlm.simulated_ns / 1000 << "\t" << tlm.syncs << "\t" << tlm.seconds << "\t"
+                 << pin.seconds << "\t" << (tlm.seconds > 0 ? pin.seconds / tlm.seconds : 0) << "\t"
+                 << (passed ? "true" : "false") << endl;
+        }
+    }
+    cout << (all_passed ? "PASS" : "FAIL") << endl;
+    return all_passed ? 0 : 1;
+}
@@ -0,0 +1,268 @@
+#include <systemc.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#include "../common/child_process.h"
+#include "../common/dispatch.h"
+#include "../common/stream_run.h"
+#include "../common/toggle.h"
+
+// Measured in the child, trivially copyable so it can come back through a pipe
+struct ToggleResult {
+    uint64_t cycles;
+    uint64_t errors;        // Golden-model mismatches and missing results
+    uint64_t signals, bits, transitions, weighted, bit_toggles;
+    uint64_t pin_toggles;   // Bit toggles of the top-level signals
+    bool trace_matches;     // The VCD of the top-level signals counts the same offline
+};
+
+// Streams random signals through SystemC<D, N> with a ToggleCollector on every signal
+// the array drives, and a second one on the top-level signals, which SignalTracer
+// also writes to a VCD to count offline
+struct LiveRun {
+    uint64_t length;
+    unsigned seed;
+    bool modules;
+    ToggleResult result;
+
+    template <Design D, int N>
+    void run() {
+        std::vector<StimulusRecord> samples = random_samples(length, seed, N);
+        GoldenChecker checker = GoldenChecker::for_design(D, N, samples.size());
+        checker.set_report_limit(0);
+        char vcd[] = "/tmp/toggleXXXXXX.vcd";
+        int fd = mkstemps(vcd, 4);
+        if (fd >= 0)
+            close(fd);
+
+        sc_clock clk("clk", 10, SC_NS, 0.5, 5, SC_NS, true);
+        InputSignals in;
+        OutputSignals out;
+        SystolicArray<D, N> array("array");
+        StimulusSource source("source", samples.data(), samples.size(), cycles_per_sample(D), 1, 0,
+                              weight_offset(D, N));
+        StreamMonitor monitor("monitor", source, checker, source.total_cycles() + 2 * N + 8, false);
+        bind(array, clk, in, out);
+        source.clk(clk);
+        source.rst(in.rst);
+        source.x_in(in.x_in);
+        source.y_in(in.y_in);
+        source.w_in(in.w_in);
+        source.tag_in(in.tag_in);
+        monitor.clk(clk);
+        monitor.x_in(in.x_in);
+        monitor.w_in(in.w_in);
+        monitor.y_out(out.y_out);
+
+        ToggleCollector toggles("toggles");
+        toggles.clk(clk);
+        toggles.add_outputs(array);
+
+        TraceConfig trace(fd >= 0 ? vcd : "");
+        SignalTracer tracer("tracer", trace);
+        ToggleCollector pins("pins");
+        tracer.clk(clk);
+        pins.clk(clk);
+        const char* names[] = { "rst", "x_in", "y_in", "w_in", "tag_in", "x_out", "y_out", "w_out", "tag_out" };
+        const sc_signal_in_if<bool>* bits[] = { &in.rst, &in.tag_in, &out.tag_out };
+        const sc_signal_in_if<int>* words[] = { &in.x_in, &in.y_in, &in.w_in, &out.x_out, &out.y_out, &out.w_out };
+        for (int i = 0, b = 0, w = 0; i < 9; i++) {
+            bool bit = std::strcmp(names[i], "rst") == 0 || std::strstr(names[i], "tag");
+            if (bit) {
+                tracer.add(names[i], *bits[b]);
+                pins.add(names[i], "top", *bits[b++]);
+            } else {
+                tracer.add(names[i], *words[w]);
+                pins.add(names[i], "top", *words[w++]);
+            }
+        }
+
+        sc_start();
+        tracer.end_of_simulation();
+        if (modules)
+            toggles.counter.report(cout, toggles.cycles);
+
+        ToggleTotals t = toggles.counter.totals();
+        result.cycles = toggles.cycles;
+        result.errors = checker.mismatch_count() + checker.missing_count();
+        result.signals = t.signals;
+        result.bits = t.bits;
+        result.transitions = t.transitions;
+        result.weighted = t.weighted;
+        result.bit_toggles = t.bit_toggles;
+        result.pin_toggles = pins.counter.totals().bit_toggles;
+        result.trace_matches = fd >= 0 && trace_matches(vcd, pins.counter);
+        std::remove(vcd);
+    }
+
+    // Every top-level signal toggles the same in the VCD as live
+    static bool trace_matches(const char* path, const ToggleCounter& live) {
+        VcdTraceReader reader;
+        ToggleCounter offline;
+        if (!reader.open(path))
+            return false;
+        count_trace(reader, offline);
+        if (offline.signals.size() != live.signals.size())
+            return false;
+        for (size_t i = 0; i < live.signals.size(); i++) {
+            const ToggleSignal& a = live.signals[i];
+            const ToggleSignal& b = offline.signals[i];
+            if (b.name != "SystemC." + a.name || b.transitions != a.transitions || b.bit_toggles != a.bit_toggles)
+                return false;
+        }
+        return true;
+    }
+};
+
+static int usage() {
+    cout << "Usage: toggle run [--designs B1,B2,...] [--taps 3,9,...] [--length samples] [--seed S] [--modules]" << endl
+         << "                  [--fj-per-toggle E]" << endl
+         << "       toggle file <trace.vcd | binary trace> [--fj-per-toggle E] [--period ns]" << endl
+         << "       --modules adds the table per module, --fj-per-toggle is the energy of one bit toggle" << endl;
+    return 1;
+}
+
+// Comma-separated integers
+static std::vector<int> int_list(char* list) {
+    std::vector<int> values;
+    for (char* t = std::strtok(list, ","); t; t = std::strtok(0, ","))
+        values.push_back(std::atoi(t));
+    return values;
+}
+
+// Dynamic power in uW of `toggles` bit toggles per cycle at fj_per_toggle each
+static double power_uw(double toggles_per_cycle, double fj_per_toggle, double period_ns) {
+    return toggles_per_cycle * fj_per_toggle / period_ns;
+}
+
+// Switching activity of a trace file written earlier, by any simulator for a VCD
+static int count_file(const char* path, double fj_per_toggle, double period_ns) {
+    std::string name(path);
+    bool vcd = name.size() >= 4 && name.compare(name.size() - 4, 4, ".vcd") == 0;
+    ToggleCounter counter;
+    uint64_t cycles = 0;
+    if (vcd) {
+        VcdTraceReader reader;
+        if (!reader.open(path)) {
+            cout << "Cannot read VCD " << path << endl;
+            return 1;
+        }
+        cycles = count_trace(reader, counter);
+    } else {
+        BinaryTraceReader reader;
+        if (!reader.open(path)) {
+            cout << "Cannot read trace " << path << endl;
+            return 1;
+        }
+        cycles = count_trace(reader, counter);
+    }
+    counter.report(cout, cycles);
+    ToggleTotals t = counter.totals();
+    double per_cycle = cycles ? double(t.bit_toggles) / cycles : 0;
+    cout << "Cycles: " << cycles << ", bit toggles per cycle: " << per_cycle
+         << ", dynamic power: " << power_uw(per_cycle, fj_per_toggle, period_ns) << " uW" << endl;
+    return 0;
+}
+
+int sc_main(int argc, char* argv[]) {
+    std::vector<Design> designs = { Design::B1, Design::B2, Design::F, Design::R1, Design::R2, Design::W1,
+                                    Design::W2 };
+    std::vector<int> taps = { 3, 9 };
+    uint64_t length = 10000;
+    unsigned seed = 1;
+    bool modules = false;
+    double fj_per_toggle = 2;   // Half C V^2 for about 5 fF a bit at 0.9 V
+    double period_ns = 10;
+    if (argc < 2)
+        return usage();
+    bool live = std::strcmp(argv[1], "run") == 0;
+    if (!live && (std::strcmp(argv[1], "file") != 0 || argc < 3))
+        return usage();
+
+    for (int i = live ? 2 : 3; i < argc; i++) {
+        if (std::strcmp(argv[i], "--modules") == 0) {
+            modules = true;
+            continue;
+        }
+        if (i + 1 == argc)
+            return usage();
+        if (live && std::strcmp(argv[i], "--designs") == 0) {
+            designs.clear();
+            for (char* t = std::strtok(argv[++i], ","); t; t = std::strtok(0, ",")) {
+                Design d;
+                if (!parse_design(t, d)) {
+                    cout << "Unknown design " << t << endl;
+                    return 1;
+                }
+                designs.push_back(d);
+            }
+        } else if (live && std::strcmp(argv[i], "--taps") == 0) {
+            taps = int_list(argv[++i]);
+        } else if (live && std::strcmp(argv[i], "--length") == 0) {
+            length = std::strtoull(argv[++i], 0, 10);
+        } else if (live && std::strcmp(argv[i], "--seed") == 0) {
+            seed = std::strtoul(argv[++i], 0, 10);
+        } else if (std::strcmp(argv[i], "--fj-per-toggle") == 0) {
+            fj_per_toggle = std::atof(argv[++i]);
+        } else if (!live && std::strcmp(argv[i], "--period") == 0) {
+            period_ns = std::atof(argv[++i]);
+        } else {
+            return usage();
+        }
+    }
+    if (!live)
+        return count_file(argv[2], fj_per_toggle, period_ns);
+
+    // Bit toggles of the signals inside each array; rank 1 switches least per sample
+    // at its tap count. The VCD written of the top-level signals must count the same.
+    cout << "design\ttaps\tsamples\tcycles\tsignals\tbits\ttransitions\twidth_weighted\tbit_toggles\ttoggles_per_cycle"
+            "\ttoggles_per_sample\tactivity\tpower_uw\tpin_toggles\tvcd_matches\trank\tpassed" << endl;
+    bool all_passed = true;
+    for (size_t t = 0; t < taps.size(); t++) {
+        std::vector<ToggleResult> results;
+        std::vector<Design> ran;
+        for (size_t d = 0; d < designs.size(); d++) {
+            ToggleResult r = ToggleResult();
+            bool ok = run_in_child([&](ToggleResult& out) {
+                LiveRun run = { length, seed, modules, ToggleResult() };
+                bool dispatched = dispatch(designs[d], taps[t], run);
+                out = run.result;
+                return dispatched;
+            }, r);
+            if (!ok) {
+                cout << "Failed to run " << design_name(designs[d]) << "x" << taps[t]
+                     << " (unsupported tap count?)" << endl;
+                all_passed = false;
+                continue;
+            }
+            results.push_back(r);
+            ran.push_back(designs[d]);
+        }
+
+        std::vector<size_t> rank(results.size(), 1);
+        for (size_t i = 0; i < results.size(); i++)
+            for (size_t k = 0; k < results.size(); k++)
+                rank[i] += results[k].bit_toggles < results[i].bit_toggles;
+        for (size_t i = 0; i < results.size(); i++) {
+            const ToggleResult& r = results[i];
+            bool passed = r.errors == 0 && r.trace_matches;
+            all_passed &= passed;
+            double per_cycle = r.cycles ? double(r.bit_toggles) / r.cycles : 0;
+            cout << design_name(ran[i]) << "\t" << taps[t] << "\t" << length << "\t" << r.cycles << "\t" << r.signals
+                 << "\t" << r.bits << "\t" << r.transitions << "\t" << r.weighted << "\t" << r.bit_toggles << "\t"
+                 << per_cycle << "\t" << (length ? double(r.bit_toggles) / length : 0) << "\t"
+                 << (r.bits && r.cycles ? double(r.bit_toggles) / r.bits / r.cycles : 0) << "\t"
+                 << power_uw(per_cycle, fj_per_toggle, period_ns) << "\t" << r.pin_toggles << "\t"
+                 << (r.trace_matches ? "true" : "false") << "\t" << rank[i] << "\t" << (passed ? "true" : "false")
+                 << endl;
+        }
+    }
+    cout << (all_passed ? "PASS" : "FAIL") << endl;
+    return all_passed ? 0 : 1;
+}
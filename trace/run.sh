@@ -0,0 +1,2 @@
+cd "$(dirname "$0")"
+g++ -O2 $CXXFLAGS -o trace2vcd trace2vcd.cpp && echo "Compile done. Starting run..." && ./trace2vcd "$@"
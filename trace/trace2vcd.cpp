@@ -0,0 +1,34 @@
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include "../common/trace_format.h"
+
+// Converts a binary trace written by SignalTracer into VCD, e.g. to open a
+// mismatch window from a long stimulus run in a waveform viewer
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        std::printf("Usage: trace2vcd <trace> <out.vcd>\n");
+        return 1;
+    }
+    BinaryTraceReader reader;
+    if (!reader.open(argv[1])) {
+        std::printf("Cannot read trace %s\n", argv[1]);
+        return 1;
+    }
+    VcdTraceWriter writer;
+    if (!writer.open(argv[2], reader.signals)) {
+        std::printf("Cannot write %s\n", argv[2]);
+        return 1;
+    }
+
+    uint64_t time, records = 0;
+    std::vector<TraceValue> values;
+    while (reader.next(time, values)) {
+        writer.sample(time, values.data(), values.size());
+        records++;
+    }
+    writer.close();
+    std::printf("Wrote %llu samples of %zu signals to %s\n", (unsigned long long)records, reader.signals.size(),
+                argv[2]);
+    return 0;
+}